@@ -0,0 +1,154 @@
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "../Simulation/Simulation.h"
+#include "../Simulation/Entities/CircularEnt.h"
+#include "../Simulation/Entities/KheperaRobot.h"
+#include "../Simulation/Sensors/ProximitySensor.h"
+
+// compares trajectories of robots simulated in double and float builds of the library (see PRECISION in Makefile)
+// usage: DriftBenchmark record <file> [steps]   - simulates fixed scenario and stores robot positions every second
+//        DriftBenchmark compare <file1> <file2> - prints mean and max distance between robots in both files
+
+#define WORLD_SIZE      1000
+#define OBSTACLES       40
+#define ROBOTS          20
+#define SENSORS         8
+#define SAMPLE_EVERY    25 // steps, one second of simulation time
+
+struct Sample
+{
+    int         step;
+    uint32_t    id;
+    double      x;
+    double      y;
+};
+
+static Simulation* createScenario()
+{
+    // generator is used only for setup, so that both builds start from identical world
+    std::mt19937 random(7);
+    std::uniform_real_distribution<double> position(50, WORLD_SIZE - 50);
+    Simulation* simulation = new Simulation(WORLD_SIZE, WORLD_SIZE, true);
+
+    for (uint32_t id = 0; id < OBSTACLES; id++)
+        simulation->addEntity(simulation->create<CircularEnt>(id, 1000, false, position(random), position(random), 20));
+
+    for (uint32_t id = OBSTACLES; id < OBSTACLES + ROBOTS; id++)
+    {
+        KheperaRobot* robot = simulation->create<KheperaRobot>(id, 100, position(random), position(random), 14, 2, 53,
+            (float) (random() % 628) / 100, &simulation->getArena());
+        simulation->addEntity(robot);
+        for (int i = 0; i < SENSORS; i++)
+            simulation->addSensor(simulation->create<ProximitySensor>(40.0, 0.5f, (float) (i * 2 * M_PI / SENSORS)), id);
+    }
+    simulation->fillDistanceMap();
+
+    return simulation;
+}
+
+// simple Braitenberg vehicle - robots turn away from obstacles, so that they keep moving through whole world
+static void steer(KheperaRobot& robot)
+{
+    float left = 0, right = 0, state;
+    for (int i = 0; i < robot.getSensorCount(); i++)
+    {
+        robot.getSensorState(i, state);
+        if (i < robot.getSensorCount() / 2)
+            left += state;
+        else
+            right += state;
+    }
+    robot.setLeftMotorSpeed(DEFAULT_MAX_MOTOR_SPEED * (1 - 2 * right));
+    robot.setRightMotorSpeed(DEFAULT_MAX_MOTOR_SPEED * (1 - 2 * left));
+}
+
+static int record(const char* fileName, int steps)
+{
+    std::ofstream file(fileName);
+    if (!file)
+        return 1;
+
+    Simulation* simulation = createScenario();
+    std::vector<uint32_t> robots = simulation->getIdsByShape(SimEnt::KHEPERA_ROBOT);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int step = 1; step <= steps; step++)
+    {
+        for (size_t i = 0; i < robots.size(); i++)
+            steer(*dynamic_cast<KheperaRobot*>(simulation->getEntity(robots[i])));
+        simulation->update();
+
+        if (step % SAMPLE_EVERY == 0)
+        {
+            for (size_t i = 0; i < robots.size(); i++)
+            {
+                KheperaRobot* robot = dynamic_cast<KheperaRobot*>(simulation->getEntity(robots[i]));
+                file.precision(17);
+                file << step << " " << robots[i] << " " << robot->getX() << " " << robot->getY() << "\n";
+            }
+        }
+    }
+    double total = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << (sizeof(Scalar) == sizeof(float) ? "float" : "double") << " build: " << steps << " steps, "
+        << total / steps << " ms / step" << std::endl;
+    delete simulation;
+    return 0;
+}
+
+static bool readSamples(const char* fileName, std::vector<Sample>& samples)
+{
+    std::ifstream file(fileName);
+    Sample sample;
+    while (file >> sample.step >> sample.id >> sample.x >> sample.y)
+        samples.push_back(sample);
+    return !samples.empty();
+}
+
+static int compare(const char* fstName, const char* sndName)
+{
+    std::vector<Sample> fst, snd;
+    if (!readSamples(fstName, fst) || !readSamples(sndName, snd) || fst.size() != snd.size())
+    {
+        std::cerr << "files do not contain the same scenario" << std::endl;
+        return 1;
+    }
+
+    std::cout << "  time [s]   mean drift   max drift" << std::endl;
+    size_t i = 0;
+    while (i < fst.size())
+    {
+        int step = fst[i].step;
+        double sum = 0, maxDrift = 0;
+        int count = 0;
+        for (; i < fst.size() && fst[i].step == step; i++, count++)
+        {
+            double drift = sqrt((fst[i].x - snd[i].x) * (fst[i].x - snd[i].x) + (fst[i].y - snd[i].y) * (fst[i].y - snd[i].y));
+            sum += drift;
+            maxDrift = max(maxDrift, drift);
+        }
+
+        // print only a few rows - every power of two seconds and the last one
+        int seconds = step / SAMPLE_EVERY;
+        if ((seconds & (seconds - 1)) == 0 || i == fst.size())
+            std::cout << "  " << seconds << "   " << sum / count << "   " << maxDrift << std::endl;
+    }
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc >= 3 && strcmp(argv[1], "record") == 0)
+        return record(argv[2], argc > 3 ? atoi(argv[3]) : 25 * 600);
+    if (argc >= 4 && strcmp(argv[1], "compare") == 0)
+        return compare(argv[2], argv[3]);
+
+    std::cerr << "usage: DriftBenchmark record <file> [steps] | compare <file1> <file2>" << std::endl;
+    return 1;
+}
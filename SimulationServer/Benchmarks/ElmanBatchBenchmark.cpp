@@ -0,0 +1,75 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "../Simulation/Controllers/ElmanNetwork.h"
+#include "../Simulation/Controllers/BatchedElmanNetwork.h"
+
+// compares evaluation of population of Elman networks one by one and by BatchedElmanNetwork
+// usage: ElmanBatchBenchmark [evaluations] (build the library with make SIMD=avx for 4 lanes)
+
+#define NETWORKS        500
+#define INPUTS          8
+#define OUTPUTS         2
+
+int main(int argc, char** argv)
+{
+    int evaluations = argc > 1 ? atoi(argv[1]) : 2000;
+    std::mt19937 random(13);
+    std::uniform_real_distribution<double> weight(-1, 1);
+    std::uniform_real_distribution<float> input(0, 1);
+
+    int weightCount = ElmanNetwork::getWeightCount(INPUTS, OUTPUTS);
+    std::vector<ElmanNetwork*> networks;
+    BatchedElmanNetwork batch(NETWORKS, INPUTS, OUTPUTS);
+    std::vector<double> weights(weightCount);
+    for (int n = 0; n < NETWORKS; n++)
+    {
+        for (int w = 0; w < weightCount; w++)
+            weights[w] = weight(random);
+        networks.push_back(new ElmanNetwork(INPUTS, OUTPUTS));
+        networks.back()->setWeights(&weights[0], weightCount);
+        batch.setWeights(n, &weights[0], weightCount);
+    }
+    for (int out = 0; out < OUTPUTS; out++)
+    {
+        for (int n = 0; n < NETWORKS; n++)
+            networks[n]->setActivationFunction(out, ElmanNetwork::ACT_SIGMOID);
+        batch.setActivationFunction(out, ElmanNetwork::ACT_SIGMOID);
+    }
+    std::vector<float> inputs(NETWORKS * INPUTS);
+    for (size_t i = 0; i < inputs.size(); i++)
+        inputs[i] = input(random);
+    for (int n = 0; n < NETWORKS; n++)
+        for (int in = 0; in < INPUTS; in++)
+            batch.setInput(n, in, inputs[n * INPUTS + in]);
+
+    double checksum = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int e = 0; e < evaluations; e++)
+        for (int n = 0; n < NETWORKS; n++)
+            checksum += networks[n]->evaluate(&inputs[n * INPUTS])[0];
+    double single = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    double batchChecksum = 0;
+    start = std::chrono::steady_clock::now();
+    for (int e = 0; e < evaluations; e++)
+    {
+        batch.evaluate();
+        for (int n = 0; n < NETWORKS; n++)
+            batchChecksum += batch.getOutput(n, 0);
+    }
+    double batched = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << NETWORKS << " networks (" << INPUTS << " inputs, " << OUTPUTS << " outputs), "
+        << evaluations << " evaluations, " << BatchedElmanNetwork::LANES << " lanes" << std::endl;
+    std::cout << "one by one: " << single << " ms, batched: " << batched << " ms, speed-up "
+        << single / batched << "x" << std::endl;
+    std::cout << "outputs " << (checksum == batchChecksum ? "identical" : "DIFFER") << std::endl;
+
+    for (size_t n = 0; n < networks.size(); n++)
+        delete networks[n];
+    return checksum == batchChecksum ? 0 : 1;
+}
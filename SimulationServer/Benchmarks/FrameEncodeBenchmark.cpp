@@ -0,0 +1,115 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+#include "../Simulation/Simulation.h"
+#include "../Simulation/Entities/CircularEnt.h"
+#include "../Simulation/Entities/KheperaRobot.h"
+#include "../Simulation/Sensors/ProximitySensor.h"
+
+// measures encoding of world frames for visualisers - into a new buffer for every frame, into one reused
+// buffer (as pooled frames of the server are) and in compact encoding; and copying of fields of entities, which
+// is all simulation thread of the server does for frames (see CommunicationManager::publishSnapshot), with
+// applying them to a copy of the world on broadcast thread
+// usage: FrameEncodeBenchmark [frames]
+
+#define ENTITY_AREA     4000 // world area per entity
+#define ROBOT_EVERY     10 // every n-th entity is robot with sensors
+#define SENSORS         8
+
+static Simulation* createWorld(unsigned int entityCount, std::mt19937& random)
+{
+    unsigned int size = (unsigned int) sqrt((double) entityCount * ENTITY_AREA);
+    Simulation* simulation = new Simulation(size, size, true);
+    std::uniform_real_distribution<double> position(20, size - 20);
+
+    for (unsigned int id = 0; id < entityCount; id++)
+    {
+        double x = position(random), y = position(random);
+        if (id % ROBOT_EVERY == 0)
+        {
+            KheperaRobot* robot = simulation->create<KheperaRobot>(id, 100, x, y, 14, 2, 53, 0.0f,
+                &simulation->getArena());
+            simulation->addEntity(robot);
+            for (int i = 0; i < SENSORS; i++)
+                simulation->addSensor(simulation->create<ProximitySensor>(40.0, 0.5f, (float) (i * 2 * M_PI / SENSORS)),
+                    id);
+        }
+        else
+            simulation->addEntity(simulation->create<CircularEnt>(id, 100, false, x, y, 10));
+    }
+
+    return simulation;
+}
+
+static void report(const char* name, int frames, size_t bytes, double milliseconds)
+{
+    std::cout << "  " << name << ": " << milliseconds / frames << " ms / frame, " << frames * 1000.0 / milliseconds
+        << " frames / s, " << bytes / 1000.0 / milliseconds << " MB / s" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    int frames = argc > 1 ? atoi(argv[1]) : 100;
+    std::mt19937 random(42);
+
+    for (unsigned int count = 1000; count <= 100000; count *= 10)
+    {
+        Simulation* simulation = createWorld(count, random);
+        size_t bytes = 0;
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (int i = 0; i < frames; i++)
+        {
+            Buffer buffer;
+            simulation->serialize(buffer);
+            bytes += buffer.getLength();
+        }
+        double fresh = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        Buffer reused;
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < frames; i++)
+        {
+            reused.clear();
+            simulation->serialize(reused);
+        }
+        double pooled = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        Buffer compact;
+        compact.setCompact(true);
+        size_t compactBytes = 0;
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < frames; i++)
+        {
+            compact.clear();
+            simulation->serialize(compact);
+            compactBytes += compact.getLength();
+        }
+        double quantised = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        Simulation* published = simulation->createSnapshot();
+        std::vector<uint8_t> fields;
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < frames; i++)
+            simulation->copyFields(fields);
+        double copied = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < frames; i++)
+            published->applyFields(fields);
+        double applied = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        delete published;
+
+        std::cout << count << " entities, " << bytes / frames << " bytes / frame, " << compactBytes / frames
+            << " bytes / compact frame" << std::endl;
+        report("new buffer", frames, bytes, fresh);
+        report("reused buffer", frames, bytes, pooled);
+        report("compact", frames, compactBytes, quantised);
+        report("copy of fields", frames, fields.size() * frames, copied);
+        report("applied fields", frames, fields.size() * frames, applied);
+        delete simulation;
+    }
+
+    return 0;
+}
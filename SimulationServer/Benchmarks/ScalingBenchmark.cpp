@@ -0,0 +1,68 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+#include "../Simulation/Simulation.h"
+#include "../Simulation/Entities/CircularEnt.h"
+#include "../Simulation/Entities/KheperaRobot.h"
+#include "../Simulation/Sensors/ProximitySensor.h"
+
+// measures simulation step time of worlds with growing number of entities, while their density stays the same
+// usage: ScalingBenchmark [ticks]
+
+#define ENTITY_AREA     4000 // world area per entity
+#define ROBOT_EVERY     10 // every n-th entity is moving robot with sensors
+#define SENSORS         8
+
+static Simulation* createWorld(unsigned int entityCount, std::mt19937& random)
+{
+    unsigned int size = (unsigned int) sqrt((double) entityCount * ENTITY_AREA);
+    Simulation* simulation = new Simulation(size, size, true);
+    std::uniform_real_distribution<double> position(20, size - 20);
+
+    for (unsigned int id = 0; id < entityCount; id++)
+    {
+        double x = position(random), y = position(random);
+        if (id % ROBOT_EVERY == 0)
+        {
+            KheperaRobot* robot = simulation->create<KheperaRobot>(id, 100, x, y, 14, 2, 53, 0.0f,
+                &simulation->getArena());
+            robot->setLeftMotorSpeed(DEFAULT_MAX_MOTOR_SPEED);
+            robot->setRightMotorSpeed(DEFAULT_MAX_MOTOR_SPEED * 0.8);
+            simulation->addEntity(robot);
+            for (int i = 0; i < SENSORS; i++)
+                simulation->addSensor(simulation->create<ProximitySensor>(40.0, 0.5f, (float) (i * 2 * M_PI / SENSORS)),
+                    id);
+        }
+        else
+            simulation->addEntity(simulation->create<CircularEnt>(id, 100, false, x, y, 10));
+    }
+
+    return simulation;
+}
+
+int main(int argc, char** argv)
+{
+    int ticks = argc > 1 ? atoi(argv[1]) : 50;
+    std::mt19937 random(42);
+
+    for (unsigned int count = 10000; count <= 100000; count += 30000)
+    {
+        Simulation* simulation = createWorld(count, random);
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        simulation->fillDistanceMap();
+        double setup = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        start = std::chrono::steady_clock::now();
+        simulation->update((unsigned int) ticks);
+        double total = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        std::cout << count << " entities: setup " << setup << " ms, " << total / ticks << " ms / tick, "
+            << simulation->getNumCollisions() << " contacts in last tick" << std::endl;
+        delete simulation;
+    }
+
+    return 0;
+}
@@ -0,0 +1,168 @@
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <random>
+#include <vector>
+
+#include "../Simulation/Simulation.h"
+#include "../Simulation/Entities/CircularEnt.h"
+#include "../Simulation/Entities/KheperaRobot.h"
+#include "../Simulation/Sensors/ProximitySensor.h"
+
+// entities spawned and despawned while simulation runs must not leave stale cached distances (simulation has to
+// continue as its copy, which has no cache), their memory has to be reused, and destroyed simulations must not
+// leave any heap memory behind
+// usage: ArenaCheck (exits with nonzero status on failure)
+
+#define WORLD_SIZE      400
+#define OBSTACLES       30
+#define ROBOTS          12
+#define SENSORS         8
+#define CYCLES          60
+#define CYCLE_STEPS     10
+#define WARMUP_CYCLES   10
+#define TEARDOWNS       20
+
+// heap blocks allocated by this program and the library, that were not freed yet
+static std::atomic<long> liveAllocations(0);
+
+void* operator new(size_t size)
+{
+    void* ptr = malloc(size > 0 ? size : 1);
+    if (ptr == NULL)
+        throw std::bad_alloc();
+    liveAllocations++;
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept
+{
+    if (ptr != NULL)
+    {
+        liveAllocations--;
+        free(ptr);
+    }
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+    operator delete(ptr);
+}
+
+static Simulation* createScenario(std::mt19937& random)
+{
+    std::uniform_real_distribution<double> position(40, WORLD_SIZE - 40);
+    Simulation* simulation = new Simulation(WORLD_SIZE, WORLD_SIZE, true);
+
+    uint32_t id = 0;
+    for (; id < OBSTACLES; id++)
+        simulation->addEntity(simulation->create<CircularEnt>(id, 1000, id % 2 == 0, position(random), position(random), 10));
+    for (; id < OBSTACLES + ROBOTS; id++)
+    {
+        KheperaRobot* robot = simulation->create<KheperaRobot>(id, 100, position(random), position(random), 14, 2, 53,
+            0.5 * id, &simulation->getArena());
+        robot->setLeftMotorSpeed(DEFAULT_MAX_MOTOR_SPEED);
+        robot->setRightMotorSpeed(DEFAULT_MAX_MOTOR_SPEED * 0.7);
+        simulation->addEntity(robot);
+        for (int i = 0; i < SENSORS; i++)
+            simulation->addSensor(simulation->create<ProximitySensor>(40.0, 0.3, i * 2 * M_PI / SENSORS), id);
+    }
+    simulation->fillDistanceMap();
+    return simulation;
+}
+
+// the oldest obstacle is despawned and a new one is spawned right in front of a robot, in the slot of the old one
+// (every other cycle a robot is respawned too, with sensors)
+static void respawn(Simulation& simulation, std::mt19937& random, uint32_t& nextId, int cycle)
+{
+    std::vector<uint32_t> circles = simulation.getIdsByShape(SimEnt::CIRCLE);
+    std::vector<uint32_t> robots = simulation.getIdsByShape(SimEnt::KHEPERA_ROBOT);
+    simulation.despawnEntity(circles[0]);
+    KheperaRobot& robot = *dynamic_cast<KheperaRobot*>(simulation.getEntity(robots[random() % robots.size()]));
+    BoundingBox box = robot.getBoundingBox();
+    double angle = robot.getDirectionAngle();
+    double x = (box.minX + box.maxX) / 2 + 20 * cos(angle), y = (box.minY + box.maxY) / 2 + 20 * sin(angle);
+    simulation.spawnEntity(simulation.create<CircularEnt>(nextId++, 500, cycle % 3 == 0, x, y, 8));
+
+    if (cycle % 2 == 0)
+    {
+        simulation.despawnEntity(robots[0]);
+        std::uniform_real_distribution<double> position(40, WORLD_SIZE - 40);
+        KheperaRobot* newRobot = simulation.create<KheperaRobot>(nextId, 100, position(random), position(random),
+            14, 2, 53, 0.0, &simulation.getArena());
+        newRobot->setLeftMotorSpeed(DEFAULT_MAX_MOTOR_SPEED * 0.8);
+        newRobot->setRightMotorSpeed(DEFAULT_MAX_MOTOR_SPEED);
+        simulation.spawnEntity(newRobot);
+        for (int i = 0; i < SENSORS; i++)
+            simulation.addSensor(simulation.create<ProximitySensor>(40.0, 0.3, i * 2 * M_PI / SENSORS), nextId);
+        nextId++;
+    }
+}
+
+static bool check(bool condition, const char* message)
+{
+    if (!condition)
+        std::cerr << "FAILED: " << message << std::endl;
+    return condition;
+}
+
+static bool spawnCycles()
+{
+    std::mt19937 random(31);
+    Simulation* simulation = createScenario(random);
+    uint32_t nextId = OBSTACLES + ROBOTS;
+    size_t reservedAfterWarmup = 0;
+    bool passed = true;
+    for (int cycle = 0; cycle < CYCLES && passed; cycle++)
+    {
+        respawn(*simulation, random, nextId, cycle);
+        Simulation* copy = simulation->createSnapshot(); // starts with empty distance cache
+        for (int i = 0; i < CYCLE_STEPS; i++)
+        {
+            simulation->update();
+            copy->update();
+        }
+        passed = check(copy->getStateHash() == simulation->getStateHash(),
+            "simulation with spawned entities diverged from its copy (stale cached distances)");
+        delete copy;
+        if (cycle == WARMUP_CYCLES)
+            reservedAfterWarmup = simulation->getArena().getReservedBytes();
+    }
+    passed &= check(simulation->getArena().getReservedBytes() == reservedAfterWarmup,
+        "arena grows, memory of despawned entities is not reused");
+    delete simulation;
+    return passed;
+}
+
+static void runAndDestroy()
+{
+    std::mt19937 random(37);
+    Simulation* simulation = createScenario(random);
+    uint32_t nextId = OBSTACLES + ROBOTS;
+    for (int cycle = 0; cycle < 3; cycle++)
+    {
+        respawn(*simulation, random, nextId, cycle);
+        simulation->update((unsigned int) CYCLE_STEPS);
+    }
+    Simulation clone(*simulation);
+    clone.update();
+    delete simulation;
+}
+
+// every heap block of simulations (arena blocks included) is freed, when they are destroyed
+static bool teardown()
+{
+    long before = liveAllocations;
+    for (int i = 0; i < TEARDOWNS; i++)
+        runAndDestroy();
+    return check(liveAllocations == before, "destroyed simulations leave memory behind");
+}
+
+int main()
+{
+    bool passed = spawnCycles();
+    passed &= teardown();
+    std::cout << (passed ? "arena: OK" : "arena: FAILED") << std::endl;
+    return passed ? 0 : 1;
+}
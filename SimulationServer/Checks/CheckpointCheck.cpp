@@ -0,0 +1,142 @@
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "../Simulation/Simulation.h"
+#include "../Simulation/Entities/CircularEnt.h"
+#include "../Simulation/Entities/KheperaRobot.h"
+#include "../Simulation/Entities/RectangularEnt.h"
+#include "../Simulation/Sensors/ProximitySensor.h"
+#include "../Simulation/Serialization/Checkpointer.h"
+
+// simulation restored from checkpoint has to continue exactly as the one, that was saved
+// usage: CheckpointCheck (exits with nonzero status on failure)
+
+#define WORLD_SIZE      600
+#define OBSTACLES       10
+#define ROBOTS          8
+#define SENSORS         8
+#define STEPS_BEFORE    60
+#define STEPS_AFTER     120
+#define CHECKPOINT_FILE "CheckpointCheck.chk"
+
+static Simulation* createScenario()
+{
+    std::mt19937 random(11);
+    std::uniform_real_distribution<double> position(50, WORLD_SIZE - 50);
+    Simulation* simulation = new Simulation(WORLD_SIZE, WORLD_SIZE, true);
+    AccumulatorsConfig config;
+    config.enabled = ACC_ALL;
+    config.nearWallDistance = 30;
+    simulation->setAccumulatorsConfig(config);
+
+    uint32_t id = 0;
+    for (; id < OBSTACLES; id++)
+        simulation->addEntity(simulation->create<CircularEnt>(id, 1000, id % 2 == 0, position(random), position(random), 15));
+    // angles, that are not exact in real32 of world file
+    for (; id < OBSTACLES + 3; id++)
+        simulation->addEntity(simulation->create<RectangularEnt>(id, 500, id % 2 == 0, position(random), position(random),
+            40, 20, 0.3 * id));
+
+    for (; id < OBSTACLES + 3 + ROBOTS; id++)
+    {
+        KheperaRobot* robot = simulation->create<KheperaRobot>(id, 100, position(random), position(random), 14, 2, 53,
+            0.1 * id, &simulation->getArena());
+        simulation->addEntity(robot);
+        for (int i = 0; i < SENSORS; i++)
+            simulation->addSensor(simulation->create<ProximitySensor>(40.0, 0.3, i * 2 * M_PI / SENSORS), id);
+    }
+    simulation->fillDistanceMap();
+    return simulation;
+}
+
+// robots avoid obstacles with some noise from random stream of simulation, so that the stream is restored too
+static void step(Simulation& simulation)
+{
+    std::vector<uint32_t> robots = simulation.getIdsByShape(SimEnt::KHEPERA_ROBOT);
+    for (size_t r = 0; r < robots.size(); r++)
+    {
+        KheperaRobot& robot = *dynamic_cast<KheperaRobot*>(simulation.getEntity(robots[r]));
+        float left = 0, right = 0, state;
+        for (int i = 0; i < robot.getSensorCount(); i++)
+        {
+            robot.getSensorState(i, state);
+            if (i < robot.getSensorCount() / 2)
+                left += state;
+            else
+                right += state;
+        }
+        double noise = simulation.getRandom().uniform(-0.5, 0.5);
+        robot.setLeftMotorSpeed(DEFAULT_MAX_MOTOR_SPEED * (1 - 2 * right + noise));
+        robot.setRightMotorSpeed(DEFAULT_MAX_MOTOR_SPEED * (1 - 2 * left - noise));
+    }
+    simulation.update();
+}
+
+static bool check(bool condition, const char* message)
+{
+    if (!condition)
+        std::cerr << "FAILED: " << message << std::endl;
+    return condition;
+}
+
+int main()
+{
+    Simulation* original = createScenario();
+    for (int i = 0; i < STEPS_BEFORE; i++)
+        step(*original);
+    Simulation clone(*original); // clones split random streams, restored simulation has to split the same ones
+
+    {
+        Checkpointer checkpointer(CHECKPOINT_FILE);
+        checkpointer.takeSnapshot(*original);
+    }
+    std::ifstream file(CHECKPOINT_FILE, std::ios::in | std::ios::binary);
+    Simulation* restored = NULL;
+    try
+    {
+        restored = new Simulation(file, true);
+    }
+    catch (const WorldFormatError& error)
+    {
+        std::cerr << "FAILED: checkpoint cannot be read: " << error.what() << std::endl;
+        return 1;
+    }
+    file.close();
+    std::remove(CHECKPOINT_FILE);
+
+    bool passed = check(restored->getStateHash() == original->getStateHash(), "restored state differs");
+    for (int i = 0; i < STEPS_AFTER; i++)
+    {
+        step(*original);
+        step(*restored);
+    }
+    passed &= check(restored->getStateHash() == original->getStateHash(), "restored simulation diverged");
+    Simulation originalClone(*original), restoredClone(*restored);
+    passed &= check(originalClone.getRandom()() == restoredClone.getRandom()(), "clones of restored simulation differ");
+
+    // damaged checkpoint is refused
+    std::ostringstream stream(std::ios::out | std::ios::binary);
+    {
+        Checkpointer checkpointer(CHECKPOINT_FILE);
+        checkpointer.takeSnapshot(*original);
+    }
+    {
+        std::ifstream written(CHECKPOINT_FILE, std::ios::in | std::ios::binary);
+        stream << written.rdbuf();
+    }
+    std::remove(CHECKPOINT_FILE);
+    std::string data = stream.str();
+    data[data.size() / 2] ^= 0x55;
+    std::istringstream damaged(data);
+    std::string payload;
+    bool hasState;
+    passed &= check(!Checkpointer::read(damaged, payload, hasState), "damaged checkpoint was accepted");
+
+    delete original;
+    delete restored;
+    std::cout << (passed ? "checkpoint: OK" : "checkpoint: FAILED") << std::endl;
+    return passed ? 0 : 1;
+}
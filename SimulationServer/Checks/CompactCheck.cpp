@@ -0,0 +1,188 @@
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "../Simulation/Simulation.h"
+#include "../Simulation/Entities/CircularEnt.h"
+#include "../Simulation/Entities/KheperaRobot.h"
+#include "../Simulation/Entities/LinearEnt.h"
+#include "../Simulation/Entities/RectangularEnt.h"
+#include "../Simulation/Sensors/ProximitySensor.h"
+#include "../Simulation/Serialization/Fields.h"
+
+// compact world frames (protocol version 4) decoded as visualisers decode them have to give every field of every
+// entity and sensor within its quantisation step - lengths within half of compact unit (after clamping to
+// the world), angles within half of 2 pi / 65536, fractions within half of 1 / 255, other fields exactly
+// usage: CompactCheck (exits with nonzero status on failure)
+
+#define OBSTACLES       20
+#define ROBOTS          10
+#define SENSORS         8
+#define STEPS           50
+
+// decodes compact fields from FRAME in the order, in which they are visited on the encoded object, and checks
+// them against its members
+class CompactChecker
+{
+    public:
+        CompactChecker(const uint8_t* frame, double unit) : _data(frame), _unit(unit), _passed(true) {}
+
+        bool isWire() const { return true; }
+        template <typename T>
+        void integer(T& member) { _passed &= toNetworkOrder(get<T>()) == member; }
+        void id(uint32_t& member) { integer(member); }
+        template <typename T>
+        void real64(T& member) { length(member); }
+        template <typename T>
+        void real32(T& member) { _passed &= get<float>() == static_cast<float>(member); }
+        template <typename T>
+        void angle(T& member)
+        {
+            double error = remainder(toNetworkOrder(get<uint16_t>()) * (2 * M_PI / 65536) - member, 2 * M_PI);
+            _passed &= fabs(error) <= M_PI / 65536 + 1e-9;
+        }
+        template <typename T>
+        void fraction(T& member)
+        {
+            double expected = member < 0 ? 0 : member > 1 ? 1 : member;
+            _passed &= fabs(get<uint8_t>() / 255.0 - expected) <= 0.5 / 255 + 1e-6;
+        }
+        void point(Point& member)
+        {
+            length(member.getX());
+            length(member.getY());
+        }
+
+        const uint8_t* getEnd() const { return _data; }
+        bool hasPassed() const { return _passed; }
+
+    private:
+        void length(double value)
+        {
+            double expected = value < 0 ? 0 : value > COMPACT_STEPS * _unit ? COMPACT_STEPS * _unit : value;
+            _passed &= fabs(toNetworkOrder(get<uint16_t>()) * _unit - expected) <= _unit / 2 + 1e-9;
+        }
+        template <typename T>
+        T get()
+        {
+            T value;
+            memcpy(&value, _data, sizeof(value));
+            _data += sizeof(value);
+            return value;
+        }
+
+        const uint8_t*  _data;
+        double          _unit;
+        bool            _passed;
+};
+
+static Simulation* createScenario(uint32_t width, uint32_t height, std::mt19937& random)
+{
+    std::uniform_real_distribution<double> x(30, width - 30), y(30, height - 30);
+    Simulation* simulation = new Simulation(width, height, true);
+
+    uint32_t id = 0;
+    for (; id < OBSTACLES; id++)
+    {
+        if (id % 3 == 0)
+            simulation->addEntity(simulation->create<RectangularEnt>(id, 500, id % 2 == 0, x(random), y(random),
+                30, 12, 0.37 * id));
+        else
+            simulation->addEntity(simulation->create<CircularEnt>(id, 1000, id % 2 == 0, x(random), y(random), 9.3));
+    }
+    // partly outside of the world - its coordinates are clamped
+    simulation->addEntity(simulation->create<LinearEnt>(id++, -20.0, 10.0, width + 15.0, height / 2.0));
+    for (; id < OBSTACLES + 1 + ROBOTS; id++)
+    {
+        KheperaRobot* robot = simulation->create<KheperaRobot>(id, 100, x(random), y(random), 14, 2, 53,
+            -3.0 + 0.9 * id, &simulation->getArena());
+        robot->setLeftMotorSpeed(DEFAULT_MAX_MOTOR_SPEED);
+        robot->setRightMotorSpeed(DEFAULT_MAX_MOTOR_SPEED * 0.4);
+        simulation->addEntity(robot);
+        for (int i = 0; i < SENSORS; i++)
+            simulation->addSensor(simulation->create<ProximitySensor>(40.0, 0.3, i * 2 * M_PI / SENSORS), id);
+    }
+    simulation->fillDistanceMap();
+    return simulation;
+}
+
+static bool checkFrame(Simulation& world)
+{
+    Buffer frame(0, PROTOCOL_VERSION);
+    frame.setCompact(true);
+    std::vector<uint32_t> recordOffsets;
+    world.serialize(frame, &recordOffsets);
+    double unit = frame.getCompactUnit();
+
+    const uint8_t* data = frame.getBuffer();
+    uint32_t width, height, count;
+    memcpy(&width, data, sizeof(width));
+    memcpy(&height, data + 4, sizeof(height));
+    memcpy(&count, data + 4 + 4 + 8 + 1, sizeof(count));
+    count = toNetworkOrder(count);
+    bool passed = toNetworkOrder(width) == world.getWorldWidth() && toNetworkOrder(height) == world.getWorldHeight()
+        && count == (uint32_t) world.getEntityCount() && recordOffsets.size() == count
+        && unit == (double) max(world.getWorldWidth(), world.getWorldHeight()) / COMPACT_STEPS;
+
+    const SimEntMap& entities = world.getEntities();
+    size_t record = 0;
+    for (SimEntMap::const_iterator it = entities.begin(); it != entities.end() && passed; it++, record++)
+    {
+        SimEnt* entity = it->second;
+        CompactChecker checker(frame.getBuffer() + recordOffsets[record], unit);
+        uint8_t shape = entity->getShapeID();
+        checker.integer(shape);
+        switch (shape)
+        {
+            case SimEnt::CIRCLE:
+                dynamic_cast<CircularEnt*>(entity)->visitFields(checker);
+                break;
+            case SimEnt::RECTANGLE:
+                dynamic_cast<RectangularEnt*>(entity)->visitFields(checker);
+                break;
+            case SimEnt::LINE:
+                dynamic_cast<LinearEnt*>(entity)->visitFields(checker);
+                break;
+            case SimEnt::KHEPERA_ROBOT:
+            {
+                KheperaRobot* robot = dynamic_cast<KheperaRobot*>(entity);
+                robot->visitFields(checker);
+                uint16_t sensorCount = (uint16_t) robot->getSensorCount();
+                checker.integer(sensorCount);
+                for (int i = 0; i < robot->getSensorCount(); i++)
+                {
+                    uint8_t type = robot->getSensor(i)->getType();
+                    checker.integer(type);
+                    robot->getSensor(i)->visitFields(checker);
+                }
+                break;
+            }
+        }
+        const uint8_t* recordEnd = record + 1 < recordOffsets.size()
+            ? frame.getBuffer() + recordOffsets[record + 1] : frame.getBuffer() + frame.getLength();
+        passed = checker.hasPassed() && checker.getEnd() == recordEnd;
+        if (!passed)
+            std::cerr << "FAILED: compact record of entity " << it->first << " does not match it" << std::endl;
+    }
+    return passed;
+}
+
+int main()
+{
+    static const uint32_t sizes[][2] = { { 600, 400 }, { 300, 2000 }, { 5000, 5000 } };
+    std::mt19937 random(41);
+    bool passed = true;
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]) && passed; i++)
+    {
+        Simulation* world = createScenario(sizes[i][0], sizes[i][1], random);
+        for (int step = 0; step < STEPS && passed; step++)
+        {
+            world->update();
+            passed = checkFrame(*world);
+        }
+        delete world;
+    }
+    std::cout << (passed ? "compact: OK" : "compact: FAILED") << std::endl;
+    return passed ? 0 : 1;
+}
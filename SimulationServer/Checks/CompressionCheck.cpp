@@ -0,0 +1,104 @@
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../Simulation/Simulation.h"
+#include "../Simulation/Entities/CircularEnt.h"
+#include "../Simulation/Serialization/Compression.h"
+
+// data compressed by LZ77 of Compression.h has to decompress to the same bytes, truncated data has to be refused,
+// varints and zigzag values have to round-trip
+// usage: CompressionCheck (exits with nonzero status on failure)
+
+#define RANDOM_LENGTH   5000
+#define LONG_LENGTH     300000 // longer than COMPRESSION_MAX_OFFSET, so that far matches are not used
+#define WORLD_ENTITIES  500
+
+static bool roundTrip(const std::string& data, const char* name)
+{
+    std::string compressed, decompressed;
+    compress(reinterpret_cast<const uint8_t*>(data.data()), data.size(), compressed);
+    bool passed = decompress(reinterpret_cast<const uint8_t*>(compressed.data()), compressed.size(), data.size(),
+        decompressed) && decompressed == data;
+    if (!passed)
+        std::cerr << "FAILED: " << name << " (" << data.size() << " bytes) does not round-trip" << std::endl;
+    return passed;
+}
+
+// every shorter prefix of compressed data and wrong original length are refused
+static bool refusesDamaged(const std::string& data)
+{
+    std::string compressed, decompressed;
+    compress(reinterpret_cast<const uint8_t*>(data.data()), data.size(), compressed);
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(compressed.data());
+    bool passed = !decompress(bytes, compressed.size(), data.size() + 1, decompressed)
+        && !decompress(bytes, compressed.size(), data.size() - 1, decompressed);
+    for (size_t length = 0; length < compressed.size() && passed; length++)
+        passed = !decompress(bytes, length, data.size(), decompressed);
+    if (!passed)
+        std::cerr << "FAILED: damaged compressed data was accepted" << std::endl;
+    return passed;
+}
+
+static bool varints()
+{
+    static const uint64_t values[] = { 0, 1, 0x7F, 0x80, 0x3FFF, 0x4000, 0xFFFFFFFFu, 0xFFFFFFFFFFFFFFFFull };
+    static const int64_t signedValues[] = { 0, 1, -1, 63, -64, 64, -65, INT64_MAX, INT64_MIN };
+    bool passed = true;
+    std::string encoded;
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++)
+        putVarint(encoded, values[i]);
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(encoded.data());
+    const uint8_t* end = data + encoded.size();
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++)
+    {
+        uint64_t value;
+        passed &= getVarint(data, end, value) && value == values[i];
+    }
+    uint64_t value;
+    passed &= data == end && !getVarint(data, end, value);
+    for (size_t i = 0; i < sizeof(signedValues) / sizeof(signedValues[0]); i++)
+        passed &= fromZigzag(toZigzag(signedValues[i])) == signedValues[i];
+    passed &= toZigzag(-1) == 1 && toZigzag(1) == 2;
+    if (!passed)
+        std::cerr << "FAILED: varints" << std::endl;
+    return passed;
+}
+
+static std::string worldFile()
+{
+    std::mt19937 random(17);
+    std::uniform_real_distribution<double> position(20, 980);
+    Simulation world(1000, 1000, true);
+    for (uint32_t id = 0; id < WORLD_ENTITIES; id++)
+        world.addEntity(world.create<CircularEnt>(id, 100, id % 2 == 0, position(random), position(random), 5));
+    std::ostringstream file(std::ios::out | std::ios::binary);
+    world.serialize(file);
+    return file.str();
+}
+
+int main()
+{
+    std::mt19937 random(23);
+    std::string randomData(RANDOM_LENGTH, '\0');
+    for (size_t i = 0; i < randomData.size(); i++)
+        randomData[i] = (char) random();
+    std::string longData;
+    while (longData.size() < LONG_LENGTH)
+        longData += randomData.substr(random() % RANDOM_LENGTH, 1 + random() % 64);
+
+    bool passed = roundTrip("", "empty data") && roundTrip("abc", "data shorter than match");
+    passed &= roundTrip(std::string(1000, 'x'), "repeated byte"); // matches overlap with their own output
+    passed &= roundTrip(randomData, "random data");
+    passed &= roundTrip(randomData + randomData, "repeated random data");
+    passed &= roundTrip(longData, "long data");
+    std::string world = worldFile();
+    passed &= roundTrip(world, "world file");
+    passed &= refusesDamaged(world.substr(0, 2000));
+    passed &= varints();
+
+    std::cout << (passed ? "compression: OK" : "compression: FAILED") << std::endl;
+    return passed ? 0 : 1;
+}
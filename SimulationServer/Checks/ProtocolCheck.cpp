@@ -0,0 +1,257 @@
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include <poll.h>
+
+#include "../CommunicationManager.h"
+#include "../DistrSimulation.h"
+#include "../Simulation/Entities/CircularEnt.h"
+#include "../Simulation/Entities/KheperaRobot.h"
+#include "../Simulation/Sensors/ProximitySensor.h"
+
+// visualisers of protocol version 3 (and compact ones of version 4) have to rebuild every step of the world exactly
+// from keyframes and deltas relative to the snapshots, that they acknowledged - also when some acks are missing,
+// old or refer to snapshots, that were not sent; the check runs the server on port 6020 of this machine
+// usage: ProtocolCheck (exits with nonzero status on failure)
+
+#define WORLD_SIZE      600
+#define OBSTACLES       10
+#define ROBOTS          8
+#define SENSORS         8
+#define STEPS           150
+#define SPAWN_STEP      70
+#define FRAME_TIMEOUT   200 // ms, steps with keyframe on the way get no frame
+
+// records of entities in world frame of one step, by IDs
+typedef std::map<uint32_t, std::string> Records;
+
+// world frame with its records, as the server encodes it
+struct ExpectedWorld
+{
+    std::string     frame;
+    Records         records;
+    double          time;
+};
+
+static uint32_t readBigEndian(const uint8_t* data)
+{
+    return (uint32_t) data[0] << 24 | (uint32_t) data[1] << 16 | (uint32_t) data[2] << 8 | data[3];
+}
+
+static ExpectedWorld encode(const Simulation& world, bool isCompact)
+{
+    Buffer buffer(0, PROTOCOL_VERSION);
+    buffer.setCompact(isCompact);
+    std::vector<uint32_t> offsets;
+    world.serialize(buffer, &offsets);
+    ExpectedWorld expected;
+    expected.frame.assign(reinterpret_cast<const char*>(buffer.getBuffer()), buffer.getLength());
+    for (size_t i = 0; i < offsets.size(); i++)
+    {
+        size_t end = i + 1 < offsets.size() ? offsets[i + 1] : buffer.getLength();
+        expected.records[readBigEndian(buffer.getBuffer() + offsets[i] + 1)] =
+            expected.frame.substr(offsets[i], end - offsets[i]);
+    }
+    expected.time = world.getTime();
+    return expected;
+}
+
+// visualiser rebuilding the world from frames and checking it against the expected one
+class Visualiser
+{
+    public:
+        Visualiser(uint8_t protocolVersion, bool isCompact)
+            : _socket(INVALID_SOCKET), _protocolVersion(protocolVersion), _isCompact(isCompact), _keyframes(0),
+            _deltas(0), _passed(true) {}
+        ~Visualiser() { if (_socket != INVALID_SOCKET) closeSocket(_socket); }
+
+        bool connect()
+        {
+            sockaddr_in address;
+            memset(&address, 0, sizeof(address));
+            address.sin_family = AF_INET;
+            address.sin_port = htons(6020);
+            address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            _socket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+            if (_socket == INVALID_SOCKET || ::connect(_socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+                return false;
+            uint8_t handshake[3] = { PROTOCOL_VERSION_FLAG | CommunicationManager::TYPE_ID_VISUALISER, _protocolVersion,
+                (uint8_t) (_isCompact ? CAPABILITY_COMPACT_FRAMES : 0) };
+            int length = _protocolVersion < PROTOCOL_VERSION_4 ? 2 : 3;
+            uint8_t answer[2] = { 0, 0 };
+            return sendAll(_socket, handshake, length) && receiveAll(_socket, answer, length - 1)
+                && answer[0] == _protocolVersion && (length < 3 || answer[1] == handshake[2]);
+        }
+
+        // reads frames up to the one of step TICK (if it comes) and acknowledges them
+        void receive(uint32_t tick, const std::vector<ExpectedWorld>& expected)
+        {
+            pollfd event = { _socket, POLLIN, 0 };
+            while (_passed && poll(&event, 1, FRAME_TIMEOUT) > 0)
+            {
+                uint32_t frameTick = readFrame(expected);
+                if (!_passed || frameTick == tick)
+                    return;
+            }
+        }
+
+        int getKeyframeCount() const { return _keyframes; }
+        int getDeltaCount() const { return _deltas; }
+        bool hasPassed() const { return _passed; }
+
+    private:
+        bool check(bool condition, const char* message)
+        {
+            if (!condition && _passed)
+                std::cerr << "FAILED: " << (_isCompact ? "compact " : "") << "visualiser: " << message << std::endl;
+            _passed &= condition;
+            return condition;
+        }
+
+        uint32_t readFrame(const std::vector<ExpectedWorld>& expected)
+        {
+            uint8_t header[CommunicationManager::FRAME_HEADER_SIZE];
+            if (!check(receiveAll(_socket, header, sizeof(header)), "connection closed"))
+                return 0;
+            uint32_t tick = readBigEndian(header + 1), baseTick = readBigEndian(header + 5);
+            std::string payload(readBigEndian(header + 9), '\0');
+            if (!check(receiveAll(_socket, &payload[0], (int) payload.size()), "connection closed")
+                || !check(tick < expected.size(), "frame of step, which was not published"))
+                return 0;
+            const ExpectedWorld& world = expected[tick];
+
+            if (header[0] == CommunicationManager::FRAME_TYPE_KEYFRAME)
+            {
+                _keyframes++;
+                if (!check(baseTick == tick && payload.compare(0, world.frame.size(), world.frame) == 0,
+                    "keyframe differs from the world"))
+                    return 0;
+                _known[tick] = world.records;
+            }
+            else if (check(header[0] == CommunicationManager::FRAME_TYPE_DELTA, "unknown frame type"))
+            {
+                _deltas++;
+                // base has to be a snapshot, which was acknowledged
+                if (!check(_acked.count(baseTick) > 0 && _known.count(baseTick) > 0, "delta to unknown snapshot"))
+                    return 0;
+                Records records = _known[baseTick];
+                double time;
+                memcpy(&time, payload.data(), sizeof(time));
+                uint32_t count = readBigEndian(reinterpret_cast<const uint8_t*>(payload.data()) + sizeof(time));
+                size_t position = sizeof(time) + sizeof(count);
+                for (uint32_t i = 0; i < count && _passed; i++)
+                {
+                    uint32_t id = readBigEndian(reinterpret_cast<const uint8_t*>(payload.data()) + position + 1);
+                    Records::const_iterator record = world.records.find(id);
+                    if (check(record != world.records.end() && position + record->second.size() <= payload.size(),
+                        "delta has record of unknown entity"))
+                    {
+                        records[id] = payload.substr(position, record->second.size());
+                        position += record->second.size();
+                    }
+                }
+                if (!check(time == world.time && records == world.records, "world rebuilt from delta differs"))
+                    return 0;
+                _known[tick] = records;
+            }
+
+            // some acks are missing, some are late and some refer to steps, that the server has not sent yet
+            if (tick % 7 != 3 || header[0] == CommunicationManager::FRAME_TYPE_KEYFRAME)
+            {
+                acknowledge(tick);
+                _acked.insert(tick);
+            }
+            if (tick % 5 == 0)
+                acknowledge(tick + 3);
+            if (tick % 11 == 0 && tick > 20)
+                acknowledge(tick - 20);
+            return tick;
+        }
+
+        void acknowledge(uint32_t tick)
+        {
+            uint8_t command[5] = { VisualiserCommand::FRAME_ACK_COMMAND_ID, (uint8_t) (tick >> 24),
+                (uint8_t) (tick >> 16), (uint8_t) (tick >> 8), (uint8_t) tick };
+            check(sendAll(_socket, command, sizeof(command)), "ack cannot be sent");
+        }
+
+        SOCKET                      _socket;
+        uint8_t                     _protocolVersion;
+        bool                        _isCompact;
+        std::map<uint32_t, Records> _known; // worlds of applied frames
+        std::set<uint32_t>          _acked;
+        int                         _keyframes;
+        int                         _deltas;
+        bool                        _passed;
+};
+
+static void createScenario(Simulation& simulation)
+{
+    std::mt19937 random(43);
+    std::uniform_real_distribution<double> position(50, WORLD_SIZE - 50);
+    uint32_t id = 0;
+    for (; id < OBSTACLES; id++)
+        simulation.addEntity(simulation.create<CircularEnt>(id, 1000, id % 2 == 0, position(random), position(random), 15));
+    for (; id < OBSTACLES + ROBOTS; id++)
+    {
+        KheperaRobot* robot = simulation.create<KheperaRobot>(id, 100, position(random), position(random), 14, 2, 53,
+            0.1 * id, &simulation.getArena());
+        // half of robots stands, so that deltas do not carry all entities
+        robot->setLeftMotorSpeed(id % 2 == 0 ? DEFAULT_MAX_MOTOR_SPEED : 0);
+        robot->setRightMotorSpeed(id % 2 == 0 ? DEFAULT_MAX_MOTOR_SPEED * 0.7 : 0);
+        simulation.addEntity(robot);
+        for (int i = 0; i < SENSORS; i++)
+            simulation.addSensor(simulation.create<ProximitySensor>(40.0, 0.3, i * 2 * M_PI / SENSORS), id);
+    }
+    simulation.fillDistanceMap();
+}
+
+int main()
+{
+    DistrSimulation simulation(WORLD_SIZE, WORLD_SIZE, true);
+    createScenario(simulation);
+    CommunicationManager server(&simulation);
+    if (!initSockets() || !server.init())
+    {
+        std::cerr << "FAILED: server cannot listen on port 6020" << std::endl;
+        return 1;
+    }
+    std::thread serverThread(&CommunicationManager::runServerLoop, &server);
+
+    Visualiser visualiser(PROTOCOL_VERSION_3, false), compactVisualiser(PROTOCOL_VERSION_4, true);
+    bool passed = visualiser.connect() && compactVisualiser.connect();
+    if (!passed)
+        std::cerr << "FAILED: handshake" << std::endl;
+
+    // snapshots are published by this thread as simulation thread of the server does it
+    std::vector<ExpectedWorld> expected, expectedCompact;
+    for (uint32_t tick = 0; tick < STEPS && passed; tick++)
+    {
+        simulation.Simulation::update();
+        if (tick == SPAWN_STEP)
+            simulation.spawnEntity(simulation.create<CircularEnt>(1000, 100, true, 30.0, 30.0, 10));
+        expected.push_back(encode(simulation, false));
+        expectedCompact.push_back(encode(simulation, true));
+        server.publishSnapshot(simulation);
+        visualiser.receive(tick, expected);
+        compactVisualiser.receive(tick, expectedCompact);
+        passed = visualiser.hasPassed() && compactVisualiser.hasPassed();
+    }
+    // the first keyframe and the one after spawn, deltas for most of other steps
+    passed &= visualiser.getKeyframeCount() >= 2 && visualiser.getDeltaCount() > STEPS / 2
+        && compactVisualiser.getKeyframeCount() >= 2 && compactVisualiser.getDeltaCount() > STEPS / 2;
+    if (!passed)
+        std::cerr << "FAILED: keyframes " << visualiser.getKeyframeCount() << ", " << compactVisualiser.getKeyframeCount()
+            << ", deltas " << visualiser.getDeltaCount() << ", " << compactVisualiser.getDeltaCount() << std::endl;
+
+    server.requestStop();
+    serverThread.join();
+    cleanupSockets();
+    std::cout << (passed ? "protocol: OK" : "protocol: FAILED") << std::endl;
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,128 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../Simulation/Simulation.h"
+#include "../Simulation/Entities/CircularEnt.h"
+#include "../Simulation/Entities/KheperaRobot.h"
+#include "../Simulation/Entities/LinearEnt.h"
+#include "../Simulation/Entities/RectangularEnt.h"
+#include "../Simulation/Sensors/ProximitySensor.h"
+#include "../Simulation/Serialization/Fields.h"
+
+// file records of every entity type and sensor written by BinaryWriter have to be read back by BinaryReader
+// (through constructors reading world files) in both file format versions, and so does the whole world;
+// text world files have to be parsed as before
+// usage: SerializationCheck (exits with nonzero status on failure)
+
+template <typename T>
+static std::string encode(T& object, uint16_t formatVersion)
+{
+    FieldSize size(formatVersion, false);
+    object.visitFields(size);
+    std::vector<uint8_t> data(size.getSize() + MAX_RECORD_SIZE);
+    BinaryWriter writer(data.data(), formatVersion, false);
+    object.visitFields(writer);
+    return std::string(data.begin(), data.begin() + (writer.getEnd() - data.data()));
+}
+
+template <typename T>
+static bool roundTrip(T& object, uint16_t formatVersion, const char* name)
+{
+    std::string record = encode(object, formatVersion);
+    FieldSize size(formatVersion, false);
+    object.visitFields(size);
+    std::istringstream file(record);
+    T copy(file, formatVersion);
+    bool passed = (int) record.size() == size.getSize() && file && file.peek() == EOF
+        && encode(copy, formatVersion) == record;
+    if (!passed)
+        std::cerr << "FAILED: " << name << " in format version " << formatVersion << std::endl;
+    return passed;
+}
+
+// sensors have the same record in every version
+static bool roundTrip(ProximitySensor& sensor)
+{
+    std::string record = encode(sensor, WORLD_FORMAT_VERSION);
+    std::istringstream file(record);
+    ProximitySensor copy(file);
+    bool passed = file && file.peek() == EOF && encode(copy, WORLD_FORMAT_VERSION) == record;
+    if (!passed)
+        std::cerr << "FAILED: proximity sensor" << std::endl;
+    return passed;
+}
+
+static bool worldRoundTrip()
+{
+    Simulation world(400, 300, true);
+    world.addEntity(world.create<CircularEnt>(1, 100, true, 50.25, 60.5, 12));
+    world.addEntity(world.create<RectangularEnt>(2, 200, false, 100, 100, 40, 20, 0.5));
+    world.addEntity(world.create<LinearEnt>(3, 10, 10, 390, 20));
+    KheperaRobot* robot = world.create<KheperaRobot>(4, 100, 200.0, 150.0, 14, 2, 53, 1.25, &world.getArena());
+    world.addEntity(robot);
+    for (int i = 0; i < 8; i++)
+        world.addSensor(world.create<ProximitySensor>(40.0, 0.5, i * 0.75), 4);
+    world.update(3u);
+
+    std::ostringstream file(std::ios::out | std::ios::binary);
+    world.serialize(file);
+    std::istringstream input(file.str(), std::ios::in | std::ios::binary);
+    Simulation copy(input, true);
+    std::ostringstream copyFile(std::ios::out | std::ios::binary);
+    copy.serialize(copyFile);
+    bool passed = copyFile.str() == file.str() && copy.getEntityCount() == world.getEntityCount();
+    if (!passed)
+        std::cerr << "FAILED: binary world file" << std::endl;
+    return passed;
+}
+
+static bool readsText(const std::string& text)
+{
+    std::istringstream file(text);
+    try
+    {
+        Simulation world(file, false);
+        return true;
+    }
+    catch (const WorldFormatError&)
+    {
+        return false;
+    }
+}
+
+// numbers with explicit plus sign are valid, versions of world files outside 1..WORLD_FORMAT_VERSION are not
+static bool textWorlds()
+{
+    bool passed = readsText("WORLD 2 +500 400 +0.5 1 1\n1 +3 1 +20 200 300 30\n");
+    passed &= !readsText("500 400 +-0.5 1 0\n") && !readsText("500 400 + 1 0\n");
+    passed &= !readsText("WORLD 0 500 400 0 1 0\n") && !readsText("WORLD 3 500 400 0 1 0\n");
+    if (!passed)
+        std::cerr << "FAILED: text world file" << std::endl;
+    return passed;
+}
+
+int main()
+{
+    bool passed = true;
+    for (uint16_t formatVersion = 1; formatVersion <= WORLD_FORMAT_VERSION; formatVersion++)
+    {
+        // IDs fit into 16 bits of version 1, angles are exact in real32
+        CircularEnt circle(300, 100, true, 10.125, 20.25, 7.5);
+        RectangularEnt rectangle(301, 200, false, 30.5, 40.75, 12, 6, 0.25);
+        LinearEnt line(302, 1.5, 2.5, 100.25, 200.125);
+        KheperaRobot robot(303, 100, 50.5, 60.25, 14, 2, 53, 0.75);
+        passed &= roundTrip(circle, formatVersion, "circle");
+        passed &= roundTrip(rectangle, formatVersion, "rectangle");
+        passed &= roundTrip(line, formatVersion, "line");
+        passed &= roundTrip(robot, formatVersion, "robot");
+    }
+    ProximitySensor sensor(40.0, 0.5, 1.5);
+    passed &= roundTrip(sensor);
+    passed &= worldRoundTrip();
+    passed &= textWorlds();
+
+    std::cout << (passed ? "serialization: OK" : "serialization: FAILED") << std::endl;
+    return passed ? 0 : 1;
+}
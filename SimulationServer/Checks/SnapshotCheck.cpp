@@ -0,0 +1,102 @@
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "../Simulation/Simulation.h"
+#include "../Simulation/Entities/CircularEnt.h"
+#include "../Simulation/Entities/KheperaRobot.h"
+#include "../Simulation/Entities/RectangularEnt.h"
+#include "../Simulation/Sensors/ProximitySensor.h"
+
+// copy of the world published by the server with fields of entities (see CommunicationManager::publishSnapshot)
+// has to be encoded into the same frames as the world itself, in every protocol variant
+// usage: SnapshotCheck (exits with nonzero status on failure)
+
+#define WORLD_SIZE      600
+#define OBSTACLES       10
+#define ROBOTS          8
+#define SENSORS         8
+#define STEPS           100
+#define SPAWN_STEP      40
+
+static Simulation* createScenario(std::mt19937& random)
+{
+    std::uniform_real_distribution<double> position(50, WORLD_SIZE - 50);
+    Simulation* simulation = new Simulation(WORLD_SIZE, WORLD_SIZE, true);
+
+    uint32_t id = 0;
+    for (; id < OBSTACLES; id++)
+        simulation->addEntity(simulation->create<CircularEnt>(id, 1000, id % 2 == 0, position(random), position(random), 15));
+    for (; id < OBSTACLES + 3; id++)
+        simulation->addEntity(simulation->create<RectangularEnt>(id, 500, id % 2 == 0, position(random), position(random),
+            40, 20, 0.3 * id));
+
+    for (; id < OBSTACLES + 3 + ROBOTS; id++)
+    {
+        KheperaRobot* robot = simulation->create<KheperaRobot>(id, 100, position(random), position(random), 14, 2, 53,
+            0.1 * id, &simulation->getArena());
+        simulation->addEntity(robot);
+        for (int i = 0; i < SENSORS; i++)
+            simulation->addSensor(simulation->create<ProximitySensor>(40.0, 0.3, i * 2 * M_PI / SENSORS), id);
+    }
+    simulation->fillDistanceMap();
+    return simulation;
+}
+
+static bool sameFrames(const Simulation& world, const Simulation& published, uint8_t protocolVersion, bool isCompact)
+{
+    Buffer worldFrame(0, protocolVersion), publishedFrame(0, protocolVersion);
+    worldFrame.setCompact(isCompact);
+    publishedFrame.setCompact(isCompact);
+    world.serialize(worldFrame);
+    published.serialize(publishedFrame);
+    return worldFrame.getLength() == publishedFrame.getLength()
+        && memcmp(worldFrame.getBuffer(), publishedFrame.getBuffer(), worldFrame.getLength()) == 0;
+}
+
+int main()
+{
+    std::mt19937 random(5);
+    std::uniform_real_distribution<double> speed(-DEFAULT_MAX_MOTOR_SPEED, DEFAULT_MAX_MOTOR_SPEED);
+    Simulation* world = createScenario(random);
+    Simulation* published = world->createSnapshot();
+    uint64_t publishedVersion = world->getEntitiesVersion();
+    std::vector<uint8_t> fields;
+    bool passed = true;
+
+    for (int step = 0; step < STEPS && passed; step++)
+    {
+        std::vector<uint32_t> robots = world->getIdsByShape(SimEnt::KHEPERA_ROBOT);
+        for (size_t i = 0; i < robots.size(); i++)
+        {
+            KheperaRobot* robot = dynamic_cast<KheperaRobot*>(world->getEntity(robots[i]));
+            robot->setLeftMotorSpeed(speed(random));
+            robot->setRightMotorSpeed(speed(random));
+        }
+        world->update();
+        if (step == SPAWN_STEP)
+            world->spawnEntity(world->create<CircularEnt>(1000, 100, true, 30.0, 30.0, 10));
+
+        // as the server does it - the whole world is copied only after entities were added or removed
+        if (world->getEntitiesVersion() != publishedVersion)
+        {
+            delete published;
+            published = world->createSnapshot();
+            publishedVersion = world->getEntitiesVersion();
+        }
+        world->copyFields(fields);
+        published->applyFields(fields);
+
+        passed = sameFrames(*world, *published, PROTOCOL_VERSION_1, false)
+            && sameFrames(*world, *published, PROTOCOL_VERSION, false)
+            && sameFrames(*world, *published, PROTOCOL_VERSION, true);
+        if (!passed)
+            std::cerr << "FAILED: published world encodes differently after step " << step << std::endl;
+    }
+
+    delete published;
+    delete world;
+    std::cout << (passed ? "snapshot: OK" : "snapshot: FAILED") << std::endl;
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,107 @@
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "../Simulation/Simulation.h"
+#include "../Simulation/Entities/CircularEnt.h"
+#include "../Simulation/Entities/KheperaRobot.h"
+#include "../Simulation/Entities/RectangularEnt.h"
+#include "../Simulation/Sensors/ProximitySensor.h"
+
+// state after every step must not depend on the number of threads stepping the simulation
+// usage: ThreadCountCheck (exits with nonzero status on failure)
+
+#define WORLD_SIZE      800
+#define OBSTACLES       40
+#define ROBOTS          40
+#define SENSORS         8
+#define STEPS           200
+#define HASH_EVERY      20
+
+static Simulation* createScenario()
+{
+    std::mt19937 random(3);
+    std::uniform_real_distribution<double> position(50, WORLD_SIZE - 50);
+    Simulation* simulation = new Simulation(WORLD_SIZE, WORLD_SIZE, true);
+    AccumulatorsConfig config;
+    config.enabled = ACC_ALL;
+    config.nearWallDistance = 30;
+    simulation->setAccumulatorsConfig(config);
+
+    uint32_t id = 0;
+    for (; id < OBSTACLES; id++)
+    {
+        if (id % 4 == 0)
+            simulation->addEntity(simulation->create<RectangularEnt>(id, 500, true, position(random), position(random),
+                40, 20, 0.2 * id));
+        else
+            simulation->addEntity(simulation->create<CircularEnt>(id, 1000, id % 2 == 0, position(random),
+                position(random), 15));
+    }
+    for (; id < OBSTACLES + ROBOTS; id++)
+    {
+        KheperaRobot* robot = simulation->create<KheperaRobot>(id, 100, position(random), position(random), 14, 2, 53,
+            0.1 * id, &simulation->getArena());
+        simulation->addEntity(robot);
+        for (int i = 0; i < SENSORS; i++)
+            simulation->addSensor(simulation->create<ProximitySensor>(40.0, 0.5, i * 2 * M_PI / SENSORS), id);
+    }
+    simulation->fillDistanceMap();
+    return simulation;
+}
+
+// robots avoid obstacles, with some noise from random stream of the simulation
+static void step(Simulation& simulation)
+{
+    std::vector<uint32_t> robots = simulation.getIdsByShape(SimEnt::KHEPERA_ROBOT);
+    for (size_t r = 0; r < robots.size(); r++)
+    {
+        KheperaRobot& robot = *dynamic_cast<KheperaRobot*>(simulation.getEntity(robots[r]));
+        float left = 0, right = 0, state;
+        for (int i = 0; i < robot.getSensorCount(); i++)
+        {
+            robot.getSensorState(i, state);
+            if (i < robot.getSensorCount() / 2)
+                left += state;
+            else
+                right += state;
+        }
+        double noise = simulation.getRandom().uniform(-0.5, 0.5);
+        robot.setLeftMotorSpeed(DEFAULT_MAX_MOTOR_SPEED * (1 - 2 * right + noise));
+        robot.setRightMotorSpeed(DEFAULT_MAX_MOTOR_SPEED * (1 - 2 * left - noise));
+    }
+    simulation.update();
+}
+
+// state hashes of the run every HASH_EVERY steps
+static std::vector<uint64_t> run(int threadCount)
+{
+    Simulation* simulation = createScenario();
+    simulation->setThreadCount(threadCount);
+    std::vector<uint64_t> hashes;
+    for (int i = 1; i <= STEPS; i++)
+    {
+        step(*simulation);
+        if (i % HASH_EVERY == 0)
+            hashes.push_back(simulation->getStateHash());
+    }
+    delete simulation;
+    return hashes;
+}
+
+int main()
+{
+    static const int threadCounts[] = { 2, 8 };
+    std::vector<uint64_t> expected = run(1);
+    bool passed = true;
+    for (size_t i = 0; i < sizeof(threadCounts) / sizeof(threadCounts[0]); i++)
+    {
+        if (run(threadCounts[i]) != expected)
+        {
+            std::cerr << "FAILED: " << threadCounts[i] << " threads give different state than 1 thread" << std::endl;
+            passed = false;
+        }
+    }
+    std::cout << (passed ? "thread count: OK" : "thread count: FAILED") << std::endl;
+    return passed ? 0 : 1;
+}
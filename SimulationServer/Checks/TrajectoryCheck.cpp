@@ -0,0 +1,187 @@
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <vector>
+
+#include "../Simulation/Simulation.h"
+#include "../Simulation/Entities/CircularEnt.h"
+#include "../Simulation/Entities/KheperaRobot.h"
+#include "../Simulation/Sensors/ProximitySensor.h"
+#include "../Simulation/Serialization/TrajectoryReader.h"
+
+// trajectory replayed by TrajectoryReader has to match the recorded simulation within quantisation steps - read
+// step by step, after seeks and from a file of killed recorder (without index)
+// usage: TrajectoryCheck (exits with nonzero status on failure)
+
+#define WORLD_SIZE          600
+#define OBSTACLES           10
+#define ROBOTS              8
+#define SENSORS             8
+#define STEPS               300
+#define KEYFRAME_INTERVAL   50
+#define SPAWN_STEP          120
+#define SEEKS               20
+#define TRAJECTORY_FILE     "TrajectoryCheck.trj"
+#define TRUNCATED_FILE      "TrajectoryCheck.cut.trj"
+
+// recorded state of entity after one step
+struct Pose
+{
+    uint32_t            id;
+    double              x; // lower left corner of bounding box
+    double              y;
+    double              angle; // of robots
+    std::vector<float>  sensors;
+};
+
+struct Step
+{
+    double              time;
+    std::vector<Pose>   poses;
+};
+
+static Simulation* createScenario()
+{
+    std::mt19937 random(19);
+    std::uniform_real_distribution<double> position(50, WORLD_SIZE - 50);
+    Simulation* simulation = new Simulation(WORLD_SIZE, WORLD_SIZE, true);
+
+    uint32_t id = 0;
+    for (; id < OBSTACLES; id++)
+        simulation->addEntity(simulation->create<CircularEnt>(id, 1000, id % 2 == 0, position(random), position(random), 15));
+    for (; id < OBSTACLES + ROBOTS; id++)
+    {
+        KheperaRobot* robot = simulation->create<KheperaRobot>(id, 100, position(random), position(random), 14, 2, 53,
+            0.1 * id, &simulation->getArena());
+        robot->setLeftMotorSpeed(DEFAULT_MAX_MOTOR_SPEED * (0.5 + 0.05 * id));
+        robot->setRightMotorSpeed(DEFAULT_MAX_MOTOR_SPEED * 0.6);
+        simulation->addEntity(robot);
+        for (int i = 0; i < SENSORS; i++)
+            simulation->addSensor(simulation->create<ProximitySensor>(40.0, 0.3, i * 2 * M_PI / SENSORS), id);
+    }
+    simulation->fillDistanceMap();
+    return simulation;
+}
+
+static Step takeStep(Simulation& simulation)
+{
+    Step step;
+    step.time = simulation.getTime();
+    const SimEntMap& entities = simulation.getEntities();
+    for (SimEntMap::const_iterator it = entities.begin(); it != entities.end(); it++)
+    {
+        Pose pose;
+        BoundingBox box = it->second->getBoundingBox();
+        pose.id = it->first;
+        pose.x = box.minX;
+        pose.y = box.minY;
+        pose.angle = 0;
+        if (it->second->getShapeID() == SimEnt::KHEPERA_ROBOT)
+        {
+            KheperaRobot* robot = dynamic_cast<KheperaRobot*>(it->second);
+            pose.angle = robot->getDirectionAngle();
+            for (int i = 0; i < robot->getSensorCount(); i++)
+            {
+                float state = 0;
+                robot->getSensorState(i, state);
+                pose.sensors.push_back(state);
+            }
+        }
+        step.poses.push_back(pose);
+    }
+    return step;
+}
+
+// replayed world matches the recorded step within quantisation
+static bool sameStep(TrajectoryReader& reader, const Step& expected)
+{
+    Step replayed = takeStep(*reader.getSimulation());
+    if (replayed.time != expected.time || replayed.poses.size() != expected.poses.size())
+        return false;
+    for (size_t i = 0; i < expected.poses.size(); i++)
+    {
+        const Pose& a = expected.poses[i];
+        const Pose& b = replayed.poses[i];
+        if (a.id != b.id || fabs(a.x - b.x) > DEFAULT_POSITION_STEP || fabs(a.y - b.y) > DEFAULT_POSITION_STEP
+            || fabs(a.angle - b.angle) > DEFAULT_ANGLE_STEP || a.sensors.size() != b.sensors.size())
+            return false;
+        for (size_t s = 0; s < a.sensors.size(); s++)
+        {
+            if (fabs(a.sensors[s] - b.sensors[s]) > 1.0 / 255)
+                return false;
+        }
+    }
+    return true;
+}
+
+static bool check(bool condition, const char* message)
+{
+    if (!condition)
+        std::cerr << "FAILED: " << message << std::endl;
+    return condition;
+}
+
+int main()
+{
+    std::vector<Step> steps;
+    {
+        Simulation* simulation = createScenario();
+        TrajectoryRecorder recorder(TRAJECTORY_FILE, KEYFRAME_INTERVAL);
+        if (!check(recorder.isOpen(), "trajectory file cannot be created"))
+            return 1;
+        for (int i = 0; i < STEPS; i++)
+        {
+            simulation->update();
+            if (i == SPAWN_STEP) // new set of entities starts new keyframe
+                simulation->spawnEntity(simulation->create<CircularEnt>(1000, 100, true, 30.0, 30.0, 10));
+            recorder.stepFinished(*simulation);
+            steps.push_back(takeStep(*simulation));
+        }
+        delete simulation;
+    }
+
+    TrajectoryReader reader;
+    bool passed = check(reader.open(TRAJECTORY_FILE), "trajectory cannot be opened");
+    passed &= check(reader.getStepCount() == STEPS, "wrong number of steps");
+    passed &= check(reader.getKeyframes().size() == (STEPS + KEYFRAME_INTERVAL - 1) / KEYFRAME_INTERVAL + 1,
+        "wrong number of keyframes");
+    for (uint32_t tick = 0; tick < STEPS && passed; tick++)
+    {
+        passed = check(reader.next() && reader.getTick() == tick, "step cannot be read")
+            && check(sameStep(reader, steps[tick]), "replayed step differs from the recorded one");
+    }
+    passed &= check(!reader.next(), "step after the end was read");
+
+    std::mt19937 random(29);
+    for (int i = 0; i < SEEKS && passed; i++)
+    {
+        uint32_t tick = random() % STEPS;
+        passed = check(reader.seek(tick) && reader.getTick() == tick, "seek failed")
+            && check(sameStep(reader, steps[tick]), "step differs after seek");
+    }
+    passed &= check(!reader.seek(STEPS), "seek after the end succeeded");
+    reader.close();
+
+    // recording of killed server has no index, reader rebuilds it from records, that were written whole
+    {
+        std::ifstream file(TRAJECTORY_FILE, std::ios::in | std::ios::binary);
+        std::ostringstream data(std::ios::out | std::ios::binary);
+        data << file.rdbuf();
+        std::string cut = data.str().substr(0, data.str().size() * 2 / 3);
+        std::ofstream truncated(TRUNCATED_FILE, std::ios::out | std::ios::binary);
+        truncated.write(cut.data(), cut.size());
+    }
+    passed &= check(reader.open(TRUNCATED_FILE) && reader.getStepCount() > 0 && reader.getStepCount() < STEPS,
+        "truncated trajectory cannot be opened");
+    uint32_t last = reader.getStepCount() - 1;
+    passed &= check(reader.seek(last) && sameStep(reader, steps[last]), "last step of truncated trajectory differs");
+    reader.close();
+
+    std::remove(TRAJECTORY_FILE);
+    std::remove(TRUNCATED_FILE);
+    std::cout << (passed ? "trajectory: OK" : "trajectory: FAILED") << std::endl;
+    return passed ? 0 : 1;
+}
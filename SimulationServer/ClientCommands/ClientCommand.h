@@ -2,9 +2,10 @@
 #define CLIENT_COMMAND_H
 
 #include <stdint.h>
-#include <WinSock2.h>
+#include "../Network/Socket.h"
 
 #include "../DistrSimulation.h"
+#include "../Simulation/Buffer.h"
 #include "../Simulation/Entities/SimEnt.h"
 
 class DistrSimulation;
@@ -16,6 +17,9 @@ class ClientCommand
 		static const uint16_t ERROR_CODE_SUCCESS = 0;
         static const uint16_t ERROR_CODE_INVALID_ENTITY = 1;
         static const uint16_t ERROR_CODE_INVALID_MOTOR_ID = 2;
+        static const uint16_t ERROR_CODE_NOT_REPLAY = 3;
+        static const uint16_t ERROR_CODE_INVALID_TICK = 4;
+        static const uint16_t ERROR_CODE_QUEUE_FULL = 5;
 
 		// valid controller commands with IDs
 		static const uint8_t  SINGLE_MOTOR_SPEED_CHANGE_COMMAND_ID = 0;
@@ -23,7 +27,10 @@ class ClientCommand
 
 		ClientCommand(uint8_t id) : _id(id) {}
 
-		virtual uint16_t execute(SimEnt& entity, DistrSimulation& sim, SOCKET sock) = 0;
+		// bytes following COMMAND_ID - command is executed, when all of them were received,
+		// and reads them from PAYLOAD
+		virtual size_t getPayloadLength() const = 0;
+		virtual uint16_t execute(SimEnt& entity, DistrSimulation& sim, BufferReader& payload) = 0;
 
 	protected:
 		uint8_t   _id;
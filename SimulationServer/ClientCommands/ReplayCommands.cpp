@@ -0,0 +1,27 @@
+#include "../ReplaySimulation.h"
+#include "ReplayCommands.h"
+
+uint16_t PlaybackSpeedCommand::execute(DistrSimulation& sim, BufferReader& payload)
+{
+    double speed = 0;
+    payload.unpack(speed);
+
+    ReplaySimulation* replay = dynamic_cast<ReplaySimulation*>(&sim);
+    if (replay == NULL)
+        return ClientCommand::ERROR_CODE_NOT_REPLAY;
+    replay->setPlaybackSpeed(speed);
+    return ClientCommand::ERROR_CODE_SUCCESS;
+}
+
+uint16_t SeekCommand::execute(DistrSimulation& sim, BufferReader& payload)
+{
+    uint32_t tick = 0;
+    payload.unpackBigEndian(tick);
+
+    ReplaySimulation* replay = dynamic_cast<ReplaySimulation*>(&sim);
+    if (replay == NULL)
+        return ClientCommand::ERROR_CODE_NOT_REPLAY;
+    if (!replay->seek(tick))
+        return ClientCommand::ERROR_CODE_INVALID_TICK;
+    return ClientCommand::ERROR_CODE_SUCCESS;
+}
@@ -0,0 +1,65 @@
+#ifndef REPLAY_COMMANDS_H
+#define REPLAY_COMMANDS_H
+
+#include "ClientCommand.h"
+
+class DistrSimulation;
+
+// commands sent by visualisers - they do not refer to any entity
+
+class VisualiserCommand
+{
+	public:
+		// valid visualiser commands with IDs (executed only by replay server)
+		static const uint8_t  PLAYBACK_SPEED_COMMAND_ID = 0;
+		static const uint8_t  SEEK_COMMAND_ID = 1;
+		// since protocol version 3 - visualiser has applied frame with given TICK (32 bits, network-byte-order);
+		// handled by CommunicationManager itself
+		static const uint8_t  FRAME_ACK_COMMAND_ID = 2;
+
+		VisualiserCommand(uint8_t id) : _id(id) {}
+		virtual ~VisualiserCommand() {}
+
+		// bytes following COMMAND_ID - command is executed, when all of them were received
+		virtual size_t getPayloadLength() const = 0;
+		virtual uint16_t execute(DistrSimulation& sim, BufferReader& payload) = 0;
+
+	protected:
+		uint8_t   _id;
+};
+
+/*
+          Serialization format (integers in network-byte-order, doubles in host-byte-order)
+
+             +-------------------+------------------------------------------------------------+
+             |   COMMAND_ID      |                 SPEED - multiplier of recorded time,       |
+             |     1 byte        |                 0 pauses playback (64 bits)                |
+             +-------------------+------------------------------------------------------------+
+*/
+
+class PlaybackSpeedCommand : public VisualiserCommand
+{
+	public:
+		PlaybackSpeedCommand() : VisualiserCommand(PLAYBACK_SPEED_COMMAND_ID) {}
+
+		size_t getPayloadLength() const { return sizeof(double); }
+		uint16_t execute(DistrSimulation& sim, BufferReader& payload);
+};
+
+/*
+             +-------------------+----------------------------------------+
+             |   COMMAND_ID      |                 TICK                   |
+             |     1 byte        |               4 bytes                  |
+             +-------------------+----------------------------------------+
+*/
+
+class SeekCommand : public VisualiserCommand
+{
+	public:
+		SeekCommand() : VisualiserCommand(SEEK_COMMAND_ID) {}
+
+		size_t getPayloadLength() const { return sizeof(uint32_t); }
+		uint16_t execute(DistrSimulation& sim, BufferReader& payload);
+};
+
+#endif
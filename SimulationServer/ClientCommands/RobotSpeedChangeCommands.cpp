@@ -1,6 +1,6 @@
 #include "RobotSpeedChangeCommands.h"
 
-uint16_t SingleMotorSpeedChangeCommand::execute(SimEnt& entity, DistrSimulation& sim, SOCKET sock)
+uint16_t SingleMotorSpeedChangeCommand::execute(SimEnt& entity, DistrSimulation& sim, BufferReader& payload)
 {
     uint16_t errorCode = ClientCommand::ERROR_CODE_SUCCESS;
 
@@ -9,25 +9,22 @@ uint16_t SingleMotorSpeedChangeCommand::execute(SimEnt& entity, DistrSimulation&
         errorCode = ClientCommand::ERROR_CODE_INVALID_ENTITY;
     else
     {
-        uint8_t motorID;
-        double newSpeed;
-        recv(sock, reinterpret_cast<char*>(&motorID), sizeof(motorID), 0);
-        recv(sock, reinterpret_cast<char*>(&newSpeed), sizeof(newSpeed), 0);
-
-        sim.lock();
-        if (motorID == LEFT_MOTOR_ID)
-            robot->setLeftMotorSpeed(newSpeed);
-        else if (motorID == RIGHT_MOTOR_ID)
-            robot->setRightMotorSpeed(newSpeed);
-        else
+        uint8_t motorID = 0;
+        double newSpeed = 0;
+        payload.unpack(motorID);
+        payload.unpack(newSpeed);
+
+        if (motorID != LEFT_MOTOR_ID && motorID != RIGHT_MOTOR_ID)
             errorCode = ClientCommand::ERROR_CODE_INVALID_MOTOR_ID;
-        sim.unlock();
+        else if (!sim.queueMotorSpeedChange(MotorSpeedChange(robot, motorID == LEFT_MOTOR_ID, newSpeed,
+            motorID == RIGHT_MOTOR_ID, newSpeed)))
+            errorCode = ClientCommand::ERROR_CODE_QUEUE_FULL;
     }
 
 	return errorCode;
 }
 
-uint16_t MotorsSpeedChangeCommand::execute(SimEnt& entity, DistrSimulation& sim, SOCKET sock)
+uint16_t MotorsSpeedChangeCommand::execute(SimEnt& entity, DistrSimulation& sim, BufferReader& payload)
 {
     uint16_t errorCode = ClientCommand::ERROR_CODE_SUCCESS;
 
@@ -36,15 +33,13 @@ uint16_t MotorsSpeedChangeCommand::execute(SimEnt& entity, DistrSimulation& sim,
         errorCode = ClientCommand::ERROR_CODE_INVALID_ENTITY;
     else
     {
-        double newLeftSpeed;
-        double newRightSpeed;
-        recv(sock, reinterpret_cast<char*>(&newLeftSpeed), sizeof(newLeftSpeed), 0);
-        recv(sock, reinterpret_cast<char*>(&newRightSpeed), sizeof(newRightSpeed), 0);
-
-        sim.lock();
-        robot->setLeftMotorSpeed(newLeftSpeed);
-        robot->setRightMotorSpeed(newRightSpeed);
-        sim.unlock();
+        double newLeftSpeed = 0;
+        double newRightSpeed = 0;
+        payload.unpack(newLeftSpeed);
+        payload.unpack(newRightSpeed);
+
+        if (!sim.queueMotorSpeedChange(MotorSpeedChange(robot, true, newLeftSpeed, true, newRightSpeed)))
+            errorCode = ClientCommand::ERROR_CODE_QUEUE_FULL;
     }
 
     return errorCode;
@@ -26,7 +26,8 @@ class SingleMotorSpeedChangeCommand : public ClientCommand
 	public:
         SingleMotorSpeedChangeCommand() : ClientCommand(ClientCommand::SINGLE_MOTOR_SPEED_CHANGE_COMMAND_ID) {}
 
-        uint16_t execute(SimEnt& entity, DistrSimulation& sim, SOCKET sock);
+        size_t getPayloadLength() const { return sizeof(uint8_t) + sizeof(double); }
+        uint16_t execute(SimEnt& entity, DistrSimulation& sim, BufferReader& payload);
 
 	private:
         static const int LEFT_MOTOR_ID = 0;
@@ -38,7 +39,8 @@ class MotorsSpeedChangeCommand : public ClientCommand
     public:
         MotorsSpeedChangeCommand() : ClientCommand(ClientCommand::MOTORS_SPEED_CHANGE_COMMAND_ID) {}
 
-        uint16_t execute(SimEnt& entity, DistrSimulation& sim, SOCKET sock);
+        size_t getPayloadLength() const { return 2 * sizeof(double); }
+        uint16_t execute(SimEnt& entity, DistrSimulation& sim, BufferReader& payload);
 };
 
 #endif
@@ -1,11 +1,24 @@
 #include "CommunicationManager.h"
 
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
 const int CommunicationManager::NUMBER_OF_CONTROLLER_COMMANDS = 
 	ClientCommand::MOTORS_SPEED_CHANGE_COMMAND_ID + 1;
+const int CommunicationManager::NUMBER_OF_VISUALISER_COMMANDS =
+	VisualiserCommand::SEEK_COMMAND_ID + 1;
 
-CommunicationManager::CommunicationManager(DistrSimulation* sim) : _isStopped(false), _simulation(sim)
+CommunicationManager::CommunicationManager(DistrSimulation* sim) : _listenSocket(INVALID_SOCKET), _simulation(sim),
+    _isStopped(false), _controllerSendPolicy(SendQueue::KEEP_ALL), _visualiserVersions(0),
+    _hasCompactVisualisers(false), _hasControllers(false), _snapshotTick(0), _publishedVersion(0)
 {
-	InitializeCriticalSection(&_clientsMutex);
+#ifdef __linux__
+	_epoll = -1;
+	_wakeup = -1;
+#endif
 
 	// initialize arrays with clients commands
     _validControllerCommands = new ClientCommand*[NUMBER_OF_CONTROLLER_COMMANDS];
@@ -13,22 +26,27 @@ CommunicationManager::CommunicationManager(DistrSimulation* sim) : _isStopped(fa
 		new SingleMotorSpeedChangeCommand();
     _validControllerCommands[ClientCommand::MOTORS_SPEED_CHANGE_COMMAND_ID] =
         new MotorsSpeedChangeCommand();
+    _validVisualiserCommands = new VisualiserCommand*[NUMBER_OF_VISUALISER_COMMANDS];
+    _validVisualiserCommands[VisualiserCommand::PLAYBACK_SPEED_COMMAND_ID] = new PlaybackSpeedCommand();
+    _validVisualiserCommands[VisualiserCommand::SEEK_COMMAND_ID] = new SeekCommand();
 }
 
 CommunicationManager::~CommunicationManager()
 {
-	/* close visualisers sockets */
-	for (std::set<SOCKET>::iterator it = _visualisers.begin(); it != _visualisers.end(); it++)
+	// broadcast thread stops before sockets are closed
 	{
-		shutdown(*it, SD_SEND);
-		closesocket(*it);
+		std::lock_guard<std::mutex> lock(_snapshotMutex);
+		_isStopped = true;
 	}
+	_snapshotReady.notify_one();
+	if (_broadcastThread.joinable())
+		_broadcastThread.join();
 
-	// close robot controlers sockets
-    for (std::map<uint16_t, SocketData>::iterator it = _controllers.begin(); it != _controllers.end(); it++)
+	// close sockets of visualisers, robot controllers and clients in handshake
+	for (std::map<SOCKET, ClientConnection>::iterator it = _connections.begin(); it != _connections.end(); it++)
 	{
-		shutdown(it->second.socket, SD_SEND);
-		closesocket(it->second.socket);
+		shutdown(it->first, SD_SEND);
+		closeSocket(it->first);
 	}
 
 	// delete commands
@@ -36,15 +54,33 @@ CommunicationManager::~CommunicationManager()
         delete _validControllerCommands[i];
 
     delete[] _validControllerCommands;
+	for (int i = 0; i < NUMBER_OF_VISUALISER_COMMANDS; i++)
+        delete _validVisualiserCommands[i];
+    delete[] _validVisualiserCommands;
+
+	close_listen_socket();
+}
 
-	DeleteCriticalSection(&_clientsMutex);
+void CommunicationManager::close_listen_socket()
+{
+	if (_listenSocket != INVALID_SOCKET)
+		closeSocket(_listenSocket);
+	_listenSocket = INVALID_SOCKET;
+#ifdef __linux__
+	if (_epoll != -1)
+		close(_epoll);
+	_epoll = -1;
+	if (_wakeup != -1)
+		close(_wakeup);
+	_wakeup = -1;
+#endif
 }
 
 bool CommunicationManager::init()
 {
 	struct addrinfo *result = NULL, *ptr = NULL, hints;
 
-	ZeroMemory(&hints, sizeof (hints));
+	memset(&hints, 0, sizeof (hints));
 	hints.ai_family = AF_INET;
 	hints.ai_socktype = SOCK_STREAM;
 	hints.ai_protocol = IPPROTO_TCP;
@@ -62,32 +98,105 @@ bool CommunicationManager::init()
 	_listenSocket = socket(result->ai_family, result->ai_socktype, result->ai_protocol);
 	if (_listenSocket == INVALID_SOCKET)
     {
-		std::cout << "Error at socket(). Error code: " << WSAGetLastError() << std::endl;
+		std::cout << "Error at socket(). Error code: " << getSocketError() << std::endl;
 		freeaddrinfo(result);
 		return false;
 	}
 
+#ifndef _WIN32
+	// restarted server can bind again, while connections of the previous one are in TIME_WAIT
+	int reuse = 1;
+	setsockopt(_listenSocket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+#endif
+
 	// bind socket
 	iResult = bind(_listenSocket, result->ai_addr, (int) result->ai_addrlen);
 	freeaddrinfo(result);
 	if (iResult == SOCKET_ERROR)
     {
-		std::cout << "bind failed. Error code: " << WSAGetLastError() << std::endl;
-		closesocket(_listenSocket);
+		std::cout << "bind failed. Error code: " << getSocketError() << std::endl;
+		close_listen_socket();
 		return false;
 	}
 
 	// listen
-	if (listen(_listenSocket, SOMAXCONN) == SOCKET_ERROR)
+	if (listen(_listenSocket, SOMAXCONN) == SOCKET_ERROR || !setNonBlocking(_listenSocket))
+    {
+		std::cout << "Listen failed. Error code: " << getSocketError() << std::endl;
+		close_listen_socket();
+		return false;
+	}
+
+#ifdef __linux__
+	_epoll = epoll_create1(0);
+	if (_epoll == -1)
+    {
+		std::cout << "epoll_create1 failed. Error code: " << getSocketError() << std::endl;
+		close_listen_socket();
+		return false;
+	}
+	watch_socket(_listenSocket);
+
+	_wakeup = eventfd(0, EFD_NONBLOCK);
+	if (_wakeup == -1)
     {
-		std::cout << "Listen failed. Error code: " << WSAGetLastError() << std::endl;
-		closesocket(_listenSocket);
+		std::cout << "eventfd failed. Error code: " << getSocketError() << std::endl;
+		close_listen_socket();
 		return false;
 	}
+	epoll_event wakeupEvent;
+	wakeupEvent.events = EPOLLIN;
+	wakeupEvent.data.fd = _wakeup;
+	epoll_ctl(_epoll, EPOLL_CTL_ADD, _wakeup, &wakeupEvent);
+#endif
 
+	_broadcastThread = std::thread(&CommunicationManager::run_broadcast_loop, this);
 	return true;
 }
 
+#ifdef __linux__
+void CommunicationManager::runServerLoop()
+{
+	epoll_event events[MAX_EVENTS];
+	while (!_isStopped)
+	{
+		// only sockets, that received something, are reported - nothing is rebuilt between calls
+		int numberOfEvents = epoll_wait(_epoll, events, MAX_EVENTS, -1);
+		for (int i = 0; i < numberOfEvents; i++)
+		{
+			if (events[i].data.fd == _wakeup)
+				continue; // _isStopped is already set
+			if (events[i].data.fd == _listenSocket)
+			{
+				while (accept_new_client())
+					;
+			}
+			else
+				handle_socket(events[i].data.fd);
+		}
+	}
+}
+
+void CommunicationManager::requestStop()
+{
+	_isStopped = true;
+	if (_wakeup != -1)
+	{
+		uint64_t one = 1;
+		ssize_t written = write(_wakeup, &one, sizeof(one)); // fails only when counter is full - loop wakes anyway
+		(void) written;
+	}
+}
+
+void CommunicationManager::watch_socket(SOCKET clientSocket)
+{
+	// edge-triggered - socket is reported once for every arrival of data, so it has to be drained every time
+	epoll_event event;
+	event.events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+	event.data.fd = clientSocket;
+	epoll_ctl(_epoll, EPOLL_CTL_ADD, clientSocket, &event);
+}
+#else
 void CommunicationManager::runServerLoop()
 {
 	while (!_isStopped)
@@ -95,172 +204,703 @@ void CommunicationManager::runServerLoop()
 		fd_set receivingSockets;
 		FD_ZERO(&receivingSockets);
 
-		// add controllers to observed sockets set
-        for (std::map<uint16_t, SocketData>::iterator it = _controllers.begin(); it != _controllers.end(); it++)
-			FD_SET(it->second.socket, &receivingSockets);
-
-		// add visualisers
-		for (std::set<SOCKET>::iterator it = _visualisers.begin(); it != _visualisers.end(); it++)
-			FD_SET(*it, &receivingSockets);
+		// add clients to observed sockets set (Windows ignores the highest socket, other systems need it)
+		SOCKET maxSocket = _listenSocket;
+		for (std::map<SOCKET, ClientConnection>::iterator it = _connections.begin(); it != _connections.end(); it++)
+		{
+			FD_SET(it->first, &receivingSockets);
+			if (it->first > maxSocket)
+				maxSocket = it->first;
+		}
 
 		// add server's listen socket
 		FD_SET(_listenSocket, &receivingSockets);
 
-		int numberOfSockets = select(0, &receivingSockets, NULL, NULL, NULL);
+		// signal handler cannot wake select everywhere, so stop request is checked periodically
+		timeval timeout;
+		timeout.tv_sec = 0;
+		timeout.tv_usec = STOP_CHECK_INTERVAL * 1000;
+		int numberOfSockets = select((int) maxSocket + 1, &receivingSockets, NULL, NULL, &timeout);
+		if (numberOfSockets == SOCKET_ERROR || numberOfSockets == 0)
+			continue; // sets are undefined after error (e.g. EINTR) and empty after timeout
 
 		if (FD_ISSET(_listenSocket, &receivingSockets))
 			accept_new_client();
 
-		receive_controllers_messages(&receivingSockets);
-		receive_visualisers_messages(&receivingSockets);
+		// sockets are collected first, as handling them may remove clients
+		std::vector<SOCKET> readySockets;
+		for (std::map<SOCKET, ClientConnection>::iterator it = _connections.begin(); it != _connections.end(); it++)
+			if (FD_ISSET(it->first, &receivingSockets))
+				readySockets.push_back(it->first);
+		for (size_t i = 0; i < readySockets.size(); i++)
+			handle_socket(readySockets[i]);
+	}
+}
+
+void CommunicationManager::requestStop()
+{
+	_isStopped = true;
+}
+
+void CommunicationManager::watch_socket(SOCKET clientSocket)
+{
+	// select gets all client sockets every time
+}
+#endif
+
+void CommunicationManager::handle_socket(SOCKET clientSocket)
+{
+	std::map<SOCKET, ClientConnection>::iterator it = _connections.find(clientSocket);
+	if (it == _connections.end())
+		return;
+	ClientConnection& client = it->second;
+
+	// messages, which came before client closed the connection, are still executed
+	bool isConnected = client.input.receive(clientSocket);
+	bool isAccepted = parse_handshake(clientSocket, client);
+	if (isAccepted && client.state == ClientConnection::CONTROLLER_COMMANDS)
+		execute_controller_commands(client);
+	else if (isAccepted && client.state == ClientConnection::VISUALISER_COMMANDS)
+		execute_visualiser_commands(clientSocket, client);
+
+	if (!isConnected || !isAccepted)
+		remove_client(it);
+}
+
+void CommunicationManager::publishSnapshot(const Simulation& world)
+{
+	// the previous snapshot in this slot was not taken by broadcast thread or it was already sent
+	PublishedWorld& published = _snapshots.getBack();
+	published.tick = _snapshotTick++;
+	if (_visualiserVersions == 0 && !_hasCompactVisualisers && !_hasControllers)
+		_publishedWorld.reset(); // the world is copied again for the next client
+	else
+	{
+		if (_publishedWorld == NULL || world.getEntitiesVersion() != _publishedVersion)
+		{
+			_publishedWorld.reset(world.createSnapshot());
+			_publishedVersion = world.getEntitiesVersion();
+		}
+		world.copyFields(published.fields);
+	}
+	published.world = _publishedWorld;
+
+	{
+		std::lock_guard<std::mutex> lock(_snapshotMutex);
+		_snapshots.publish();
+	}
+	_snapshotReady.notify_one();
+}
+
+void CommunicationManager::encode_snapshot(const PublishedWorld& published, WorldSnapshot& snapshot)
+{
+	// world is serialized at most once for every protocol version in use, no matter how many clients there are
+	// frames of the previous snapshot are released first, so that they can be reused; clients, which connected
+	// after the world was copied, wait for the next one
+	Simulation* world = published.world.get();
+	if (world != NULL)
+		world->applyFields(published.fields);
+	uint32_t versions = world != NULL ? _visualiserVersions.load() : 0;
+	snapshot.tick = published.tick;
+	snapshot.time = world != NULL ? world->getTime() : 0;
+	snapshot.legacyWorld = FrameRef();
+	if (versions & (1u << PROTOCOL_VERSION_1))
+	{
+		snapshot.legacyWorld = FrameRef(_snapshotFrames.getFrame(PROTOCOL_VERSION_1));
+		world->serialize(snapshot.legacyWorld.get()->getBuffer());
+	}
+	snapshot.world.frame = FrameRef();
+	if (versions & ~(1u << PROTOCOL_VERSION_1))
+		encode_world(*world, false, snapshot.world);
+	// visualisers of version 3 and newer get only records, which changed since the snapshot they acknowledged
+	if (versions & ~((1u << PROTOCOL_VERSION_3) - 1))
+		find_changed_records(*world, snapshot.tick, snapshot.world, _previousWorld);
+	else
+		forget_records(snapshot.tick, snapshot.world, _previousWorld);
+	snapshot.compactWorld.frame = FrameRef();
+	if (world != NULL && _hasCompactVisualisers)
+	{
+		encode_world(*world, true, snapshot.compactWorld);
+		find_changed_records(*world, snapshot.tick, snapshot.compactWorld, _previousCompactWorld);
+	}
+	else
+		forget_records(snapshot.tick, snapshot.compactWorld, _previousCompactWorld);
+
+	// states of all robots - it is not known here, which ones have controllers
+	snapshot.robotStates = FrameRef();
+	if (world == NULL || !_hasControllers)
+		snapshot.robotStateParts.clear();
+	else
+	{
+		snapshot.robotStates = FrameRef(_snapshotFrames.getFrame(PROTOCOL_VERSION));
+		Buffer& states = snapshot.robotStates.get()->getBuffer();
+		const SimEntMap& entities = world->getEntities();
+		for (SimEntMap::const_iterator it = entities.begin(); it != entities.end(); it++)
+		{
+			if (it->second->getShapeID() != SimEnt::KHEPERA_ROBOT)
+				continue;
+			size_t offset = states.getLength();
+			dynamic_cast<KheperaRobot*>(it->second)->serializeForController(states);
+			snapshot.robotStateParts[it->first] = std::make_pair(offset, states.getLength() - offset);
+		}
+	}
+}
+
+void CommunicationManager::encode_world(const Simulation& world, bool isCompact, EncodedWorld& encoded)
+{
+	encoded.frame = FrameRef(_snapshotFrames.getFrame(PROTOCOL_VERSION, isCompact));
+	_recordOffsets.clear();
+	world.serialize(encoded.frame.get()->getBuffer(), &_recordOffsets);
+}
+
+void CommunicationManager::find_changed_records(const Simulation& world, uint32_t tick, EncodedWorld& encoded,
+	EncodedWorld& previous)
+{
+	// records are compared byte by byte - whatever visualiser would see differently (pose, sensor states) is sent;
+	// changes, which compact encoding does not show, are not
+	const Buffer& buffer = encoded.frame.get()->getBuffer();
+	const uint8_t* data = buffer.getBuffer();
+	const uint8_t* previousData = previous.frame.get() != NULL ? previous.frame->getBuffer() : NULL;
+	const SimEntMap& entities = world.getEntities();
+	bool hasSameEntities = previousData != NULL && previous.records.size() == entities.size();
+	encoded.records.clear();
+	size_t i = 0;
+	for (SimEntMap::const_iterator it = entities.begin(); it != entities.end(); it++, i++)
+	{
+		EntityRecord record;
+		record.id = it->first;
+		record.offset = _recordOffsets[i];
+		record.length = (i + 1 < _recordOffsets.size() ? _recordOffsets[i + 1] : buffer.getLength()) - record.offset;
+		record.changeTick = tick;
+		if (hasSameEntities)
+		{
+			const EntityRecord& last = previous.records[i];
+			if (last.id != record.id)
+				hasSameEntities = false;
+			else if (last.length == record.length
+				&& memcmp(previousData + last.offset, data + record.offset, record.length) == 0)
+				record.changeTick = last.changeTick;
+		}
+		encoded.records.push_back(record);
+	}
+
+	// visualisers, which have not seen the current set of entities, need keyframe
+	encoded.entitiesTick = hasSameEntities ? previous.entitiesTick : tick;
+	previous = encoded;
+}
+
+void CommunicationManager::forget_records(uint32_t tick, EncodedWorld& encoded, EncodedWorld& previous)
+{
+	encoded.records.clear();
+	encoded.entitiesTick = tick; // no delta can refer to this snapshot
+	previous = EncodedWorld();
+}
+
+void CommunicationManager::run_broadcast_loop()
+{
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(_snapshotMutex);
+			while (!_snapshots.hasNew() && !_isStopped)
+				_snapshotReady.wait(lock);
+			if (_isStopped)
+				return;
+			_snapshots.takeNew();
+		}
+		encode_snapshot(_snapshots.getFront(), _snapshot);
+		broadcast_snapshot(_snapshot);
 	}
 }
 
-void CommunicationManager::sendWorldDescriptionToVisualisers()
+void CommunicationManager::broadcast_snapshot(const WorldSnapshot& snapshot)
+{
+	// controllers data is encoded once for every protocol version too, it follows the world as the second part
+	// of visualiser frame
+	FrameRef legacyControllers;
+	FrameRef controllers;
+
+	_clientsMutex.lock(); // if server-thread adds new client, iterator would be broken
+	    for (std::map<SOCKET, SocketData>::iterator it = _visualisers.begin(); it != _visualisers.end(); it++)
+        {
+            SocketData& visualiser = it->second;
+            const EncodedWorld& encoded = visualiser.isCompact ? snapshot.compactWorld : snapshot.world;
+            const FrameRef& world = visualiser.protocolVersion < 2 ? snapshot.legacyWorld : encoded.frame;
+            if (visualiser.isDisconnecting || world.get() == NULL)
+                continue; // visualiser connected after the snapshot was taken, it gets the next one
+            FrameRef& controllersData = visualiser.protocolVersion < 2 ? legacyControllers : controllers;
+            if (controllersData.get() == NULL)
+            {
+                controllersData = FrameRef(_broadcastFrames.getFrame(visualiser.protocolVersion));
+                serializeControllersData(controllersData.get()->getBuffer());
+            }
+            if (visualiser.protocolVersion < PROTOCOL_VERSION_3)
+            {
+                SendQueue::Segment frame[2] = { SendQueue::Segment(world, 0, world->getLength()),
+                    SendQueue::Segment(controllersData, 0, controllersData->getLength()) };
+                visualiser.output.push(frame, 2);
+            }
+            else
+            {
+                SendQueue::Segment frame[SendQueue::MAX_SEGMENTS];
+                int count = prepare_update(visualiser, snapshot, encoded, controllersData,
+                    visualiser.isCompact ? _compactUpdates : _updates, frame);
+                if (count > 0)
+                    visualiser.output.push(frame, count);
+            }
+            flush_client(visualiser);
+        }
+
+        for (std::map<uint32_t, SocketData>::iterator it = _controllers.begin(); it != _controllers.end(); it++)
+        {
+            SocketData& controller = it->second;
+            std::map<uint32_t, std::pair<size_t, size_t> >::const_iterator part =
+                snapshot.robotStateParts.find(it->first);
+            if (controller.isDisconnecting || snapshot.robotStates.get() == NULL || part == snapshot.robotStateParts.end())
+                continue;
+            SendQueue::Segment state(snapshot.robotStates, part->second.first, part->second.second);
+            if (!controller.output.push(&state, 1))
+            {
+                std::cout << "SEND QUEUE OF CONTROLLER FOR ROBOT WITH ID = " << it->first << " IS FULL\n";
+                disconnect_client(controller);
+            }
+            else
+                flush_client(controller);
+        }
+	_clientsMutex.unlock();
+
+	// frames go back to the pool, when clients have sent them
+	_updates.clear();
+	_compactUpdates.clear();
+}
+
+/*
+		Visualiser frame since protocol version 3 - TYPE is keyframe or delta, LENGTH counts bytes following the header
+	+-------------------+-------------------+-------------------+-------------------+
+	|       TYPE        |       TICK        |     BASE_TICK     |      LENGTH       |
+	|      8 bits       |      32 bits      |      32 bits      |      32 bits      |
+	+-------------------+-------------------+-------------------+-------------------+
+		keyframe (BASE_TICK = TICK) - world as in protocol version 2, then controllers data (with compact frames,
+		records of entities are encoded by CompactWriter, see Fields.h)
+		delta - entities, whose records changed after snapshot BASE_TICK, then controllers data
+	+---------------------------------------+-------------------+------------------------------+
+	|                 TIME                  |    NUMBER_OF      |   ENTITIES_DATA              |
+	|                64 bits                |    ENTITIES 32 b  |   records as in world        |
+	+---------------------------------------+-------------------+------------------------------+
+
+		Visualiser acknowledges applied frame by command FRAME_ACK (see ReplayCommands.h) with its TICK - deltas
+		are relative to the newest acknowledged snapshot, so frames dropped on the way do not break them. Keyframe
+		is sent, when visualiser connects, when entities are added or removed and every KEYFRAME_INTERVAL snapshots.
+		Ticks wrap around after 2^32 snapshots, so they are compared as serial numbers (RFC 1982).
+*/
+
+// true if snapshot A was taken before snapshot B, which is less than 2^31 snapshots away
+static inline bool isTickBefore(uint32_t a, uint32_t b)
+{
+    return static_cast<int32_t>(a - b) < 0;
+}
+
+int CommunicationManager::prepare_update(SocketData& visualiser, const WorldSnapshot& snapshot,
+    const EncodedWorld& world, const FrameRef& controllersData, UpdateFrames& frames, SendQueue::Segment* segments)
+{
+    uint32_t tick = snapshot.tick;
+    bool hasBase = visualiser.hasAck && !isTickBefore(visualiser.ackedTick, world.entitiesTick)
+        && isTickBefore(visualiser.ackedTick, tick);
+    size_t trailerLength = controllersData->getLength();
+    uint32_t keyframeInterval = KEYFRAME_RETRY;
+    if (hasBase)
+        keyframeInterval = KEYFRAME_INTERVAL;
+
+    if (!visualiser.hasKeyframe || !isTickBefore(tick, visualiser.keyframeTick + keyframeInterval))
+    {
+        // the header is the only part of keyframe encoded here, world frame of snapshot follows it
+        FrameRef& header = find_update(frames, tick);
+        if (header.get() == NULL)
+        {
+            header = FrameRef(_broadcastFrames.getFrame(PROTOCOL_VERSION));
+            Buffer& buffer = header.get()->getBuffer();
+            buffer.pack(static_cast<uint8_t>(FRAME_TYPE_KEYFRAME));
+            buffer.packBigEndian(tick);
+            buffer.packBigEndian(tick);
+            buffer.packBigEndian(static_cast<uint32_t>(world.frame->getLength() + trailerLength));
+        }
+        visualiser.hasKeyframe = true;
+        visualiser.keyframeTick = tick;
+        visualiser.sentTick = tick;
+        segments[0] = SendQueue::Segment(header, 0, header->getLength());
+        segments[1] = SendQueue::Segment(world.frame, 0, world.frame->getLength());
+        segments[2] = SendQueue::Segment(controllersData, 0, trailerLength);
+        return 3;
+    }
+    if (!hasBase)
+        return 0; // keyframe is on the way
+
+    FrameRef& delta = find_update(frames, visualiser.ackedTick);
+    if (delta.get() == NULL)
+    {
+        delta = FrameRef(_broadcastFrames.getFrame(PROTOCOL_VERSION));
+        encode_delta(delta.get()->getBuffer(), snapshot, world, visualiser.ackedTick, trailerLength);
+    }
+    visualiser.sentTick = tick;
+    segments[0] = SendQueue::Segment(delta, 0, delta->getLength());
+    segments[1] = SendQueue::Segment(controllersData, 0, trailerLength);
+    return 2;
+}
+
+FrameRef& CommunicationManager::find_update(UpdateFrames& frames, uint32_t baseTick)
+{
+    for (UpdateFrames::iterator it = frames.begin(); it != frames.end(); it++)
+        if (it->first == baseTick)
+            return it->second;
+    frames.push_back(std::make_pair(baseTick, FrameRef()));
+    return frames.back().second;
+}
+
+void CommunicationManager::encode_delta(Buffer& buffer, const WorldSnapshot& snapshot, const EncodedWorld& world,
+    uint32_t baseTick, size_t trailerLength)
 {
-	Buffer buffer;
-    _simulation->serialize(buffer);
-    serializeControllersData(buffer);
+    buffer.pack(static_cast<uint8_t>(FRAME_TYPE_DELTA));
+    buffer.packBigEndian(snapshot.tick);
+    buffer.packBigEndian(baseTick);
+    buffer.packBigEndian(static_cast<uint32_t>(0)); // length and count are filled, when they are known
+    buffer.pack(snapshot.time);
+    size_t countOffset = buffer.getLength();
+    buffer.packBigEndian(static_cast<uint32_t>(0));
+
+    const uint8_t* records = world.frame->getBuffer();
+    uint32_t count = 0;
+    for (std::vector<EntityRecord>::const_iterator it = world.records.begin(); it != world.records.end(); it++)
+    {
+        if (!isTickBefore(baseTick, it->changeTick))
+            continue;
+        buffer.append(records + it->offset, it->length);
+        count++;
+    }
+    storeBigEndian(buffer.getBuffer() + countOffset, count);
+    storeBigEndian(buffer.getBuffer() + FRAME_HEADER_SIZE - sizeof(uint32_t),
+        static_cast<uint32_t>(buffer.getLength() - FRAME_HEADER_SIZE + trailerLength));
+}
+
+void CommunicationManager::flush_client(SocketData& client)
+{
+    // the rest is tried again with the next snapshot
+    if (!client.output.flush(client.socket))
+        disconnect_client(client);
+    else if (client.output.isEmpty())
+        client.lag = 0;
+    else if (++client.lag > MAX_CLIENT_LAG)
+    {
+        std::cout << "DISCONNECTING CLIENT, WHICH IS " << client.lag << " STEPS BEHIND\n";
+        disconnect_client(client);
+    }
+}
 
-	EnterCriticalSection(&_clientsMutex); // if server-thread adds new client, iterator would be broken
-	    for (std::set<SOCKET>::iterator it = _visualisers.begin(); it != _visualisers.end(); it++)
-            send(*it, reinterpret_cast<const char*>(buffer.getBuffer()), buffer.getLength(), 0);
-	LeaveCriticalSection(&_clientsMutex);
+void CommunicationManager::disconnect_client(SocketData& client)
+{
+    // server thread gets end of the connection and removes the client
+    client.isDisconnecting = true;
+    shutdown(client.socket, SD_BOTH);
 }
 
-void CommunicationManager::sendRobotsStatesToControllers()
+std::vector<CommunicationManager::ClientLag> CommunicationManager::getClientLags()
 {
-    EnterCriticalSection(&_clientsMutex); // if server-thread adds new client, iterator would be broken
-        for (std::map<uint16_t, SocketData>::iterator it = _controllers.begin(); it != _controllers.end(); it++)
+    std::vector<ClientLag> lags;
+    ClientLag lag;
+    _clientsMutex.lock();
+        for (std::map<uint32_t, SocketData>::iterator it = _controllers.begin(); it != _controllers.end(); it++)
         {
-            Buffer buffer;
-            dynamic_cast<KheperaRobot*>(_simulation->getEntity(it->first))->serializeForController(buffer);
-            send(it->second.socket, reinterpret_cast<const char*>(buffer.getBuffer()), buffer.getLength(), 0);
+            lag.socket = it->second.socket;
+            lag.isController = true;
+            lag.robotId = it->first;
+            lag.lag = it->second.lag;
+            lag.queuedBytes = it->second.output.getQueuedBytes();
+            lag.droppedMessages = it->second.output.getDroppedCount();
+            lags.push_back(lag);
         }
-    LeaveCriticalSection(&_clientsMutex);
+        for (std::map<SOCKET, SocketData>::iterator it = _visualisers.begin(); it != _visualisers.end(); it++)
+        {
+            lag.socket = it->first;
+            lag.isController = false;
+            lag.robotId = 0;
+            lag.lag = it->second.lag;
+            lag.queuedBytes = it->second.output.getQueuedBytes();
+            lag.droppedMessages = it->second.output.getDroppedCount();
+            lags.push_back(lag);
+        }
+    _clientsMutex.unlock();
+    return lags;
+}
+
+void CommunicationManager::update_clients_summary()
+{
+	uint32_t versions = 0;
+	bool hasCompactVisualisers = false;
+	for (std::map<SOCKET, SocketData>::iterator it = _visualisers.begin(); it != _visualisers.end(); it++)
+	{
+		if (it->second.isCompact)
+			hasCompactVisualisers = true;
+		else
+			versions |= 1u << it->second.protocolVersion;
+	}
+	_visualiserVersions = versions;
+	_hasCompactVisualisers = hasCompactVisualisers;
+	_hasControllers = !_controllers.empty();
 }
 
 bool CommunicationManager::accept_new_client()
 {
 	SOCKET clientSocket = INVALID_SOCKET;
-    struct sockaddr sockData;
-    int sockDataSize = sizeof(sockData);
+    // listen socket is IPv4 only (see init), so address of the client fits sockaddr_in
+    struct sockaddr_in sockData;
+    socklen_t sockDataSize = sizeof(sockData);
 
 	// Accept a client socket
-	clientSocket = accept(_listenSocket, &sockData, &sockDataSize);
+	clientSocket = accept(_listenSocket, reinterpret_cast<sockaddr*>(&sockData), &sockDataSize);
 	if (clientSocket == INVALID_SOCKET)
     {
-		printf("accept failed: %d\n", WSAGetLastError());
-		closesocket(_listenSocket);
-		WSACleanup();
+        // listen socket is non-blocking, so this only means, that all waiting clients were accepted
+        if (!isWouldBlockError(getSocketError()))
+		    printf("accept failed: %d\n", getSocketError());
 		return false;
 	}
-    
-    // receive new client type information and add it to appropriate container
-	uint8_t newClientType;
-	recv(clientSocket, reinterpret_cast<char*>(&newClientType), 1, 0);
+    setNonBlocking(clientSocket);
+    int sendBuffer = CLIENT_SEND_BUFFER;
+    setsockopt(clientSocket, SOL_SOCKET, SO_SNDBUF, reinterpret_cast<const char*>(&sendBuffer), sizeof(sendBuffer));
 
-	if (newClientType == TYPE_ID_VISUALISER)
-	{
-		EnterCriticalSection(&_clientsMutex);
-		    _visualisers.insert(clientSocket);
-		LeaveCriticalSection(&_clientsMutex);
-	}
-    else if (newClientType == TYPE_ID_CONTROLLER)
+    // handshake is parsed as any other message, when it comes
+    _connections[clientSocket] = ClientConnection(sockData);
+    watch_socket(clientSocket);
+
+	return true;
+}
+
+/*
+		Handshake (since protocol version 2, the highest bit of CLIENT_TYPE is set and PROTOCOL_VERSION follows;
+		server answers with version, which it is going to speak - the lower of both; since version 4 CAPABILITIES
+		requested by client follow and server answers with the granted ones after the version)
+	+-------------------+-------------------+-------------------+
+	|                   |                   |                   |
+	|   CLIENT_TYPE     | PROTOCOL_VERSION  |   CAPABILITIES    |
+	|      8 bits       |      8 bits       |      8 bits       |
+	+-------------------+-------------------+-------------------+
+		controllers then send ID of their robot (network-byte-order, 16 bits in protocol version 1)
+	+---------------------------------------+
+	|               ROBOT_ID                |
+	|                32 bits                |
+	+---------------------------------------+
+
+*/
+
+bool CommunicationManager::parse_handshake(SOCKET clientSocket, ClientConnection& client)
+{
+    ReceiveBuffer& input = client.input;
+    if (client.state == ClientConnection::AWAITING_TYPE)
     {
-        uint16_t controlledRobotId;
-        recv(clientSocket, reinterpret_cast<char*>(&controlledRobotId), sizeof(controlledRobotId), 0);
-        controlledRobotId = ntohs(controlledRobotId);
-        SimEnt* robot = _simulation->getEntity(controlledRobotId);
-        if (robot != NULL && robot->getShapeID() == SimEnt::KHEPERA_ROBOT 
-            && _controllers.find(controlledRobotId) == _controllers.end())
+        if (input.getLength() < 1)
+            return true;
+        uint8_t clientType = input.getData()[0];
+        if (clientType & PROTOCOL_VERSION_FLAG)
         {
-            struct sockaddr_in* parsedData = reinterpret_cast<sockaddr_in*>(&sockData);
-            std::cout << "CONTROLLER FOR ROBOT WITH ID = " << controlledRobotId << " SUCCESSFULLY CONNECTED\n";
-            EnterCriticalSection(&_clientsMutex);
-                _controllers[controlledRobotId] = SocketData(clientSocket, parsedData->sin_port, parsedData->sin_addr);
-            LeaveCriticalSection(&_clientsMutex);
+            if (input.getLength() < 2)
+                return true;
+            size_t handshakeLength = input.getData()[1] < PROTOCOL_VERSION_4 ? 2 : 3;
+            if (input.getLength() < handshakeLength)
+                return true;
+            clientType &= ~PROTOCOL_VERSION_FLAG;
+            client.protocolVersion = input.getData()[1];
+            if (client.protocolVersion > PROTOCOL_VERSION)
+                client.protocolVersion = PROTOCOL_VERSION;
+            // only visualisers have capabilities so far
+            if (handshakeLength > 2 && clientType == TYPE_ID_VISUALISER)
+                client.capabilities = input.getData()[2] & CAPABILITY_COMPACT_FRAMES;
+            uint8_t answer[2] = { client.protocolVersion, client.capabilities };
+            sendAll(clientSocket, answer, (int) handshakeLength - 1);
+            input.consume(handshakeLength);
         }
         else
+            input.consume(1);
+
+        if (clientType == TYPE_ID_VISUALISER)
         {
-            shutdown(clientSocket, SD_RECEIVE);
-            closesocket(clientSocket);
-            std::cout << "NO ROBOT WITH ID = " << controlledRobotId << " TO CONTROL.\n";
+            client.state = ClientConnection::VISUALISER_COMMANDS;
+            _clientsMutex.lock();
+                SocketData& visualiser = _visualisers[clientSocket];
+                visualiser = SocketData(clientSocket, client.address.sin_port, client.address.sin_addr,
+                    client.protocolVersion, SendQueue::LATEST_ONLY);
+                visualiser.isCompact = (client.capabilities & CAPABILITY_COMPACT_FRAMES) != 0;
+                update_clients_summary();
+            _clientsMutex.unlock();
         }
+        else if (clientType == TYPE_ID_CONTROLLER)
+            client.state = ClientConnection::AWAITING_ROBOT_ID;
+        else
+            return false;
     }
 
-	return true;
+    if (client.state == ClientConnection::AWAITING_ROBOT_ID)
+    {
+        BufferReader reader(input.getData(), input.getLength());
+        uint32_t controlledRobotId = 0;
+        if (client.protocolVersion < 2)
+        {
+            uint16_t id16 = 0;
+            reader.unpackBigEndian(id16);
+            controlledRobotId = id16;
+        }
+        else
+            reader.unpackBigEndian(controlledRobotId);
+        if (reader.hasFailed())
+            return true; // the whole ID has not come yet
+        input.consume(reader.getPosition() - input.getData());
+
+        SimEnt* robot = _simulation->getEntity(controlledRobotId);
+        if (robot == NULL || robot->getShapeID() != SimEnt::KHEPERA_ROBOT
+            || _controllers.find(controlledRobotId) != _controllers.end())
+        {
+            std::cout << "NO ROBOT WITH ID = " << controlledRobotId << " TO CONTROL.\n";
+            return false;
+        }
+        std::cout << "CONTROLLER FOR ROBOT WITH ID = " << controlledRobotId << " SUCCESSFULLY CONNECTED\n";
+        client.state = ClientConnection::CONTROLLER_COMMANDS;
+        client.robotId = controlledRobotId;
+        _clientsMutex.lock();
+            _controllers[controlledRobotId] = SocketData(clientSocket, client.address.sin_port, client.address.sin_addr,
+                client.protocolVersion, _controllerSendPolicy);
+            update_clients_summary();
+        _clientsMutex.unlock();
+    }
+    return true;
 }
 
-void CommunicationManager::receive_controllers_messages(fd_set* sockets)
+void CommunicationManager::execute_controller_commands(ClientConnection& client)
 {
-	// find out who sent us a message
-	std::map<uint16_t, SocketData>::iterator it = _controllers.begin();
-	while (it != _controllers.end())
+	ReceiveBuffer& input = client.input;
+	while (input.getLength() > 0)
 	{
-		if (FD_ISSET(it->second.socket, sockets))
-		{
-			uint8_t commandID;
-			int dataLength = recv(it->second.socket, reinterpret_cast<char*>(&commandID), 1, 0);
-            if (dataLength < 1)
-            {
-                std::cout << "REMOVING CONTROLLER" << std::endl;
-                EnterCriticalSection(&_clientsMutex);
-                    closesocket(it->second.socket);
-                    _controllers.erase(it++);
-                LeaveCriticalSection(&_clientsMutex);
-            }
-			else
-			{
-				std::cout << "Received command id: " << (int) commandID << std::endl;
-                if (commandID < NUMBER_OF_CONTROLLER_COMMANDS)
-                {
-                    // TODO: Send back error code in case of errors
-                    _validControllerCommands[commandID]->
-                        execute(*_simulation->getEntity(it->first), *_simulation, it->second.socket);
-                }
-				it++;
-			}
-		}
-		else
-			it++;
+		uint8_t commandID = input.getData()[0];
+        if (commandID >= NUMBER_OF_CONTROLLER_COMMANDS)
+        {
+            input.consume(1); // unknown command has no payload
+            continue;
+        }
+        ClientCommand* command = _validControllerCommands[commandID];
+        if (input.getLength() < 1 + command->getPayloadLength())
+            return; // the rest of the command has not come yet
+
+		std::cout << "Received command id: " << (int) commandID << std::endl;
+        // TODO: Send back error code in case of errors
+        BufferReader payload(input.getData() + 1, command->getPayloadLength());
+        command->execute(*_simulation->getEntity(client.robotId), *_simulation, payload);
+        input.consume(1 + command->getPayloadLength());
 	}
 }
 
-void CommunicationManager::receive_visualisers_messages(fd_set* sockets)
+void CommunicationManager::execute_visualiser_commands(SOCKET clientSocket, ClientConnection& client)
 {
-	// find out who sent us a message
-	std::set<SOCKET>::iterator it = _visualisers.begin();
-	while (it != _visualisers.end())
+	ReceiveBuffer& input = client.input;
+	while (input.getLength() > 0)
 	{
-		if (FD_ISSET(*it, sockets))
-		{
-			uint8_t message;
-			int dataLength = recv(*it, reinterpret_cast<char*>(&message), 1, 0);
-            if (dataLength < 1)
-            {
-                std::cout << "REMOVING VISUALISER" << std::endl;
-                EnterCriticalSection(&_clientsMutex);
-                    closesocket(*it);
-                    _visualisers.erase(it++);
-                LeaveCriticalSection(&_clientsMutex);
-            }
-		}
-		else
-			it++;
+		uint8_t message = input.getData()[0];
+        if (message == VisualiserCommand::FRAME_ACK_COMMAND_ID && client.protocolVersion >= PROTOCOL_VERSION_3)
+        {
+            // acknowledgements are about frames, not simulation - they are not commands of the table
+            if (input.getLength() < 1 + sizeof(uint32_t))
+                return;
+            BufferReader payload(input.getData() + 1, sizeof(uint32_t));
+            uint32_t tick = 0;
+            payload.unpackBigEndian(tick);
+            acknowledge_frame(clientSocket, tick);
+            input.consume(1 + sizeof(uint32_t));
+            continue;
+        }
+        if (message >= NUMBER_OF_VISUALISER_COMMANDS)
+        {
+            input.consume(1);
+            continue;
+        }
+        VisualiserCommand* command = _validVisualiserCommands[message];
+        if (input.getLength() < 1 + command->getPayloadLength())
+            return;
+
+        // visualisers control playback of replays, live simulation ignores their commands
+        BufferReader payload(input.getData() + 1, command->getPayloadLength());
+        command->execute(*_simulation, payload);
+        input.consume(1 + command->getPayloadLength());
 	}
 }
 
+void CommunicationManager::acknowledge_frame(SOCKET clientSocket, uint32_t tick)
+{
+    // deltas relative to a snapshot, which visualiser has not got, would miss changes, so such ack is ignored
+    _clientsMutex.lock();
+        std::map<SOCKET, SocketData>::iterator it = _visualisers.find(clientSocket);
+        if (it != _visualisers.end() && it->second.hasKeyframe && !isTickBefore(it->second.sentTick, tick)
+            && (!it->second.hasAck || isTickBefore(it->second.ackedTick, tick)))
+        {
+            it->second.hasAck = true;
+            it->second.ackedTick = tick;
+        }
+    _clientsMutex.unlock();
+}
+
+void CommunicationManager::remove_client(std::map<SOCKET, ClientConnection>::iterator client)
+{
+    // closing the socket removes it from epoll set too
+    SOCKET clientSocket = client->first;
+    if (client->second.state == ClientConnection::CONTROLLER_COMMANDS)
+    {
+        std::cout << "REMOVING CONTROLLER" << std::endl;
+        _clientsMutex.lock();
+            _controllers.erase(client->second.robotId);
+            update_clients_summary();
+        _clientsMutex.unlock();
+    }
+    else if (client->second.state == ClientConnection::VISUALISER_COMMANDS)
+    {
+        std::cout << "REMOVING VISUALISER" << std::endl;
+        _clientsMutex.lock();
+            _visualisers.erase(clientSocket);
+            update_clients_summary();
+        _clientsMutex.unlock();
+    }
+    else
+        shutdown(clientSocket, SD_RECEIVE);
+    _connections.erase(client);
+    closeSocket(clientSocket);
+}
+
+/*
+		Controllers data (NUMBER_OF_CONTROLLERS and ROBOT_ID have 8 and 16 bits in protocol version 1)
+	+--------------------------------------+
+	|         NUMBER_OF_CONTROLLERS        |
+	|                32 bits               |
+	+--------------------------------------+   -+
+	|               ROBOT_ID               |    |
+	|                32 bits               |    |
+	+------------------+-------------------+    |  repeated
+	|       PORT       |        IP         |    |  NUMBER_OF_CONTROLLERS
+	|     16 bits      |      32 bits      |    |  times
+	+------------------+-------------------+   -+
+
+*/
+
 void CommunicationManager::serializeControllersData(Buffer& buffer) const
 {
-    buffer.pack(static_cast<uint8_t>(_controllers.size()));
-    for (std::map<uint16_t, SocketData>::const_iterator it = _controllers.begin(); it != _controllers.end(); it++)
+    if (buffer.getProtocolVersion() < 2)
+        buffer.pack(static_cast<uint8_t>(_controllers.size()));
+    else
+        buffer.packBigEndian(static_cast<uint32_t>(_controllers.size()));
+    for (std::map<uint32_t, SocketData>::const_iterator it = _controllers.begin(); it != _controllers.end(); it++)
     {
-        buffer.pack(htons(it->first));
-        buffer.pack(htons(it->second.port));
-        buffer.pack(it->second.ip.S_un.S_un_b.s_b1);
-        buffer.pack(it->second.ip.S_un.S_un_b.s_b2);
-        buffer.pack(it->second.ip.S_un.S_un_b.s_b3);
-        buffer.pack(it->second.ip.S_un.S_un_b.s_b4);
+        if (buffer.getProtocolVersion() < 2)
+            buffer.packBigEndian(static_cast<uint16_t>(it->first));
+        else
+            buffer.packBigEndian(it->first);
+        buffer.packBigEndian(it->second.port);
+        const uint8_t* ip = getAddressBytes(it->second.ip);
+        buffer.pack(ip[0]);
+        buffer.pack(ip[1]);
+        buffer.pack(ip[2]);
+        buffer.pack(ip[3]);
     }
 }
\ No newline at end of file
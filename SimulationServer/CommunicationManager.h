@@ -2,17 +2,29 @@
 #define COMMUNICATION_MANAGER_H
 
 #include <map>
+#include <memory>
 #include <set>
-#include <WinSock2.h>
-#include <Ws2tcpip.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
 #include <iostream>
 
+#include "Simulation/Simulation.h" // includes standard headers, so it goes before min and max macros
+#include "Network/Socket.h"
+#include "Network/ReceiveBuffer.h"
+#include "Network/Frame.h"
+#include "Network/SendQueue.h"
 #include "DistrSimulation.h"
 #include "Simulation/Buffer.h"
+#include "Simulation/Parallel/TripleBuffer.h"
 #include "ClientCommands/ClientCommand.h"
 #include "ClientCommands/RobotSpeedChangeCommands.h"
+#include "ClientCommands/ReplayCommands.h"
 
 class DistrSimulation;
+class Simulation;
 class ClientCommand;
 
 class CommunicationManager
@@ -23,51 +35,238 @@ class CommunicationManager
 
 		const int LISTEN_PORT = 6020;
 		const char* LISTEN_PORT_STR = "6020";
+		static const int MAX_EVENTS = 64; // handled by one epoll_wait call
+		static const int STOP_CHECK_INTERVAL = 200; // milliseconds, select waits at most this long without epoll
+		static const uint32_t MAX_CLIENT_LAG = 250; // snapshots, which client may stay behind, before it is disconnected
+		// kernel buffer of client socket - frames, which do not fit, wait in send queue, where old ones are dropped
+		static const int CLIENT_SEND_BUFFER = 65536;
+		// visualiser frames since protocol version 3
+		static const uint8_t FRAME_TYPE_KEYFRAME = 0;
+		static const uint8_t FRAME_TYPE_DELTA = 1;
+		static const int FRAME_HEADER_SIZE = 1 + 4 + 4 + 4;
+		static const uint32_t KEYFRAME_INTERVAL = 250; // snapshots between keyframes sent to one visualiser
+		static const uint32_t KEYFRAME_RETRY = 25; // snapshots, after which unacknowledged keyframe is sent again
 		static const int NUMBER_OF_CONTROLLER_COMMANDS;
+		static const int NUMBER_OF_VISUALISER_COMMANDS;
 			
 
 		CommunicationManager(DistrSimulation* simulation);
 		~CommunicationManager();
 
-		bool init();
+		bool init(); // also starts broadcast thread
 
-		// starts server loop which receives and responds to clients requests
+		// starts server loop which receives and responds to clients requests (epoll on Linux, select elsewhere)
 		// WARNING: blocks current thread
 		void runServerLoop(); 
 
-		void sendWorldDescriptionToVisualisers();
+		// makes runServerLoop return - it only sets a flag and wakes the loop, so it may be called from a signal handler
+		void requestStop();
 
-        void sendRobotsStatesToControllers();
+		// called by simulation thread after every step: WORLD (the simulation or e.g. world replayed from trajectory)
+		// is copied, if there are any clients, broadcast thread encodes the copy for visualisers and controllers and
+		// sends it; the call never waits for clients and it takes the same time for any protocol variants in use
+		// (fields of entities are copied, whole world only after entities were added or removed)
+		void publishSnapshot(const Simulation& world);
+
+		// what is done with states, which a controller is not able to take (see SendQueue), for new controllers;
+		// visualisers always get the latest frame only
+		void setControllerSendPolicy(uint8_t policy) { _controllerSendPolicy = policy; }
+
+		// how far behind is a client, which has not taken everything sent to it
+		class ClientLag
+		{
+			public:
+				SOCKET socket;
+				bool isController;
+				uint32_t robotId; // of controller
+				uint32_t lag; // snapshots, after which there still was something waiting for the client
+				size_t queuedBytes;
+				uint64_t droppedMessages;
+		};
+		std::vector<ClientLag> getClientLags();
 	private:
+        // entity in world frame of snapshot
+        class EntityRecord
+        {
+            public:
+                uint32_t id;
+                uint32_t offset;
+                uint32_t length;
+                uint32_t changeTick; // the last snapshot, in which the record changed
+        };
+
+        // world frame in one encoding with its records (in order of IDs), if there are visualisers getting deltas
+        class EncodedWorld
+        {
+            public:
+                EncodedWorld() : entitiesTick(0) {}
+                FrameRef frame;
+                std::vector<EntityRecord> records;
+                uint32_t entitiesTick; // the first snapshot with the current set of entities - base of deltas
+        };
+
+        // world published by simulation thread - copy of it with the same entities is shared by snapshots, broadcast
+        // thread applies fields of every snapshot to it before encoding (see Simulation::copyFields)
+        class PublishedWorld
+        {
+            public:
+                PublishedWorld() : tick(0) {}
+                uint32_t tick; // number of the snapshot
+                std::shared_ptr<Simulation> world; // NULL, if there were no clients
+                std::vector<uint8_t> fields;
+        };
+
+        // world encoded once for all clients - only in protocol versions, which connected clients speak (NULL
+        // frames otherwise); frames are shared by send queues of the clients, nothing is copied for them
+        class WorldSnapshot
+        {
+            public:
+                uint32_t tick; // number of the snapshot
+                double time;
+                FrameRef legacyWorld;
+                EncodedWorld world; // protocol version 2 and newer
+                EncodedWorld compactWorld;
+                FrameRef robotStates; // for controllers, one after another
+                std::map<uint32_t, std::pair<size_t, size_t> > robotStateParts; // offset and length by robot ID
+        };
+
+        // keyframe headers and deltas of one snapshot by base snapshot - visualisers have only a few different bases
+        typedef std::vector<std::pair<uint32_t, FrameRef> > UpdateFrames;
+
         class SocketData
         {
             public:
                 SocketData() {}
-                SocketData(SOCKET _socket, uint16_t _port, in_addr _ip) : socket(_socket), port(_port), ip(_ip) {}
+                SocketData(SOCKET _socket, uint16_t _port, in_addr _ip, uint8_t _protocolVersion, uint8_t sendPolicy)
+                    : socket(_socket), port(_port), ip(_ip), protocolVersion(_protocolVersion), output(sendPolicy),
+                    lag(0), isDisconnecting(false), isCompact(false), hasKeyframe(false), keyframeTick(0),
+                    sentTick(0), hasAck(false), ackedTick(0) {}
                 SOCKET socket;
                 uint16_t port;
                 in_addr ip;
+                uint8_t protocolVersion;
+                SendQueue output; // written by broadcast thread only
+                uint32_t lag;
+                bool isDisconnecting; // server thread removes it, when it notices that
+                bool isCompact; // visualiser with CAPABILITY_COMPACT_FRAMES
+                // visualiser getting deltas - the last keyframe and the newest frame sent to it, the newest snapshot
+                // it acknowledged (never newer than the sent one)
+                bool hasKeyframe;
+                uint32_t keyframeTick;
+                uint32_t sentTick;
+                bool hasAck;
+                uint32_t ackedTick;
+        };
+
+        // every accepted client, also the one, which has not finished handshake yet
+        class ClientConnection
+        {
+            public:
+                // what is expected to come from the client
+                static const uint8_t AWAITING_TYPE = 0;
+                static const uint8_t AWAITING_ROBOT_ID = 1;
+                static const uint8_t CONTROLLER_COMMANDS = 2;
+                static const uint8_t VISUALISER_COMMANDS = 3;
+
+                ClientConnection() {}
+                ClientConnection(const sockaddr_in& _address)
+                    : state(AWAITING_TYPE), address(_address), protocolVersion(PROTOCOL_VERSION_1), capabilities(0),
+                    robotId(0) {}
+                uint8_t state;
+                sockaddr_in address;
+                uint8_t protocolVersion;
+                uint8_t capabilities; // granted to the client
+                uint32_t robotId; // of controller
+                ReceiveBuffer input;
         };
 
+		// world frames / keyframe headers and deltas, both filled by broadcast thread, they have to outlive snapshots
+		// and clients
+		FramePool                  _snapshotFrames;
+		FramePool                  _broadcastFrames;
+
 		SOCKET                     _listenSocket; 
 		DistrSimulation*           _simulation;
-		bool                       _isStopped; // if there was request to stop communication manager
-		CRITICAL_SECTION           _clientsMutex; // light mutex used to protect _visualisers to be read and written simultaneously
+		std::atomic<bool>          _isStopped; // if there was request to stop communication manager
+		std::mutex                 _clientsMutex; // light mutex used to protect _visualisers to be read and written simultaneously
+#ifdef __linux__
+		int                        _epoll; // all sockets are registered edge-triggered and non-blocking
+		int                        _wakeup; // eventfd registered in _epoll, written when stop is requested
+#endif
 
-		// connected clients
-		std::map<uint16_t, SocketData>  _controllers;
-		std::set<SOCKET>                _visualisers; // we don't need to distinguish visualisers, each of them has equal rights
+		// connected clients - server thread owns connections, broadcast thread sends to the clients from maps below
+		std::map<SOCKET, ClientConnection>  _connections;
+		std::map<uint32_t, SocketData>  _controllers;
+		// we don't need to distinguish visualisers, each of them has equal rights
+		std::map<SOCKET, SocketData>    _visualisers;
+		uint8_t                         _controllerSendPolicy;
+		std::atomic<uint32_t>           _visualiserVersions; // bit for every protocol version of visualisers
+		std::atomic<bool>               _hasCompactVisualisers; // they are not counted in _visualiserVersions
+		std::atomic<bool>               _hasControllers;
 
-		ClientCommand**                 _validControllerCommands;
+		// simulation thread fills back world, broadcast thread encodes and sends the newest one - slow clients make
+		// it skip snapshots, simulation does not wait for them
+		TripleBuffer<PublishedWorld>    _snapshots;
+		std::mutex                      _snapshotMutex; // only for waiting on _snapshotReady
+		std::condition_variable         _snapshotReady;
+		std::thread                     _broadcastThread;
+		// used by simulation thread only - the copy of world, that is published with fields of entities, while
+		// entities of the world stay the same
+		uint32_t                        _snapshotTick;
+		std::shared_ptr<Simulation>     _publishedWorld;
+		uint64_t                        _publishedVersion;
 
-		bool accept_new_client(); // accepts client, that is trying to connect, and adds it to appropriate clients set
+		// used by broadcast thread only - the snapshot being sent and worlds of the previous one, changed records
+		// are found by comparing; skipped snapshots are never seen by visualisers, so they are not compared
+		WorldSnapshot                   _snapshot;
+		EncodedWorld                    _previousWorld;
+		EncodedWorld                    _previousCompactWorld;
+		std::vector<uint32_t>           _recordOffsets;
+
+		// used by broadcast thread only - emptied after every snapshot, their memory is kept for the next one
+		UpdateFrames                    _updates;
+		UpdateFrames                    _compactUpdates;
+
+		ClientCommand**                 _validControllerCommands;
+		VisualiserCommand**             _validVisualiserCommands;
 
-		// receives and executes messages sent by robot controllers
-		// sockets -> sockets, that have message to receive, get from select function
-		void receive_controllers_messages(fd_set* sockets);
+		void close_listen_socket(); // also epoll and wakeup descriptors, used when init fails and by destructor
+		// accepts client, that is trying to connect - it is added to appropriate clients set after handshake
+		// false if there is no client waiting
+		bool accept_new_client();
+		void watch_socket(SOCKET clientSocket); // client messages are received, when they come
+		// receives all messages waiting in the socket and executes the complete ones
+		void handle_socket(SOCKET clientSocket);
+		// parses client type, protocol version it speaks (see PROTOCOL_VERSION in Constants.h) and ID of controlled
+		// robot, as far as they were received; false if the client was rejected
+		bool parse_handshake(SOCKET clientSocket, ClientConnection& client);
+		// executes all complete commands of robot controller / visualiser, partial one is left in the buffer
+		void execute_controller_commands(ClientConnection& client);
+		void execute_visualiser_commands(SOCKET clientSocket, ClientConnection& client);
+		void acknowledge_frame(SOCKET clientSocket, uint32_t tick);
+		void remove_client(std::map<SOCKET, ClientConnection>::iterator client);
 
-		// the same method for visualisers messages
-		void receive_visualisers_messages(fd_set* sockets);
+        void run_broadcast_loop(); // method of broadcast thread
+        // encodes PUBLISHED world into SNAPSHOT, in every protocol variant the connected clients need
+        void encode_snapshot(const PublishedWorld& published, WorldSnapshot& snapshot);
+        // serializes WORLD into frame of ENCODED (records are listed in _recordOffsets)
+        void encode_world(const Simulation& world, bool isCompact, EncodedWorld& encoded);
+        // marks records of ENCODED world of snapshot TICK, which differ from PREVIOUS world, that becomes ENCODED
+        void find_changed_records(const Simulation& world, uint32_t tick, EncodedWorld& encoded,
+            EncodedWorld& previous);
+        void forget_records(uint32_t tick, EncodedWorld& encoded, EncodedWorld& previous); // nobody needs deltas
+        void broadcast_snapshot(const WorldSnapshot& snapshot);
+        // keyframe or delta of WORLD for VISUALISER speaking protocol version 3 and newer (none, if it has to wait
+        // for acknowledgement); headers and deltas are encoded once for all visualisers into FRAMES, by base snapshot
+        int prepare_update(SocketData& visualiser, const WorldSnapshot& snapshot, const EncodedWorld& world,
+            const FrameRef& controllersData, UpdateFrames& frames, SendQueue::Segment* segments);
+        FrameRef& find_update(UpdateFrames& frames, uint32_t baseTick); // empty frame is added, if there is none
+        void encode_delta(Buffer& buffer, const WorldSnapshot& snapshot, const EncodedWorld& world, uint32_t baseTick,
+            size_t trailerLength);
+        // sends without blocking, what CLIENT is able to take, and disconnects it, if it is behind for too long
+        void flush_client(SocketData& client);
+        void disconnect_client(SocketData& client);
+        void update_clients_summary(); // _visualiserVersions and _hasControllers, call it with _clientsMutex
 
         void serializeControllersData(Buffer& buffer) const;
 };
@@ -1,57 +1,123 @@
-#include "DistrSimulation.h"
+#include <chrono>
 #include <iostream>
+#include <sstream>
 
-DWORD WINAPI SimulationThreadWrapperFunction(LPVOID threadData)
-{
-    DistrSimulation* sim = static_cast<DistrSimulation*>(threadData);
-
-    sim->run();
-
-    return 0; // unused thread return value
-}
+#include "DistrSimulation.h"
 
 DistrSimulation::DistrSimulation(unsigned int worldWidth, unsigned int worldHeight, bool addBounds,
     double simulationStep, int simulationDelay) : Simulation(worldWidth, worldHeight, addBounds, 
-    simulationStep, simulationDelay), _commMan(NULL), _simulationThreadHandle(INVALID_HANDLE_VALUE)
+    simulationStep, simulationDelay), _commMan(NULL), _checkpointer(NULL), _recorder(NULL),
+    _commands(COMMAND_QUEUE_CAPACITY), _maxCommandQueueDepth(0), _droppedCommands(0), _appliedCommands(0)
 {
-    InitializeCriticalSection(&_criticalSection);
 }
 
-DistrSimulation::DistrSimulation(std::ifstream& file, bool readBinary, double simulationStep,
+DistrSimulation::DistrSimulation(std::istream& file, bool readBinary, double simulationStep,
     int simulationDelay) : Simulation(file, readBinary, simulationStep, simulationDelay),
-    _commMan(NULL), _simulationThreadHandle(INVALID_HANDLE_VALUE)
+    _commMan(NULL), _checkpointer(NULL), _recorder(NULL), _commands(COMMAND_QUEUE_CAPACITY),
+    _maxCommandQueueDepth(0), _droppedCommands(0), _appliedCommands(0)
 {
-    InitializeCriticalSection(&_criticalSection);
 }
 
 DistrSimulation::~DistrSimulation()
 {
-    DeleteCriticalSection(&_criticalSection);
+    stop();
 }
 
 void DistrSimulation::start()
 {
     Simulation::start();
-    _simulationThreadHandle = CreateThread(NULL, 0, SimulationThreadWrapperFunction, 
-        static_cast<LPVOID>(this), 0, NULL);
+    _simulationThread = std::thread(&DistrSimulation::run, this);
+}
+
+void DistrSimulation::stop()
+{
+    _isRunning = false;
+    if (_simulationThread.joinable())
+        _simulationThread.join();
+}
+
+bool DistrSimulation::queueMotorSpeedChange(const MotorSpeedChange& change)
+{
+    if (_commands.push(change))
+        return true;
+    _droppedCommands++;
+    return false;
+}
+
+size_t DistrSimulation::applyQueuedCommands()
+{
+    // commands are applied between steps, so update never sees speeds changing under it
+    size_t applied = 0;
+    MotorSpeedChange change;
+    while (_commands.pop(change))
+    {
+        if (change.changeLeft)
+            change.robot->setLeftMotorSpeed(change.leftSpeed);
+        if (change.changeRight)
+            change.robot->setRightMotorSpeed(change.rightSpeed);
+        applied++;
+    }
+    if (applied > _maxCommandQueueDepth)
+        _maxCommandQueueDepth = applied;
+    _appliedCommands += applied;
+    return applied;
 }
 
 void DistrSimulation::run()
 {
     std::cout << "SIMULATION STARTED!\n";;
     int i = 0;
+    uint64_t droppedCommands = 0;
     while (_isRunning)
     {
         lock();
 
-        _commMan->sendWorldDescriptionToVisualisers();
-        _commMan->sendRobotsStatesToControllers();
+        applyQueuedCommands();
+        if (_droppedCommands != droppedCommands)
+        {
+            droppedCommands = _droppedCommands;
+            std::cout << "COMMAND QUEUE FULL, DROPPED COMMANDS: " << droppedCommands << "\n";
+        }
+
+        _commMan->publishSnapshot(*this); // sent by broadcast thread, while the next step is computed
         update();
+        if (_checkpointer != NULL)
+            _checkpointer->stepFinished(*this); // only takes snapshot, it is written by thread of checkpointer
+        if (_recorder != NULL)
+            _recorder->stepFinished(*this);
         std::cout << "STEP: " << i++ << "\n";
 
         unlock();
-        Sleep(_simulationDelay);
+        if (i % STATUS_REPORT_INTERVAL == 0)
+            reportStatus();
+        std::this_thread::sleep_for(std::chrono::milliseconds(_simulationDelay));
     }
 
-    std::cout << "SIMULATION ENDED!\n";
+    // written, when checkpointer is deleted - stopped server can be resumed from the last step
+    if (_checkpointer != NULL)
+        _checkpointer->takeSnapshot(*this);
+    std::cout << "SIMULATION ENDED! COMMANDS APPLIED: " << _appliedCommands << ", DROPPED: " << _droppedCommands
+        << ", MAX QUEUE DEPTH: " << _maxCommandQueueDepth << "\n";
+}
+
+void DistrSimulation::reportStatus()
+{
+    // clients, which take everything sent to them, are only counted
+    std::vector<CommunicationManager::ClientLag> lags = _commMan->getClientLags();
+    size_t lagging = 0;
+    std::ostringstream details;
+    for (size_t i = 0; i < lags.size(); i++)
+    {
+        if (lags[i].lag == 0)
+            continue;
+        lagging++;
+        if (lags[i].isController)
+            details << ", CONTROLLER OF ROBOT " << lags[i].robotId;
+        else
+            details << ", VISUALISER " << lags[i].socket;
+        details << ": " << lags[i].lag << " SNAPSHOTS, " << lags[i].queuedBytes << " BYTES QUEUED, "
+            << lags[i].droppedMessages << " DROPPED";
+    }
+    std::cout << "COMMAND QUEUE DEPTH: " << getCommandQueueDepth() << " (MAX " << getMaxCommandQueueDepth()
+        << ", DROPPED " << getDroppedCommandCount() << "), CLIENTS: " << lags.size() << ", LAGGING: " << lagging << details.str() << "\n";
 }
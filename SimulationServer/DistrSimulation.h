@@ -1,41 +1,84 @@
 #ifndef DISTR_SIMULATION_H
 #define DISTR_SIMULATION_H
 
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+#include "Simulation/Simulation.h" // includes standard headers, so it goes before min and max macros
 #include "CommunicationManager.h"
-#include "Simulation/Simulation.h"
+#include "Simulation/Serialization/Checkpointer.h"
+#include "Simulation/Serialization/TrajectoryRecorder.h"
+#include "Simulation/Parallel/MpscQueue.h"
+#include "Simulation/Entities/KheperaRobot.h"
 
 class CommunicationManager;
 
+// new speeds of robot motors, which are set at the start of the next step
+class MotorSpeedChange
+{
+    public:
+        MotorSpeedChange() {}
+        MotorSpeedChange(KheperaRobot* _robot, bool _changeLeft, double _leftSpeed, bool _changeRight,
+            double _rightSpeed) : robot(_robot), changeLeft(_changeLeft), changeRight(_changeRight),
+            leftSpeed(_leftSpeed), rightSpeed(_rightSpeed) {}
+        KheperaRobot* robot;
+        bool changeLeft;
+        bool changeRight;
+        double leftSpeed;
+        double rightSpeed;
+};
+
 class DistrSimulation : public Simulation
 {
 public:
     friend class CommunicationManager;
-    friend DWORD WINAPI SimulationThreadWrapperFunction(LPVOID threadData);
 
     DistrSimulation(unsigned int worldWidth, unsigned int worldHeight, bool addBounds,
         double simulationStep = DEFAULT_SIMULATION_STEP, int simulationDelay = DEFAULT_SIMULATION_DELAY);
-    DistrSimulation(std::ifstream& file, bool readBinary, double simulationStep = DEFAULT_SIMULATION_STEP,
+    DistrSimulation(std::istream& file, bool readBinary, double simulationStep = DEFAULT_SIMULATION_STEP,
         int simulationDelay = DEFAULT_SIMULATION_DELAY);
-    ~DistrSimulation();
+    virtual ~DistrSimulation();
 
     void start(); // starts simulation
+    void stop(); // waits until simulation thread finishes current step
 
     // methods used to lock and unlock Simulation object for only one thread
     // if object is locked, it can't be locked again, until unlocking
-    void lock() { (&_criticalSection); }
-    void unlock() { (&_criticalSection); }
+    void lock() { _mutex.lock(); }
+    void unlock() { _mutex.unlock(); }
+
+    // called from network threads without locking, simulation thread applies queued changes before every step
+    // false if the queue is full and CHANGE was dropped
+    bool queueMotorSpeedChange(const MotorSpeedChange& change);
+    size_t getCommandQueueDepth() const { return _commands.getSize(); }
+    size_t getMaxCommandQueueDepth() const { return _maxCommandQueueDepth; } // the most changes applied at one step
+    uint64_t getDroppedCommandCount() const { return _droppedCommands; }
 
     void setCommunicationManager(CommunicationManager* commMan) { _commMan = commMan; }
-private:
+    // CHECKPOINTER gets every step from simulation thread, NULL turns checkpoints off
+    void setCheckpointer(Checkpointer* checkpointer) { _checkpointer = checkpointer; }
+    // the same for RECORDER, NULL turns recording off
+    void setRecorder(TrajectoryRecorder* recorder) { _recorder = recorder; }
+protected:
     CommunicationManager*         _commMan;
+    Checkpointer*                 _checkpointer;
+    TrajectoryRecorder*           _recorder;
 
     // simulation runs in separate thread
-    HANDLE                        _simulationThreadHandle;
+    std::thread                   _simulationThread;
+
+    // used to exclusively lock object for only one thread
+    std::mutex                    _mutex;
 
-    // critical section object, used to exclusively lock object for only one thread
-    CRITICAL_SECTION             _criticalSection;
+    MpscQueue<MotorSpeedChange>   _commands;
+    std::atomic<size_t>           _maxCommandQueueDepth;
+    std::atomic<uint64_t>         _droppedCommands;
+    uint64_t                      _appliedCommands;
 
-    void run(); // method called from newly created thread for running simulation
+    virtual void run(); // method called from newly created thread for running simulation
+    size_t applyQueuedCommands(); // simulation thread only, returns number of applied changes
+    void reportStatus(); // prints depth of command queue and clients, which stay behind
 };
 
 
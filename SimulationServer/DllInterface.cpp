@@ -1,21 +1,84 @@
 #include "DllInterface.h"
 
+// seed of simulations created from now on, every one of them has its own random stream
+static uint64_t defaultSeed = (uint64_t) time(NULL);
+// simulations created through this interface and not removed yet, setSeed seeds them too
+static std::set<Simulation*> simulations;
+
+// error of the last world file, that could not be loaded
+static std::string worldError;
+
 Simulation* createSimulation(char* fileName, bool readBinary)
 {
-    std::ifstream file(fileName);
-    Simulation* simulation = new Simulation(file, readBinary);
+    std::ifstream file(fileName, readBinary ? std::ios::in | std::ios::binary : std::ios::in);
+    if (!file)
+    {
+        worldError = std::string("cannot open ") + fileName;
+        return NULL;
+    }
+    Simulation* simulation;
+    try
+    {
+        simulation = new Simulation(file, readBinary);
+    }
+    catch (const WorldFormatError& error)
+    {
+        worldError = std::string(fileName) + ": " + error.what();
+        return NULL;
+    }
+    simulation->setSeed(defaultSeed);
     simulation->start();
+    simulations.insert(simulation);
     return simulation;
 }
 
+Simulation* createSimulationFromImage(char* fileName)
+{
+    WorldImage image;
+    if (!image.open(fileName) || !image.verifyChecksum())
+    {
+        worldError = std::string(fileName) + ": not a valid world image";
+        return NULL;
+    }
+    Simulation* simulation;
+    try
+    {
+        simulation = new Simulation(image);
+    }
+    catch (const WorldFormatError& error)
+    {
+        worldError = std::string(fileName) + ": " + error.what();
+        return NULL;
+    }
+    simulation->setSeed(defaultSeed);
+    simulation->start();
+    simulations.insert(simulation);
+    return simulation;
+}
+
+bool saveWorldImage(Simulation* simulation, char* fileName)
+{
+    WorldImageBuilder image;
+    simulation->serialize(image);
+    return image.write(fileName);
+}
+
+const char* getWorldError()
+{
+    return worldError.c_str();
+}
+
 void removeSimulation(Simulation* simulation)
 {
+    simulations.erase(simulation);
     delete simulation;
 }
 
 Simulation* cloneSimulation(Simulation* simulation)
 {
-    return new Simulation(*simulation);
+    Simulation* clone = new Simulation(*simulation);
+    simulations.insert(clone);
+    return clone;
 }
 
 void updateSimulation(Simulation* simulation, int steps)
@@ -30,12 +93,35 @@ int getRobotCount(Simulation* simulation)
 
 bool fillRobotsIdArray(Simulation* simulation, int* idArray, int arrLength)
 {
-    std::vector<int> robotIds = simulation->getIdsByShape(SimEnt::KHEPERA_ROBOT);
-    for (int i = 0; i < arrLength; i++)
-        idArray[i] = robotIds[i];
+    std::vector<uint32_t> robotIds = simulation->getIdsByShape(SimEnt::KHEPERA_ROBOT);
+    for (int i = 0; i < arrLength && i < (int) robotIds.size(); i++)
+        idArray[i] = (int) robotIds[i];
     return robotIds.size() <= (unsigned int)arrLength;
 }
 
+bool spawnCircularEntity(Simulation* simulation, int id, int weight, bool movable,
+    double x, double y, double radius)
+{
+    return simulation->spawnEntity(simulation->create<CircularEnt>(id, weight, movable, x, y, radius));
+}
+
+bool spawnRectangularEntity(Simulation* simulation, int id, int weight, bool movable,
+    double x, double y, double width, double height, float angle)
+{
+    return simulation->spawnEntity(
+        simulation->create<RectangularEnt>(id, weight, movable, x, y, width, height, angle));
+}
+
+bool spawnLinearEntity(Simulation* simulation, int id, double begX, double begY, double endX, double endY)
+{
+    return simulation->spawnEntity(simulation->create<LinearEnt>(id, begX, begY, endX, endY));
+}
+
+bool despawnEntity(Simulation* simulation, int id)
+{
+    return simulation->despawnEntity(id);
+}
+
 KheperaRobot* getRobot(Simulation* simulation, int robotId)
 {
     SimEnt* entity = simulation->getEntity(robotId);
@@ -74,30 +160,96 @@ float getRobotYCoord(KheperaRobot* robot)
 
 void teleportRobotRandom(Simulation* simulation, KheperaRobot* robot)
 {
-    std::uniform_int_distribution<> rand_w(1, simulation->getWorldWidth() - 1);
-    std::uniform_int_distribution<> rand_h(1, simulation->getWorldHeight() - 1);
-    std::uniform_real_distribution<> rand_angle(0, 6.28);
-
-    int x = rand_w(gen);
-    int y = rand_h(gen);
-    float angle = (float) rand_angle(gen);
-    robot->setDirectionAngle(angle);
-    robot->getCenter().setCoords(x, y);
-    robot->setLeftMotorSpeed(0);
-    robot->setRightMotorSpeed(0);
-    simulation->fillDistanceMap();
-//     simulation->update();
-    x = (int) getRobotXCoord(robot);
-    y = (int) getRobotXCoord(robot);
-
-    if (simulation->getNumCollisions() > 0 || x < 0 || x >= simulation->getWorldWidth() 
-        || y < 0 || y >= simulation->getWorldHeight())
-    {
-        teleportRobotRandom(simulation, robot);
-    }
+    PlacementService(*simulation, simulation->getRandom()).placeRobot(*robot);
+}
+
+int teleportRobotsRandom(Simulation* simulation, KheperaRobot** robots, int count)
+{
+    return PlacementService(*simulation, simulation->getRandom()).placeRobots(robots, count);
 }
 
 void setSeed(int seed)
 {
-    gen.seed(seed);
+    defaultSeed = (uint64_t) seed;
+    for (std::set<Simulation*>::iterator it = simulations.begin(); it != simulations.end(); it++)
+        (*it)->setSeed(defaultSeed);
+}
+
+void setSimulationSeed(Simulation* simulation, uint64_t seed)
+{
+    simulation->setSeed(seed);
+}
+
+void setThreadCount(Simulation* simulation, int threadCount)
+{
+    simulation->setThreadCount(threadCount);
+}
+
+uint64_t getStateHash(Simulation* simulation)
+{
+    return simulation->getStateHash();
+}
+
+void configureAccumulators(Simulation* simulation, int enabledAccumulators,
+    double nearWallDistance, double maxMotorSpeed)
+{
+    AccumulatorsConfig config;
+    config.enabled = (uint32_t) enabledAccumulators;
+    config.nearWallDistance = nearWallDistance;
+    config.maxMotorSpeed = maxMotorSpeed;
+    simulation->setAccumulatorsConfig(config);
+}
+
+void resetAccumulators(Simulation* simulation)
+{
+    simulation->resetAccumulators();
+}
+
+void getRobotAccumulators(KheperaRobot* robot, RobotAccumulators* accumulators)
+{
+    *accumulators = robot->getAccumulators();
+}
+
+int getContactCount(Simulation* simulation)
+{
+    return simulation->getNumCollisions();
+}
+
+bool fillContactsArray(Simulation* simulation, ContactEvent* contacts, int arrLength)
+{
+    const ContactList& list = simulation->getContacts();
+    for (int i = 0; i < arrLength && i < (int) list.size(); i++)
+        contacts[i] = list[i];
+    return list.size() <= (unsigned int)arrLength;
+}
+
+int getRobotContactCount(KheperaRobot* robot)
+{
+    return (int) robot->getContactCount();
+}
+
+int getElmanWeightCount(KheperaRobot* robot)
+{
+    return ElmanNetwork::getWeightCount(robot->getSensorCount(), 2);
+}
+
+bool runEpisode(Simulation* simulation, KheperaRobot* robot, double* weights, int weightCount,
+    int steps, int stepsPerCommand, EpisodeResult* result)
+{
+    ElmanNetwork network(robot->getSensorCount(), 2);
+    if (!network.setWeights(weights, weightCount))
+        return false;
+    return runEpisode(*simulation, *robot, network, steps, stepsPerCommand, *result);
+}
+
+bool runEpisodeBatch(Simulation** simulations, KheperaRobot** robots, int count,
+    double* weights, int weightCount, int steps, int stepsPerCommand, EpisodeResult* results)
+{
+    if (count <= 0)
+        return count == 0;
+    BatchedElmanNetwork networks(count, robots[0]->getSensorCount(), 2);
+    for (int i = 0; i < count; i++)
+        if (!networks.setWeights(i, weights + i * weightCount, weightCount))
+            return false;
+    return runEpisodes(simulations, robots, networks, steps, stepsPerCommand, results);
 }
\ No newline at end of file
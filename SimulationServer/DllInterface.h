@@ -6,29 +6,77 @@
 #define DLL_PUBLIC __attribute__ ((visibility ("default")))
 #endif
 
-#include "Simulation/Simulation.h"
-#include <random>
 #include <ctime>
+#include <set>
+#include "Simulation/Simulation.h"
+#include "Simulation/Entities/CircularEnt.h"
+#include "Simulation/Entities/RectangularEnt.h"
+#include "Simulation/Entities/LinearEnt.h"
+#include "Simulation/Controllers/NeuralController.h"
+#include "Simulation/Spatial/PlacementService.h"
 
-std::mt19937 gen((unsigned int) time(NULL));
 
 // Simulation object management
+// NULL, if file cannot be loaded - getWorldError describes why (e.g. line and column of malformed text)
 extern "C" DLL_PUBLIC Simulation* createSimulation(char* fileName, bool readBinary);
+// world images (see Simulation/Serialization/WorldImage.h) - NULL or false, if file is not a valid image;
+// entities are copied out of the image, it is closed before createSimulationFromImage returns
+extern "C" DLL_PUBLIC Simulation* createSimulationFromImage(char* fileName);
+extern "C" DLL_PUBLIC bool saveWorldImage(Simulation* simulation, char* fileName);
+extern "C" DLL_PUBLIC const char* getWorldError();
 extern "C" DLL_PUBLIC void removeSimulation(Simulation* simulation);
 extern "C" DLL_PUBLIC Simulation* cloneSimulation(Simulation* simulation);
 extern "C" DLL_PUBLIC void updateSimulation(Simulation* simulation, int steps);
 extern "C" DLL_PUBLIC int getRobotCount(Simulation* simulation);
 extern "C" DLL_PUBLIC bool fillRobotsIdArray(Simulation* simulation, int* idArray, int arrLength);
 
+// Adding and removing entities of running simulation (false if ID is reserved or, for spawn, already used)
+extern "C" DLL_PUBLIC bool spawnCircularEntity(Simulation* simulation, int id, int weight, bool movable,
+    double x, double y, double radius);
+extern "C" DLL_PUBLIC bool spawnRectangularEntity(Simulation* simulation, int id, int weight, bool movable,
+    double x, double y, double width, double height, float angle);
+extern "C" DLL_PUBLIC bool spawnLinearEntity(Simulation* simulation, int id, double begX, double begY,
+    double endX, double endY);
+extern "C" DLL_PUBLIC bool despawnEntity(Simulation* simulation, int id);
+
 // Robot object management
 extern "C" DLL_PUBLIC KheperaRobot* getRobot(Simulation* simulation, int robotId);
 extern "C" DLL_PUBLIC int getSensorCount(KheperaRobot* robot);
 extern "C" DLL_PUBLIC float getSensorState(KheperaRobot* robot, int sensorNumber);
 extern "C" DLL_PUBLIC void setRobotSpeed(KheperaRobot* robot, double leftMotor, double rightMotor);
 
+// robot is left where it was, if no free pose was found in DEFAULT_PLACEMENT_ATTEMPTS attempts
 extern "C" DLL_PUBLIC void teleportRobotRandom(Simulation* simulation, KheperaRobot* robot);
+// places all ROBOTS, so that they do not collide with each other either; returns number of placed robots
+extern "C" DLL_PUBLIC int teleportRobotsRandom(Simulation* simulation, KheperaRobot** robots, int count);
 
 extern "C" DLL_PUBLIC float getRobotXCoord(KheperaRobot* robot);
 extern "C" DLL_PUBLIC float getRobotYCoord(KheperaRobot* robot);
 
-extern "C" DLL_PUBLIC void setSeed(int seed);
\ No newline at end of file
+// seeds all existing simulations and the ones created from now on (current time by default), so that random
+// placements depend only on the seed, as with one generator shared by all simulations
+extern "C" DLL_PUBLIC void setSeed(int seed);
+extern "C" DLL_PUBLIC void setSimulationSeed(Simulation* simulation, uint64_t seed);
+
+// Parallel stepping - results are the same for any number of threads, getStateHash can be used to check it
+extern "C" DLL_PUBLIC void setThreadCount(Simulation* simulation, int threadCount);
+extern "C" DLL_PUBLIC uint64_t getStateHash(Simulation* simulation);
+
+// Fitness accumulators (see Metrics/RobotAccumulators.h for ACC_* flags)
+extern "C" DLL_PUBLIC void configureAccumulators(Simulation* simulation, int enabledAccumulators,
+    double nearWallDistance, double maxMotorSpeed);
+extern "C" DLL_PUBLIC void resetAccumulators(Simulation* simulation);
+extern "C" DLL_PUBLIC void getRobotAccumulators(KheperaRobot* robot, RobotAccumulators* accumulators);
+
+// Contacts resolved during last step (see Simulation/ContactEvent.h)
+extern "C" DLL_PUBLIC int getContactCount(Simulation* simulation);
+extern "C" DLL_PUBLIC bool fillContactsArray(Simulation* simulation, ContactEvent* contacts, int arrLength);
+extern "C" DLL_PUBLIC int getRobotContactCount(KheperaRobot* robot);
+
+// Native controllers
+extern "C" DLL_PUBLIC int getElmanWeightCount(KheperaRobot* robot);
+extern "C" DLL_PUBLIC bool runEpisode(Simulation* simulation, KheperaRobot* robot, double* weights, int weightCount,
+    int steps, int stepsPerCommand, EpisodeResult* result);
+// WEIGHTS holds WEIGHT_COUNT weights for every one of COUNT robots, one robot after another
+extern "C" DLL_PUBLIC bool runEpisodeBatch(Simulation** simulations, KheperaRobot** robots, int count,
+    double* weights, int weightCount, int steps, int stepsPerCommand, EpisodeResult* results);
\ No newline at end of file
@@ -0,0 +1,30 @@
+#include "Frame.h"
+
+FramePool::~FramePool()
+{
+    for (size_t i = 0; i < _frames.size(); i++)
+        delete _frames[i];
+}
+
+Frame* FramePool::getFrame(uint8_t protocolVersion, bool isCompact)
+{
+    Frame* frame = NULL;
+    for (size_t i = 0; i < _frames.size() && frame == NULL; i++)
+    {
+        if (_next >= _frames.size())
+            _next = 0;
+        if (_frames[_next]->isFree())
+            frame = _frames[_next];
+        _next++;
+    }
+    if (frame == NULL)
+    {
+        frame = new Frame();
+        _frames.push_back(frame);
+    }
+
+    frame->getBuffer().clear();
+    frame->getBuffer().setProtocolVersion(protocolVersion);
+    frame->getBuffer().setCompact(isCompact);
+    return frame;
+}
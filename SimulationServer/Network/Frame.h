@@ -0,0 +1,73 @@
+#ifndef FRAME_H
+#define FRAME_H
+
+#include <atomic>
+#include <vector>
+
+#include "../Simulation/Buffer.h"
+
+// encoded message shared by send queues of all clients, which get it - it is not copied for them, queues only
+// hold references; when the last one is dropped, pool of the frame can fill it again
+class Frame
+{
+    public:
+        Frame() : _references(0) {}
+
+        Buffer& getBuffer() { return _buffer; }
+        const Buffer& getBuffer() const { return _buffer; }
+
+        void addReference() { _references.fetch_add(1, std::memory_order_relaxed); }
+        void removeReference() { _references.fetch_sub(1, std::memory_order_release); }
+        // data of free frame are not read by any thread any more
+        bool isFree() const { return _references.load(std::memory_order_acquire) == 0; }
+
+    private:
+        Frame(const Frame& other);
+
+        Buffer              _buffer;
+        std::atomic<int>    _references;
+};
+
+// counted reference to frame, NULL by default
+class FrameRef
+{
+    public:
+        FrameRef(Frame* frame = NULL) : _frame(frame) { if (_frame != NULL) _frame->addReference(); }
+        FrameRef(const FrameRef& other) : _frame(other._frame) { if (_frame != NULL) _frame->addReference(); }
+        ~FrameRef() { if (_frame != NULL) _frame->removeReference(); }
+        FrameRef& operator=(const FrameRef& other)
+        {
+            if (other._frame != NULL)
+                other._frame->addReference();
+            if (_frame != NULL)
+                _frame->removeReference();
+            _frame = other._frame;
+            return *this;
+        }
+
+        Frame* get() const { return _frame; }
+        const Buffer* operator->() const { return &_frame->getBuffer(); }
+
+    private:
+        Frame*  _frame;
+};
+
+// frames filled by one thread - they are allocated only until there are enough of them for all references kept
+// by clients, then free ones are reused; pool has to outlive all references to its frames
+class FramePool
+{
+    public:
+        FramePool() : _next(0) {}
+        ~FramePool();
+
+        // empty frame for messages in PROTOCOL_VERSION (compact encoding, if IS_COMPACT)
+        Frame* getFrame(uint8_t protocolVersion, bool isCompact = false);
+
+    private:
+        FramePool(const FramePool& other);
+
+        std::vector<Frame*> _frames;
+        size_t              _next; // frames are freed mostly in order, in which they were taken
+};
+
+#endif
@@ -0,0 +1,28 @@
+#include "ReceiveBuffer.h"
+
+#include <string.h>
+
+bool ReceiveBuffer::receive(SOCKET socket)
+{
+    // parsed bytes are dropped, so the buffer grows only with messages, which are not complete
+    if (_start > 0)
+    {
+        size_t length = getLength();
+        if (length > 0)
+            memmove(_data.data(), _data.data() + _start, length);
+        _data.resize(length);
+        _start = 0;
+    }
+
+    while (true)
+    {
+        size_t length = _data.size();
+        _data.resize(length + RECEIVE_CHUNK);
+        int received = recv(socket, reinterpret_cast<char*>(_data.data() + length), RECEIVE_CHUNK, 0);
+        _data.resize(length + (received > 0 ? received : 0));
+        if (received == 0)
+            return false;
+        if (received < 0)
+            return isWouldBlockError(getSocketError());
+    }
+}
@@ -0,0 +1,31 @@
+#ifndef RECEIVE_BUFFER_H
+#define RECEIVE_BUFFER_H
+
+#include <stddef.h>
+#include <vector>
+
+#include "Socket.h"
+
+// bytes received from one connection, which were not parsed yet - messages are parsed only when they are complete,
+// so a partial message waits here for its rest instead of blocking the server
+class ReceiveBuffer
+{
+    public:
+        static const int RECEIVE_CHUNK = 4096; // bytes asked from the socket by one recv call
+
+        ReceiveBuffer() : _start(0) {}
+
+        // appends everything waiting in non-blocking SOCKET; false if the connection was closed or broken
+        bool receive(SOCKET socket);
+
+        const uint8_t* getData() const { return _data.data() + _start; }
+        size_t getLength() const { return _data.size() - _start; }
+        // LENGTH bytes from the beginning were parsed
+        void consume(size_t length) { _start += length; }
+
+    private:
+        std::vector<uint8_t>    _data;
+        size_t                  _start; // of bytes not parsed yet
+};
+
+#endif
@@ -0,0 +1,99 @@
+#include "SendQueue.h"
+
+SendQueue::SendQueue(uint8_t policy, size_t capacity) : _policy(policy), _messages(capacity), _first(0),
+    _count(0), _sent(0), _droppedCount(0)
+{
+}
+
+bool SendQueue::push(const Segment* segments, int count)
+{
+    // partially sent message has to be finished, otherwise client would lose track of message boundaries
+    size_t started = _sent > 0 ? 1 : 0;
+    if (_policy == LATEST_ONLY && _count > started)
+    {
+        _droppedCount += _count - started;
+        while (_count > started)
+            release((_first + --_count) % _messages.size());
+    }
+    if (_count >= _messages.size())
+        return false;
+
+    Message& message = _messages[(_first + _count) % _messages.size()];
+    message.count = count;
+    message.length = 0;
+    for (int i = 0; i < count; i++)
+    {
+        message.segments[i] = segments[i];
+        message.length += segments[i].length;
+    }
+    for (int i = count; i < MAX_SEGMENTS; i++)
+        message.segments[i].frame = FrameRef();
+    _count++;
+    return true;
+}
+
+void SendQueue::release(size_t index)
+{
+    Message& message = _messages[index];
+    for (int i = 0; i < message.count; i++)
+        message.segments[i].frame = FrameRef();
+    message.count = 0;
+}
+
+void SendQueue::pop()
+{
+    release(_first);
+    _first = (_first + 1) % _messages.size();
+    _count--;
+    _sent = 0;
+}
+
+bool SendQueue::flush(SOCKET socket)
+{
+    while (_count > 0)
+    {
+        // waiting messages are sent by one call, as far as MAX_SOCKET_BUFFERS allows
+        SocketBuffer buffers[MAX_SOCKET_BUFFERS];
+        int numberOfBuffers = 0;
+        size_t skip = _sent;
+        for (size_t i = 0; i < _count && numberOfBuffers + MAX_SEGMENTS <= MAX_SOCKET_BUFFERS; i++)
+        {
+            const Message& message = _messages[(_first + i) % _messages.size()];
+            for (int j = 0; j < message.count; j++)
+            {
+                const Segment& segment = message.segments[j];
+                if (skip >= segment.length)
+                {
+                    skip -= segment.length;
+                    continue;
+                }
+                buffers[numberOfBuffers].data = segment.frame->getBuffer() + segment.offset + skip;
+                buffers[numberOfBuffers].length = segment.length - skip;
+                numberOfBuffers++;
+                skip = 0;
+            }
+        }
+
+        int sent = sendBuffers(socket, buffers, numberOfBuffers);
+        if (sent < 0)
+            return isWouldBlockError(getSocketError());
+        size_t remaining = _sent + sent;
+        while (_count > 0 && remaining >= _messages[_first].length)
+        {
+            remaining -= _messages[_first].length;
+            pop();
+        }
+        _sent = remaining;
+        if (_count > 0 && sent == 0)
+            return true;
+    }
+    return true;
+}
+
+size_t SendQueue::getQueuedBytes() const
+{
+    size_t bytes = 0;
+    for (size_t i = 0; i < _count; i++)
+        bytes += _messages[(_first + i) % _messages.size()].length;
+    return bytes - _sent;
+}
@@ -0,0 +1,66 @@
+#ifndef SEND_QUEUE_H
+#define SEND_QUEUE_H
+
+#include <stddef.h>
+#include <vector>
+
+#include "Socket.h"
+#include "Frame.h"
+
+// messages waiting to be sent to one client - they are written without blocking, as much as the socket takes,
+// the rest waits for the next flush; messages are not copied, queue refers to parts of shared frames
+class SendQueue
+{
+    public:
+        // what happens with messages, which client is not able to take
+        static const uint8_t KEEP_ALL = 0; // every message is sent, queue overflows after CAPACITY messages
+        static const uint8_t LATEST_ONLY = 1; // new message replaces waiting ones (not the one partially sent)
+        static const size_t DEFAULT_CAPACITY = 64; // messages
+        static const int MAX_SEGMENTS = 3; // of one message
+
+        // LENGTH bytes from OFFSET in FRAME
+        class Segment
+        {
+            public:
+                Segment() : offset(0), length(0) {}
+                Segment(const FrameRef& _frame, size_t _offset, size_t _length)
+                    : frame(_frame), offset(_offset), length(_length) {}
+                FrameRef frame;
+                size_t offset;
+                size_t length;
+        };
+
+        SendQueue(uint8_t policy = LATEST_ONLY, size_t capacity = DEFAULT_CAPACITY);
+
+        // message made of COUNT SEGMENTS sent one after another, false if the queue overflowed (KEEP_ALL only) -
+        // message is not added then
+        bool push(const Segment* segments, int count);
+        // false if the connection is broken
+        bool flush(SOCKET socket);
+
+        bool isEmpty() const { return _count == 0; }
+        size_t getQueuedBytes() const;
+        uint64_t getDroppedCount() const { return _droppedCount; } // messages replaced by newer ones
+
+    private:
+        class Message
+        {
+            public:
+                Message() : count(0), length(0) {}
+                Segment segments[MAX_SEGMENTS];
+                int count;
+                size_t length;
+        };
+
+        void release(size_t index); // frames of message in the slot
+        void pop(); // the first message was sent
+
+        uint8_t                 _policy;
+        std::vector<Message>    _messages; // ring allocated at once, frames of sent messages are released
+        size_t                  _first;
+        size_t                  _count;
+        size_t                  _sent; // bytes of the first message
+        uint64_t                _droppedCount;
+};
+
+#endif
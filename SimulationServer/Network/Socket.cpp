@@ -0,0 +1,152 @@
+#include "Socket.h"
+
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+bool initSockets()
+{
+#ifdef _WIN32
+    WSADATA wsaData;
+    return WSAStartup(MAKEWORD(2, 2), &wsaData) == 0;
+#else
+    // writing to socket closed by client has to be reported as an error, not with SIGPIPE
+    signal(SIGPIPE, SIG_IGN);
+    return true;
+#endif
+}
+
+void cleanupSockets()
+{
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
+
+int getSocketError()
+{
+#ifdef _WIN32
+    return WSAGetLastError();
+#else
+    return errno;
+#endif
+}
+
+bool isWouldBlockError(int error)
+{
+#ifdef _WIN32
+    return error == WSAEWOULDBLOCK;
+#else
+    return error == EAGAIN || error == EWOULDBLOCK;
+#endif
+}
+
+void closeSocket(SOCKET socket)
+{
+#ifdef _WIN32
+    closesocket(socket);
+#else
+    close(socket);
+#endif
+}
+
+bool setNonBlocking(SOCKET socket)
+{
+#ifdef _WIN32
+    u_long mode = 1;
+    return ioctlsocket(socket, FIONBIO, &mode) == 0;
+#else
+    int flags = fcntl(socket, F_GETFL, 0);
+    return flags != -1 && fcntl(socket, F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+}
+
+// waits until SOCKET is ready for reading (or writing, if FOR_WRITING)
+static bool waitForSocket(SOCKET socket, bool forWriting)
+{
+#ifdef _WIN32
+    fd_set sockets;
+    FD_ZERO(&sockets);
+    FD_SET(socket, &sockets);
+    return select(0, forWriting ? NULL : &sockets, forWriting ? &sockets : NULL, NULL, NULL) > 0;
+#else
+    pollfd descriptor;
+    descriptor.fd = socket;
+    descriptor.events = forWriting ? POLLOUT : POLLIN;
+    int result;
+    do
+        result = poll(&descriptor, 1, -1);
+    while (result < 0 && errno == EINTR);
+    return result > 0;
+#endif
+}
+
+bool receiveAll(SOCKET socket, void* data, int length)
+{
+    char* position = static_cast<char*>(data);
+    while (length > 0)
+    {
+        int received = recv(socket, position, length, 0);
+        if (received == 0)
+            return false;
+        if (received < 0)
+        {
+            if (!isWouldBlockError(getSocketError()) || !waitForSocket(socket, false))
+                return false;
+            continue;
+        }
+        position += received;
+        length -= received;
+    }
+    return true;
+}
+
+bool sendAll(SOCKET socket, const void* data, int length)
+{
+    const char* position = static_cast<const char*>(data);
+    while (length > 0)
+    {
+        int sent = send(socket, position, length, 0);
+        if (sent < 0)
+        {
+            if (!isWouldBlockError(getSocketError()) || !waitForSocket(socket, true))
+                return false;
+            continue;
+        }
+        position += sent;
+        length -= sent;
+    }
+    return true;
+}
+
+int sendBuffers(SOCKET socket, const SocketBuffer* buffers, int count)
+{
+#ifdef _WIN32
+    WSABUF parts[MAX_SOCKET_BUFFERS];
+    for (int i = 0; i < count; i++)
+    {
+        parts[i].buf = const_cast<char*>(static_cast<const char*>(buffers[i].data));
+        parts[i].len = static_cast<ULONG>(buffers[i].length);
+    }
+    DWORD sent;
+    if (WSASend(socket, parts, count, &sent, 0, NULL, NULL) != 0)
+        return SOCKET_ERROR;
+    return static_cast<int>(sent);
+#else
+    iovec parts[MAX_SOCKET_BUFFERS];
+    for (int i = 0; i < count; i++)
+    {
+        parts[i].iov_base = const_cast<void*>(buffers[i].data);
+        parts[i].iov_len = buffers[i].length;
+    }
+    msghdr message = msghdr();
+    message.msg_iov = parts;
+    message.msg_iovlen = count;
+    return static_cast<int>(sendmsg(socket, &message, 0));
+#endif
+}
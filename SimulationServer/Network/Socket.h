@@ -0,0 +1,61 @@
+#ifndef SOCKET_H
+#define SOCKET_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// the same socket API on Windows (WinSock) and Linux (BSD sockets) - names follow WinSock
+
+#ifdef _WIN32
+#include <WinSock2.h>
+#include <Ws2tcpip.h>
+
+typedef int socklen_t;
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+
+typedef int SOCKET;
+
+#define INVALID_SOCKET  (-1)
+#define SOCKET_ERROR    (-1)
+#define SD_RECEIVE      SHUT_RD
+#define SD_SEND         SHUT_WR
+#define SD_BOTH         SHUT_RDWR
+#endif
+
+// WSAStartup and WSACleanup on Windows, nothing elsewhere (but broken pipes do not kill the server)
+bool initSockets();
+void cleanupSockets();
+
+int getSocketError(); // of the last failed call in this thread
+bool isWouldBlockError(int error); // operation on non-blocking socket would have to wait
+void closeSocket(SOCKET socket);
+bool setNonBlocking(SOCKET socket);
+
+// the whole LENGTH bytes - waits for them also on non-blocking socket; false, if connection was closed or broken
+bool receiveAll(SOCKET socket, void* data, int length);
+bool sendAll(SOCKET socket, const void* data, int length);
+
+// part of data sent by sendBuffers
+struct SocketBuffer
+{
+    const void* data;
+    size_t      length;
+};
+#define MAX_SOCKET_BUFFERS  16 // passed to one sendBuffers call
+
+// sends as much of COUNT BUFFERS, as socket takes, by one call (gathering write - buffers are not copied together)
+// returns number of bytes sent or SOCKET_ERROR
+int sendBuffers(SOCKET socket, const SocketBuffer* buffers, int count);
+
+// the 4 bytes of IPv4 address in network order, the first one is the highest part of address
+inline const uint8_t* getAddressBytes(const in_addr& address)
+{
+    return reinterpret_cast<const uint8_t*>(&address);
+}
+
+#endif
@@ -0,0 +1,57 @@
+#include <chrono>
+#include <iostream>
+
+#include "ReplaySimulation.h"
+#include "CommunicationManager.h"
+
+ReplaySimulation::ReplaySimulation(TrajectoryReader& reader, int simulationDelay)
+    : DistrSimulation(reader.getSimulation()->getWorldWidth(), reader.getSimulation()->getWorldHeight(), false,
+    DEFAULT_SIMULATION_STEP, simulationDelay), _reader(reader), _recordedStep(DEFAULT_SIMULATION_STEP), _speed(1),
+    _seekTick(-1)
+{
+    // steps between keyframes are known from the index, without reading the records
+    const std::vector<TrajectoryKeyframe>& keyframes = _reader.getKeyframes();
+    if (keyframes.size() > 1 && keyframes[1].tick > keyframes[0].tick)
+        _recordedStep = (keyframes[1].time - keyframes[0].time) / (keyframes[1].tick - keyframes[0].tick);
+}
+
+bool ReplaySimulation::seek(uint32_t tick)
+{
+    if (tick >= _reader.getStepCount())
+        return false;
+    _seekTick = tick;
+    return true;
+}
+
+void ReplaySimulation::run()
+{
+    std::cout << "REPLAY STARTED! " << _reader.getStepCount() << " STEPS\n";
+    double ticksDue = 0; // recorded steps, that should have been shown already
+    while (_isRunning)
+    {
+        int64_t seekTick = _seekTick.exchange(-1);
+        if (seekTick >= 0)
+        {
+            ticksDue = 0;
+            if (!_reader.seek((uint32_t) seekTick))
+                std::cout << "SEEK TO STEP " << seekTick << " FAILED\n";
+        }
+        else
+        {
+            // with higher speeds, visualisers get every n-th step only
+            ticksDue += _speed * _simulationDelay / 1000.0 / _recordedStep;
+            while (ticksDue >= 1 && _reader.next())
+                ticksDue -= 1;
+            if (ticksDue >= 1)
+                ticksDue = 0; // end of trajectory, the last step is shown until seek
+        }
+
+        lock();
+        if (_reader.getSimulation() != NULL) // NULL only after failed seek
+            _commMan->publishSnapshot(*_reader.getSimulation());
+        unlock();
+        std::this_thread::sleep_for(std::chrono::milliseconds(_simulationDelay));
+    }
+
+    std::cout << "REPLAY ENDED!\n";
+}
@@ -0,0 +1,32 @@
+#ifndef REPLAY_SIMULATION_H
+#define REPLAY_SIMULATION_H
+
+#include <atomic>
+
+#include "DistrSimulation.h"
+#include "Simulation/Serialization/TrajectoryReader.h"
+
+// serves recorded trajectory to visualisers instead of stepping physics - frames are built from world of
+// the reader, which streams the file; controllers cannot connect, as there are no robots in this simulation
+class ReplaySimulation : public DistrSimulation
+{
+public:
+    // READER has to be open, its first step gives sizes of the world
+    ReplaySimulation(TrajectoryReader& reader, int simulationDelay = DEFAULT_SIMULATION_DELAY);
+    ~ReplaySimulation() { stop(); } // before the reader can go away
+
+    // multiplier of recorded time, 0 pauses playback; both can be called from any thread
+    void setPlaybackSpeed(double speed) { _speed = speed > 0 ? speed : 0; }
+    bool seek(uint32_t tick); // false if there is no such step, the seek itself is done by simulation thread
+
+protected:
+    void run();
+
+private:
+    TrajectoryReader&        _reader;
+    double                   _recordedStep; // simulation time of one recorded step
+    std::atomic<double>      _speed;
+    std::atomic<int64_t>     _seekTick; // -1 if there is no seek waiting
+};
+
+#endif
@@ -1,10 +1,28 @@
+#include <stdlib.h>
+#include <new>
+
 #include "Buffer.h"
 
-Buffer::Buffer(int length)
+Buffer::Buffer(int length, uint8_t protocolVersion) : _data(NULL), _length(0), _capacity(0),
+	_protocolVersion(protocolVersion), _isCompact(false), _compactUnit(1)
 {
-	_buffer.reserve(length);
+	reserve(length);
 }
 
 Buffer::~Buffer()
 {
-}
\ No newline at end of file
+	free(_data);
+}
+
+void Buffer::grow(size_t length)
+{
+	// doubling keeps packing of a growing message amortized constant
+	size_t capacity = _capacity < 64 ? 64 : 2 * _capacity;
+	if (capacity < length)
+		capacity = length;
+	uint8_t* data = static_cast<uint8_t*>(realloc(_data, capacity));
+	if (data == NULL)
+		throw std::bad_alloc();
+	_data = data;
+	_capacity = capacity;
+}
@@ -2,37 +2,154 @@
 #define BUFFER_H
 
 #include <cstring>
-#include <vector>
+#include <stddef.h>
 #include <stdint.h>
 
-// class used for binary data packing and unpacking in network transmission
+#include "Constants.h"
 
+// classes used for binary data packing and unpacking in network transmission
+
+// unsigned integers in network byte order (big-endian) - the same on every host, no socket header is needed
+template <typename T>
+inline void storeBigEndian(uint8_t* data, T value)
+{
+	for (int i = sizeof(T) - 1; i >= 0; i--)
+	{
+		data[i] = static_cast<uint8_t>(value);
+		value = static_cast<T>(value >> 8);
+	}
+}
+
+template <typename T>
+inline T loadBigEndian(const uint8_t* data)
+{
+	T value = 0;
+	for (size_t i = 0; i < sizeof(T); i++)
+		value = static_cast<T>(value << 8 | data[i]);
+	return value;
+}
+
+// growable byte writer - memory is allocated once for many messages, if the buffer is cleared and reused
 class Buffer
 {
 	public:
-		Buffer(int length = 0);
+		// LENGTH is a size hint - memory for that many bytes is reserved at once
+		Buffer(int length = 0, uint8_t protocolVersion = PROTOCOL_VERSION);
 		~Buffer();
 
+		// DATA as it is in memory (host byte order)
 		template <typename T>
 		void pack(const T& data);
+		// integer VALUE in network byte order
+		template <typename T>
+		void packBigEndian(T value);
+		void append(const uint8_t* data, int length);
+
+		// makes room for LENGTH bytes in total, so that packing them does not reallocate
+		void reserve(size_t length) { if (length > _capacity) grow(length); }
+		// space for at most LENGTH bytes written directly at the end, advance then adds written bytes to the buffer
+		uint8_t* getTail(size_t length) { reserve(_length + length); return _data + _length; }
+		void advance(size_t length) { _length += length; }
 
-		uint8_t* getBuffer() { return &_buffer[0]; }
-		int getLength() const { return _buffer.size(); }
+		uint8_t* getBuffer() { return _data; }
+		const uint8_t* getBuffer() const { return _data; }
+		int getLength() const { return static_cast<int>(_length); }
+		size_t getCapacity() const { return _capacity; }
+		void clear() { _length = 0; } // memory is kept for the next message
+		// version of the protocol spoken by receiver, serialized objects choose their format according to it
+		uint8_t getProtocolVersion() const { return _protocolVersion; }
+		void setProtocolVersion(uint8_t protocolVersion) { _protocolVersion = protocolVersion; }
+		// compact encoding (capability of protocol version 4) - positions and lengths are integer multiples
+		// of compact unit, which world being serialized sets according to its size
+		bool isCompact() const { return _isCompact; }
+		void setCompact(bool isCompact) { _isCompact = isCompact; }
+		double getCompactUnit() const { return _compactUnit; }
+		void setCompactUnit(double unit) { _compactUnit = unit; }
 
 	private:
 		// no cloning
-		Buffer(const Buffer& other) {}
+		Buffer(const Buffer& other);
+		Buffer& operator=(const Buffer& other);
 
-		std::vector<uint8_t>   _buffer;
+		void grow(size_t length); // reallocates to at least LENGTH bytes, keeps the content
+
+		uint8_t*               _data;
+		size_t                 _length;
+		size_t                 _capacity;
+		uint8_t                _protocolVersion;
+		bool                   _isCompact;
+		double                 _compactUnit;
 };
 
 template <typename T>
 void Buffer::pack(const T& data)
 {
-	const uint8_t* ptr = reinterpret_cast<const uint8_t*>(&data);
+	memcpy(getTail(sizeof(data)), &data, sizeof(data));
+	_length += sizeof(data);
+}
+
+template <typename T>
+void Buffer::packBigEndian(T value)
+{
+	storeBigEndian(getTail(sizeof(value)), value);
+	_length += sizeof(value);
+}
 
-	for (int i = 0; i < sizeof(data); i++)
-		_buffer.push_back(ptr[i]);
+inline void Buffer::append(const uint8_t* data, int length)
+{
+	memcpy(getTail(length), data, length);
+	_length += length;
 }
 
-#endif
\ No newline at end of file
+// reads packed data in place (from buffer, frame or received bytes) - nothing is copied until it is unpacked;
+// reading past the end fails and leaves the reader failed, so a message can be decoded first and checked once
+class BufferReader
+{
+	public:
+		BufferReader(const uint8_t* data, size_t length) : _data(data), _end(data + length), _failed(false) {}
+		explicit BufferReader(const Buffer& buffer)
+			: _data(buffer.getBuffer()), _end(buffer.getBuffer() + buffer.getLength()), _failed(false) {}
+
+		// DATA as it is in memory (host byte order)
+		template <typename T>
+		bool unpack(T& data)
+		{
+			const uint8_t* bytes = read(sizeof(data));
+			if (bytes != NULL)
+				memcpy(&data, bytes, sizeof(data));
+			return bytes != NULL;
+		}
+		// integer VALUE in network byte order
+		template <typename T>
+		bool unpackBigEndian(T& value)
+		{
+			const uint8_t* bytes = read(sizeof(value));
+			if (bytes != NULL)
+				value = loadBigEndian<T>(bytes);
+			return bytes != NULL;
+		}
+		// the next LENGTH bytes in place, NULL if there are not so many
+		const uint8_t* read(size_t length)
+		{
+			if (_failed || length > getRemaining())
+			{
+				_failed = true;
+				return NULL;
+			}
+			const uint8_t* data = _data;
+			_data += length;
+			return data;
+		}
+		bool skip(size_t length) { return read(length) != NULL; }
+
+		const uint8_t* getPosition() const { return _data; }
+		size_t getRemaining() const { return _end - _data; }
+		bool hasFailed() const { return _failed; }
+
+	private:
+		const uint8_t*   _data;
+		const uint8_t*   _end;
+		bool             _failed;
+};
+
+#endif
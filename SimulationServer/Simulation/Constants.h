@@ -4,20 +4,83 @@
 #include <map>
 #include <stdint.h>
 
+#include "Memory/Arena.h"
+#include "Math/Scalar.h"
+
 // SIMULATION CONSTANTS
 #define NUMBER_OF_CHECKS            3
 #define DIVIDING_LEVEL              3
-#define RESERVED_ID_LEVEL           1000
-#define MAX_ID_LEVEL                1020
+#define RESERVED_ID_LEVEL           0xFFFFFF00u // IDs from here up are used internally (e.g. world bounds)
+#define RESERVED_ID_LEVEL_V1        1000 // the same in world file format version 1
 #define NO_COLLISION	            -10000
 #define INF_COLLISION               1000000
 #define EPS                         0.0001
+#define DEFAULT_GRID_CELL_SIZE      64 // should be close to size of a robot
+#define DEFAULT_PLACEMENT_ATTEMPTS  100
+#define DEFAULT_RANDOM_SEED         0
 
 #define DEFAULT_SIMULATION_STEP     0.04
 #define DEFAULT_SIMULATION_DELAY    40
+// WORLD FILE FORMAT
+// version 1 has no header, 16-bit entity IDs and 16-bit entity count
+// version 2 starts with magic number (binary) or WORLD keyword (text) followed by version
+#define WORLD_FILE_MAGIC            0x444C574Bu // "KWLD" read as little endian
+#define WORLD_FORMAT_VERSION        2
+// world image - column-oriented binary world, which is memory-mapped instead of parsed (see Serialization/WorldImage.h)
+#define WORLD_IMAGE_MAGIC           0x474D494Bu // "KIMG" read as little endian
+#define WORLD_IMAGE_VERSION         1
+#define WORLD_IMAGE_ALIGNMENT       64 // of every column, so that it can be read by vector instructions
+// checkpoint - compressed binary world file, written periodically by server (see Serialization/Checkpointer.h)
+#define CHECKPOINT_MAGIC            0x4B48434Bu // "KCHK" read as little endian
+#define CHECKPOINT_VERSION          2
+#define DEFAULT_CHECKPOINT_INTERVAL 1500 // steps, a minute of simulation time
+// trajectory - keyframes and quantised deltas of every step (see Serialization/TrajectoryRecorder.h)
+#define TRAJECTORY_MAGIC            0x4A52544Bu // "KTRJ" read as little endian
+#define TRAJECTORY_INDEX_MAGIC      0x5844494Bu // "KIDX" read as little endian
+#define TRAJECTORY_VERSION          1
+#define DEFAULT_KEYFRAME_INTERVAL   250 // steps, 10 seconds of simulation time
+#define DEFAULT_POSITION_STEP       (1.0 / 64) // quantisation of positions in trajectory
+#define DEFAULT_ANGLE_STEP          (1.0 / 4096) // quantisation of headings in trajectory [ rad ]
+#define TRAJECTORY_QUEUE_CAPACITY   1024 // steps waiting for writer thread
+
+// NETWORK PROTOCOL
+// client announces version by setting the highest bit of its type byte and sending version byte
+// right after it; clients, which do not, speak version 1 (16-bit IDs and counts, 8-bit controllers count);
+// visualisers speaking version 3 get keyframes and deltas of changed entities (see CommunicationManager.cpp);
+// since version 4 capabilities byte follows the version
+#define PROTOCOL_VERSION_1          1
+#define PROTOCOL_VERSION_2          2
+#define PROTOCOL_VERSION_3          3
+#define PROTOCOL_VERSION_4          4
+#define PROTOCOL_VERSION            PROTOCOL_VERSION_4
+#define PROTOCOL_VERSION_FLAG       0x80
+#define CAPABILITY_COMPACT_FRAMES   0x01 // visualiser gets quantised frames (see CompactWriter in Fields.h)
+#define COMPACT_STEPS               65535 // positions in compact frames, along the longer side of the world
+#define COMMAND_QUEUE_CAPACITY      1024 // controller commands waiting for the next step, the rest is dropped
+#define STATUS_REPORT_INTERVAL      250 // steps between status lines printed by server
+
+#define DEFAULT_MAX_MOTOR_SPEED     5 // [ rad / sec ], the same as Controller.MAX_ABS_SPEED in GeneticEvolver
 
 class SimEnt;
-typedef std::map<int, double>  DistanceMap;
-typedef std::map<uint16_t, SimEnt*> SimEntMap;
+
+// gap between two entities at the moment, when their odometers summed up to ODOMETERS - it shrinks at most
+// by the distance they travelled since then; valid only while both of them are the ones it was computed for,
+// serials of entities are never reused, even if their slots are
+struct CachedDistance
+{
+    CachedDistance() : distance(0), odometers(0), fstSerial(0), sndSerial(0) {}
+
+    double      distance; // kept in double precision in every build, so that the bound stays conservative
+    double      odometers;
+    uint32_t    fstSerial; // serial of entity in lower slot
+    uint32_t    sndSerial;
+};
+
+// both maps keep their nodes in arena of the Simulation, that owns them
+// distances are keyed by slots of both entities, lower one in the high half
+typedef std::map<uint64_t, CachedDistance, std::less<uint64_t>,
+    ArenaAllocator<std::pair<const uint64_t, CachedDistance> > > DistanceMap;
+typedef std::map<uint32_t, SimEnt*, std::less<uint32_t>,
+    ArenaAllocator<std::pair<const uint32_t, SimEnt*> > > SimEntMap;
 
 #endif
\ No newline at end of file
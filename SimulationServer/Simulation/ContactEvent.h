@@ -0,0 +1,22 @@
+#ifndef CONTACT_EVENT_H
+#define CONTACT_EVENT_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "Memory/Arena.h"
+
+// single collision resolved by Simulation during last step
+// plain structure, so that it can be passed directly through DllInterface
+struct ContactEvent
+{
+    uint32_t    fstId;
+    uint32_t    sndId;
+    double      penetration; // how deep entities were inside each other, before collision was removed
+    double      x;           // contact point coords
+    double      y;
+};
+
+typedef std::vector<ContactEvent, ArenaAllocator<ContactEvent> > ContactList;
+
+#endif
@@ -0,0 +1,81 @@
+#include "BatchedElmanNetwork.h"
+
+#include <algorithm>
+
+#if ELMAN_BATCH_LANES == 4
+#include <immintrin.h>
+typedef __m256d Lanes;
+static inline Lanes loadLanes(const double* ptr) { return _mm256_loadu_pd(ptr); }
+static inline void storeLanes(double* ptr, Lanes value) { _mm256_storeu_pd(ptr, value); }
+static inline Lanes mulAddLanes(Lanes acc, Lanes a, Lanes b) { return _mm256_add_pd(acc, _mm256_mul_pd(a, b)); }
+#elif ELMAN_BATCH_LANES == 2
+#include <emmintrin.h>
+typedef __m128d Lanes;
+static inline Lanes loadLanes(const double* ptr) { return _mm_loadu_pd(ptr); }
+static inline void storeLanes(double* ptr, Lanes value) { _mm_storeu_pd(ptr, value); }
+static inline Lanes mulAddLanes(Lanes acc, Lanes a, Lanes b) { return _mm_add_pd(acc, _mm_mul_pd(a, b)); }
+#else
+typedef double Lanes;
+static inline Lanes loadLanes(const double* ptr) { return *ptr; }
+static inline void storeLanes(double* ptr, Lanes value) { *ptr = value; }
+static inline Lanes mulAddLanes(Lanes acc, Lanes a, Lanes b) { return acc + a * b; }
+#endif
+
+const int BatchedElmanNetwork::LANES;
+
+BatchedElmanNetwork::BatchedElmanNetwork(int networkCount, int inputCount, int outputCount)
+    : _networkCount(networkCount), _blockCount((networkCount + LANES - 1) / LANES), _inputCount(inputCount),
+    _outputCount(outputCount), _weightCount(ElmanNetwork::getWeightCount(inputCount, outputCount)),
+    _actFuncs(outputCount, ElmanNetwork::ACT_SIGMOID)
+{
+    // last block is padded with networks having all weights equal to 0
+    _weights.assign(_blockCount * _weightCount * LANES, 0);
+    _inputs.assign(_blockCount * _inputCount * LANES, 0);
+    _context.assign(_blockCount * _outputCount * LANES, 0);
+    _outputs.assign(_blockCount * _outputCount * LANES, 0);
+}
+
+bool BatchedElmanNetwork::setWeights(int network, const double* weights, int weightCount)
+{
+    if (weightCount != _weightCount || network < 0 || network >= _networkCount)
+        return false;
+    for (int i = 0; i < weightCount; i++)
+        _weights[index(network, i, _weightCount)] = weights[i];
+    return true;
+}
+
+void BatchedElmanNetwork::reset()
+{
+    std::fill(_context.begin(), _context.end(), 0);
+    std::fill(_outputs.begin(), _outputs.end(), 0);
+}
+
+void BatchedElmanNetwork::evaluate()
+{
+    for (int block = 0; block < _blockCount; block++)
+    {
+        const double* row = &_weights[block * _weightCount * LANES];
+        const double* inputs = &_inputs[block * _inputCount * LANES];
+        double* context = &_context[block * _outputCount * LANES];
+        double* outputs = &_outputs[block * _outputCount * LANES];
+
+        // weighted sums for all networks of the block - the same order of operations as in ElmanNetwork
+        for (int out = 0; out < _outputCount; out++)
+        {
+            Lanes sum = loadLanes(row); // bias unit output is always 1
+            row += LANES;
+            for (int in = 0; in < _inputCount; in++, row += LANES)
+                sum = mulAddLanes(sum, loadLanes(row), loadLanes(inputs + in * LANES));
+            for (int ctx = 0; ctx < _outputCount; ctx++, row += LANES)
+                sum = mulAddLanes(sum, loadLanes(row), loadLanes(context + ctx * LANES));
+            storeLanes(outputs + out * LANES, sum);
+        }
+
+        // there are no vector versions of exp and tanh, so activation is done lane by lane
+        for (int out = 0; out < _outputCount; out++)
+            for (int lane = 0; lane < LANES; lane++)
+                outputs[out * LANES + lane] = ElmanNetwork::activate(_actFuncs[out], outputs[out * LANES + lane]);
+
+        std::copy(outputs, outputs + _outputCount * LANES, context);
+    }
+}
@@ -0,0 +1,68 @@
+#ifndef BATCHED_ELMAN_NETWORK_H
+#define BATCHED_ELMAN_NETWORK_H
+
+#include <vector>
+
+#include "ElmanNetwork.h"
+
+// number of networks evaluated together by single vector instruction
+#if defined(__AVX__)
+#define ELMAN_BATCH_LANES   4
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ELMAN_BATCH_LANES   2
+#else
+#define ELMAN_BATCH_LANES   1
+#endif
+
+/*
+    Evaluates many Elman networks of the same topology at once (i.e. whole population).
+    Networks are grouped in blocks of LANES networks. Every weight, input, context and output value is stored
+    for all networks of a block next to each other, so a single pass through layer computes outputs of all
+    networks in a block with vector instructions:
+
+        _weights[((block * WEIGHT_COUNT) + weight) * LANES + lane]
+
+    Results are the same as from ElmanNetwork evaluated one by one.
+*/
+
+class BatchedElmanNetwork
+{
+    public:
+        static const int LANES = ELMAN_BATCH_LANES;
+
+        BatchedElmanNetwork(int networkCount, int inputCount, int outputCount);
+
+        int getNetworkCount() const { return _networkCount; }
+        int getInputCount() const { return _inputCount; }
+        int getOutputCount() const { return _outputCount; }
+        int getWeightCount() const { return _weightCount; }
+
+        // weights of single network in ElmanNetwork order
+        bool setWeights(int network, const double* weights, int weightCount);
+        void setActivationFunction(int outputNumber, int actFuncId) { _actFuncs[outputNumber] = actFuncId; }
+        void setInput(int network, int input, float value) { _inputs[index(network, input, _inputCount)] = value; }
+        double getOutput(int network, int output) const { return _outputs[index(network, output, _outputCount)]; }
+
+        void reset(); // clears context units of all networks
+        void evaluate(); // evaluates all networks with current inputs
+
+    private:
+        int index(int network, int valueNumber, int valuesPerNetwork) const
+        {
+            return ((network / LANES) * valuesPerNetwork + valueNumber) * LANES + network % LANES;
+        }
+
+        int                   _networkCount;
+        int                   _blockCount;
+        int                   _inputCount;
+        int                   _outputCount;
+        int                   _weightCount;
+        std::vector<int>      _actFuncs; // shared by all networks
+
+        std::vector<double>   _weights;
+        std::vector<double>   _inputs;
+        std::vector<double>   _context;
+        std::vector<double>   _outputs;
+};
+
+#endif
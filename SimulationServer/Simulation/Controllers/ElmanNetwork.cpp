@@ -0,0 +1,153 @@
+#include "ElmanNetwork.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+
+const int ElmanNetwork::ACT_IDENTITY;
+const int ElmanNetwork::ACT_SIGMOID;
+const int ElmanNetwork::ACT_RELU;
+const int ElmanNetwork::ACT_TANH;
+
+ElmanNetwork::ElmanNetwork(int inputCount, int outputCount) : _inputCount(inputCount), _outputCount(outputCount),
+    _weights(getWeightCount(inputCount, outputCount), 0), _actFuncs(outputCount, ACT_SIGMOID),
+    _context(outputCount, 0), _outputs(outputCount, 0)
+{
+}
+
+bool ElmanNetwork::setWeights(const double* weights, int weightCount)
+{
+    if (weightCount != getWeightCount())
+        return false;
+    std::copy(weights, weights + weightCount, _weights.begin());
+    return true;
+}
+
+void ElmanNetwork::reset()
+{
+    std::fill(_context.begin(), _context.end(), 0);
+    std::fill(_outputs.begin(), _outputs.end(), 0);
+}
+
+const double* ElmanNetwork::evaluate(const float* inputs)
+{
+    const double* row = &_weights[0];
+    for (int out = 0; out < _outputCount; out++)
+    {
+        double sum = row[0]; // bias unit output is always 1
+        const double* inputWeights = row + 1;
+        for (int in = 0; in < _inputCount; in++)
+            sum += inputWeights[in] * inputs[in];
+        const double* contextWeights = inputWeights + _inputCount;
+        for (int ctx = 0; ctx < _outputCount; ctx++)
+            sum += contextWeights[ctx] * _context[ctx];
+
+        _outputs[out] = activate(_actFuncs[out], sum);
+        row = contextWeights + _outputCount;
+    }
+    // context units are read by whole layer before they are overwritten, like in NNModule
+    std::copy(_outputs.begin(), _outputs.end(), _context.begin());
+
+    return &_outputs[0];
+}
+
+double ElmanNetwork::activate(int actFuncId, double x)
+{
+    switch (actFuncId)
+    {
+        case ACT_SIGMOID:
+            return 1.0 / (1.0 + exp(-x));
+        case ACT_RELU:
+            return x > 0 ? x : 0;
+        case ACT_TANH:
+            return tanh(x);
+        case ACT_IDENTITY:
+        default:
+            return x;
+    }
+}
+
+/*
+    File format (produced by NeuralNetwork.ToString):
+
+    LAYERS_COUNT
+    UNITS_COUNT                       <- for every layer
+    UNIT_ID ACT_FUNC_ID               <- for every unit in layer
+    BIAS_UNIT_ID MEMORY_UNIT_ID       (-1 if unit has none)
+    CONNECTIONS_COUNT
+    CONNECTED_UNIT_ID WEIGHT          <- for every connection
+*/
+
+ElmanNetwork* ElmanNetwork::load(std::istream& file)
+{
+    struct UnitData
+    {
+        int id;
+        int actFunc;
+        int bias;
+        int memory;
+        std::map<int, double> connections;
+    };
+
+    int layersCount;
+    if (!(file >> layersCount) || layersCount != 2)
+        return NULL;
+
+    std::vector<UnitData> layers[2];
+    for (int layer = 0; layer < layersCount; layer++)
+    {
+        int unitsCount;
+        if (!(file >> unitsCount) || unitsCount < 0)
+            return NULL;
+        layers[layer].resize(unitsCount);
+        for (int i = 0; i < unitsCount; i++)
+        {
+            UnitData& unit = layers[layer][i];
+            int connectionsCount;
+            if (!(file >> unit.id >> unit.actFunc >> unit.bias >> unit.memory >> connectionsCount))
+                return NULL;
+            for (int conn = 0; conn < connectionsCount; conn++)
+            {
+                int connectedId;
+                double weight;
+                if (!(file >> connectedId >> weight))
+                    return NULL;
+                unit.connections[connectedId] = weight;
+            }
+        }
+    }
+
+    // input layer units, that are not context of any output unit, are sensor inputs (in order of appearance)
+    std::vector<UnitData>& inputLayer = layers[0];
+    std::vector<UnitData>& outputLayer = layers[1];
+    std::vector<int> sensorIds;
+    for (std::vector<UnitData>::const_iterator in = inputLayer.begin(); in != inputLayer.end(); in++)
+    {
+        bool isContext = false;
+        for (std::vector<UnitData>::const_iterator out = outputLayer.begin(); out != outputLayer.end(); out++)
+            isContext = isContext || out->memory == in->id;
+        if (!isContext)
+            sensorIds.push_back(in->id);
+    }
+
+    int inputCount = (int) sensorIds.size();
+    int outputCount = (int) outputLayer.size();
+    ElmanNetwork* network = new ElmanNetwork(inputCount, outputCount);
+    double* row = &network->_weights[0];
+    for (int out = 0; out < outputCount; out++)
+    {
+        std::map<int, double>& conns = outputLayer[out].connections;
+        row[0] = conns.count(outputLayer[out].bias) ? conns[outputLayer[out].bias] : 0;
+        for (int in = 0; in < inputCount; in++)
+            row[1 + in] = conns.count(sensorIds[in]) ? conns[sensorIds[in]] : 0;
+        for (int ctx = 0; ctx < outputCount; ctx++)
+        {
+            int contextId = outputLayer[ctx].memory;
+            row[1 + inputCount + ctx] = contextId >= 0 && conns.count(contextId) ? conns[contextId] : 0;
+        }
+        network->setActivationFunction(out, outputLayer[out].actFunc);
+        row += 1 + inputCount + outputCount;
+    }
+
+    return network;
+}
@@ -0,0 +1,58 @@
+#ifndef ELMAN_NETWORK_H
+#define ELMAN_NETWORK_H
+
+#include <istream>
+#include <vector>
+
+/*
+    Native counterpart of network created by NNFactory.CreateElmanNN in GeneticEvolver:
+    - input layer: INPUT_COUNT identity units (sensors) followed by OUTPUT_COUNT identity context units
+    - output layer: OUTPUT_COUNT units, each with its own bias, connected with every input layer unit
+    Context units hold outputs from previous evaluation.
+
+    Weights are kept in the same order as returned by NeuralNetwork.GetAllWeights, so that genotypes can be
+    passed between both implementations: for every output unit - bias, sensor inputs, context units.
+*/
+
+class ElmanNetwork
+{
+    public:
+        // activation functions IDs, consistent with NNModule.ActFuncs
+        static const int ACT_IDENTITY = 0;
+        static const int ACT_SIGMOID = 1;
+        static const int ACT_RELU = 2;
+        static const int ACT_TANH = 3;
+
+        ElmanNetwork(int inputCount, int outputCount);
+
+        // reads network saved with NeuralNetwork.ToString (*.nn and *.rcs files)
+        // returns NULL, if file is malformed or does not describe Elman network
+        static ElmanNetwork* load(std::istream& file);
+
+        static int getWeightCount(int inputCount, int outputCount) { return outputCount * (1 + inputCount + outputCount); }
+
+        int getInputCount() const { return _inputCount; }
+        int getOutputCount() const { return _outputCount; }
+        int getWeightCount() const { return (int) _weights.size(); }
+        const double* getWeights() const { return &_weights[0]; }
+        bool setWeights(const double* weights, int weightCount);
+        void setActivationFunction(int outputNumber, int actFuncId) { _actFuncs[outputNumber] = actFuncId; }
+
+        // clears context units
+        void reset();
+
+        // returns array with OUTPUT_COUNT values, valid until next evaluation
+        const double* evaluate(const float* inputs);
+
+        static double activate(int actFuncId, double x);
+
+    private:
+        int                   _inputCount;
+        int                   _outputCount;
+        std::vector<double>   _weights; // one row of (1 + _inputCount + _outputCount) weights per output unit
+        std::vector<int>      _actFuncs;
+        std::vector<double>   _context;
+        std::vector<double>   _outputs;
+};
+
+#endif
@@ -0,0 +1,118 @@
+#include "NeuralController.h"
+
+NeuralController::NeuralController(KheperaRobot* robot, ElmanNetwork* network, double maxSpeed)
+    : _robot(robot), _network(network), _maxSpeed(maxSpeed), _inputs(network->getInputCount(), 0)
+{
+}
+
+void NeuralController::step()
+{
+    for (unsigned int i = 0; i < _inputs.size(); i++)
+    {
+        float state = 0; // missing sensors are seen as no detection
+        _robot->getSensorState(i, state);
+        _inputs[i] = state;
+    }
+
+    const double* outputs = _network->evaluate(_inputs.empty() ? NULL : &_inputs[0]);
+    _robot->setLeftMotorSpeed((outputs[0] - 0.5) * 2 * _maxSpeed);
+    _robot->setRightMotorSpeed((outputs[1] - 0.5) * 2 * _maxSpeed);
+}
+
+double NeuralController::avoidCollisionsFitness(const KheperaRobot& robot, double maxSpeed)
+{
+    double left = robot.getLeftMotorSpeed();
+    double right = robot.getRightMotorSpeed();
+
+    float maxSensorState = 0;
+    for (int i = 0; i < robot.getSensorCount(); i++)
+    {
+        float state;
+        if (robot.getSensorState(i, state) && state > maxSensorState)
+            maxSensorState = state;
+    }
+
+    double speedFactor = (fabs(left) + fabs(right)) / (2 * maxSpeed);
+    double movementFactor = 1 - sqrt(fabs(left - right) / (2 * maxSpeed));
+    double proximityFactor = 1 - sqrt(maxSensorState);
+
+    return speedFactor * movementFactor * proximityFactor;
+}
+
+static void fillFinalState(KheperaRobot& robot, int steps, EpisodeResult& result)
+{
+    result.x = robot.getX();
+    result.y = robot.getY();
+    result.directionAngle = robot.getDirectionAngle();
+    result.leftMotorSpeed = robot.getLeftMotorSpeed();
+    result.rightMotorSpeed = robot.getRightMotorSpeed();
+    result.commands = steps;
+    result.fitness = steps > 0 ? result.fitnessSum / steps : 0;
+    result.accumulators = robot.getAccumulators();
+}
+
+bool runEpisode(Simulation& simulation, KheperaRobot& robot, ElmanNetwork& network, int steps,
+    int stepsPerCommand, EpisodeResult& result)
+{
+    if (network.getOutputCount() != 2 || steps < 0 || stepsPerCommand < 0)
+        return false;
+
+    NeuralController controller(&robot, &network);
+    network.reset();
+    robot.getAccumulators().reset();
+
+    result.fitnessSum = 0;
+    for (int i = 0; i < steps; i++)
+    {
+        controller.step();
+        simulation.update((unsigned int) stepsPerCommand);
+        result.fitnessSum += controller.evaluateAvoidCollisions();
+    }
+
+    fillFinalState(robot, steps, result);
+
+    return true;
+}
+
+bool runEpisodes(Simulation** simulations, KheperaRobot** robots, BatchedElmanNetwork& networks, int steps,
+    int stepsPerCommand, EpisodeResult* results)
+{
+    if (networks.getOutputCount() != 2 || steps < 0 || stepsPerCommand < 0)
+        return false;
+
+    int count = networks.getNetworkCount();
+    networks.reset();
+    for (int i = 0; i < count; i++)
+    {
+        results[i].fitnessSum = 0;
+        robots[i]->getAccumulators().reset();
+    }
+
+    for (int step = 0; step < steps; step++)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            for (int input = 0; input < networks.getInputCount(); input++)
+            {
+                float state = 0;
+                robots[i]->getSensorState(input, state);
+                networks.setInput(i, input, state);
+            }
+        }
+
+        networks.evaluate();
+
+        for (int i = 0; i < count; i++)
+        {
+            robots[i]->setLeftMotorSpeed((networks.getOutput(i, 0) - 0.5) * 2 * DEFAULT_MAX_MOTOR_SPEED);
+            robots[i]->setRightMotorSpeed((networks.getOutput(i, 1) - 0.5) * 2 * DEFAULT_MAX_MOTOR_SPEED);
+            simulations[i]->update((unsigned int) stepsPerCommand);
+            results[i].fitnessSum += NeuralController::avoidCollisionsFitness(*robots[i], DEFAULT_MAX_MOTOR_SPEED);
+        }
+    }
+
+    for (int i = 0; i < count; i++)
+        fillFinalState(*robots[i], steps, results[i]);
+
+    return true;
+}
@@ -0,0 +1,63 @@
+#ifndef NEURAL_CONTROLLER_H
+#define NEURAL_CONTROLLER_H
+
+#include <vector>
+
+#include "ElmanNetwork.h"
+#include "BatchedElmanNetwork.h"
+#include "../Simulation.h"
+#include "../Entities/KheperaRobot.h"
+
+// result of a single episode - plain structure, so that it can be passed directly through DllInterface
+struct EpisodeResult
+{
+    // final state of controlled robot
+    double      x;
+    double      y;
+    float       directionAngle;
+    double      leftMotorSpeed;
+    double      rightMotorSpeed;
+
+    // fitness accumulated after every command, the same as FitnessFuncs.AvoidCollisions in GeneticEvolver
+    double      fitnessSum;
+    double      fitness; // fitnessSum averaged over commands
+    int32_t     commands;
+
+    // accumulators of controlled robot, collected during the episode
+    RobotAccumulators   accumulators;
+};
+
+// steers robot with Elman network: sensor states are network inputs and its two outputs, scaled
+// to [-maxSpeed, maxSpeed], are left and right motor speeds (like Controller.MoveRobot in GeneticEvolver)
+class NeuralController
+{
+    public:
+        NeuralController(KheperaRobot* robot, ElmanNetwork* network, double maxSpeed = DEFAULT_MAX_MOTOR_SPEED);
+
+        void step(); // reads sensors and sets new motors speeds
+        double evaluateAvoidCollisions() const { return avoidCollisionsFitness(*_robot, _maxSpeed); }
+
+        static double avoidCollisionsFitness(const KheperaRobot& robot, double maxSpeed);
+
+        KheperaRobot* getRobot() { return _robot; }
+        ElmanNetwork* getNetwork() { return _network; }
+
+    private:
+        KheperaRobot*        _robot;
+        ElmanNetwork*        _network;
+        double               _maxSpeed;
+        std::vector<float>   _inputs;
+};
+
+// runs whole episode without leaving native code: STEPS commands are sent to ROBOT, simulation is
+// updated STEPS_PER_COMMAND times after each of them; network context and robot accumulators are cleared
+// before episode starts
+bool runEpisode(Simulation& simulation, KheperaRobot& robot, ElmanNetwork& network, int steps,
+    int stepsPerCommand, EpisodeResult& result);
+
+// runs episodes of whole population at once: i-th network of NETWORKS steers ROBOTS[i] in SIMULATIONS[i]
+// outputs of all networks are computed by single batched pass before every command
+bool runEpisodes(Simulation** simulations, KheperaRobot** robots, BatchedElmanNetwork& networks, int steps,
+    int stepsPerCommand, EpisodeResult* results);
+
+#endif
@@ -4,33 +4,27 @@
 #include "../Math/MathLib.h"
 #include <iostream>
 
-CircularEnt::CircularEnt(uint16_t id, uint32_t weight, bool movable, double center_x, double center_y,
-	double radius) : SimEnt(id, SimEnt::CIRCLE, weight, movable), _radius(radius)
+CircularEnt::CircularEnt(uint32_t id, uint32_t weight, bool movable, Scalar center_x, Scalar center_y,
+	Scalar radius) : SimEnt(id, SimEnt::CIRCLE, weight, movable), _center(center_x, center_y), _radius(radius)
 {
-	_center = new Point(center_x, center_y);
 }
 
-CircularEnt::CircularEnt(std::ifstream& file, bool readBinary) : SimEnt(file, readBinary, SimEnt::CIRCLE)
+CircularEnt::CircularEnt(std::istream& file, uint16_t formatVersion)
+    : SimEnt(0, SimEnt::CIRCLE, 0, false), _radius(0)
 {
-	double x, y;
-    if (readBinary)
-    {
-        file.read(reinterpret_cast<char*>(&x), sizeof(x));
-        file.read(reinterpret_cast<char*>(&y), sizeof(y));
-        file.read(reinterpret_cast<char*>(&_radius), sizeof(_radius));
-    }
-    else
-        file >> x >> y >> _radius;
-    _center = new Point(x, y);
+    readFields(*this, file, formatVersion);
+}
+
+CircularEnt::CircularEnt(FieldSource& source) : SimEnt(0, SimEnt::CIRCLE, 0, false), _radius(0)
+{
+    visitFields(source);
 }
 
-CircularEnt::CircularEnt(const CircularEnt& other) : SimEnt(other)
+CircularEnt::CircularEnt(const CircularEnt& other) : SimEnt(other), _center(other._center), _radius(other._radius)
 {
-    _center = new Point(*other._center);
-    _radius = other._radius;
 }
 
-double CircularEnt::collisionLength(SimEnt& other, Point& proj)
+Scalar CircularEnt::collisionLength(SimEnt& other, Point& proj)
 {
     switch (other.getShapeID())
     {
@@ -48,16 +42,16 @@ double CircularEnt::collisionLength(SimEnt& other, Point& proj)
 
             LinearEnt &conv = *dynamic_cast<LinearEnt*>(&other);
             bool belongs;
-            Point orth_proj = orthogonalProjection(*_center, conv.getBeg(), conv.getEnd(), &belongs);
-            double ovr_dist = orth_proj.getDistance(*_center);
+            Point orth_proj = orthogonalProjection(_center, conv.getBeg(), conv.getEnd(), &belongs);
+            Scalar ovr_dist = orth_proj.getDistance(_center);
             /*if (_shapeID == SimEnt::KHEPERA_ROBOT && conv.getID() == 1004)
             {
             std::cout << "dist to orth_proj: " << ovr_dist << std::endl;
-            double A = conv.getEnd().getY() - conv.getBeg().getY(), B = conv.getBeg().getX() - conv.getEnd().getX(),
+            Scalar A = conv.getEnd().getY() - conv.getBeg().getY(), B = conv.getBeg().getX() - conv.getEnd().getX(),
             C = conv.getEnd().getX() * conv.getBeg().getY() - conv.getBeg().getX() * conv.getEnd().getY();
-            double top = abs(A * _center->getX() + B * _center->getY() + C);
-            double bott = sqrt(A * A + B * B);
-            double res = top / bott;
+            Scalar top = abs(A * _center.getX() + B * _center.getY() + C);
+            Scalar bott = sqrt(A * A + B * B);
+            Scalar res = top / bott;
             std::cout << "dist - 2. approach: " << res << std::endl;
             }*/
 
@@ -70,9 +64,9 @@ double CircularEnt::collisionLength(SimEnt& other, Point& proj)
             }
             else
             {
-                double dist_to_beg = conv.getBeg().getDistance(*_center),
-                    dist_to_end = conv.getEnd().getDistance(*_center);
-                double dist_to_vertex = min(dist_to_beg, dist_to_end);
+                Scalar dist_to_beg = conv.getBeg().getDistance(_center),
+                    dist_to_end = conv.getEnd().getDistance(_center);
+                Scalar dist_to_vertex = min(dist_to_beg, dist_to_end);
                 proj.setCoords(dist_to_beg == dist_to_vertex ? conv.getBeg() : conv.getEnd());
                 return _radius - dist_to_vertex;
             }
@@ -85,8 +79,8 @@ double CircularEnt::collisionLength(SimEnt& other, Point& proj)
         case SimEnt::KHEPERA_ROBOT:
         {
             CircularEnt &converted = *dynamic_cast<CircularEnt*>(&other);
-            double radiuses_sum = _radius + converted.getRadius();
-            double centres_diff = _center->getDistance(converted.getCenter());
+            Scalar radiuses_sum = _radius + converted.getRadius();
+            Scalar centres_diff = _center.getDistance(converted.getCenter());
 
             return radiuses_sum - centres_diff;
         }
@@ -96,9 +90,15 @@ double CircularEnt::collisionLength(SimEnt& other, Point& proj)
     }
 }
 
-void CircularEnt::translate(double x, double y)
+void CircularEnt::translate(Scalar x, Scalar y)
 {
-	_center->translate(x, y);
+	_center.translate(x, y);
+}
+
+BoundingBox CircularEnt::getBoundingBox()
+{
+    return BoundingBox(_center.getX() - _radius, _center.getY() - _radius,
+        _center.getX() + _radius, _center.getY() + _radius);
 }
 
 /*
@@ -141,20 +141,15 @@ void CircularEnt::translate(double x, double y)
 
 void CircularEnt::serialize(Buffer& buffer)
 {
-	SimEnt::serialize(buffer);
-
-	buffer.pack(getX());
-	buffer.pack(getY());
-	buffer.pack(_radius);
+	writeFields(*this, _shapeID, buffer);
 }
 
-void CircularEnt::serialize(std::ofstream& file)
+void CircularEnt::serialize(std::ostream& file)
 {
-	double x = getX();
-	double y = getY();
+	writeFields(*this, _shapeID, file);
+}
 
-	SimEnt::serialize(file);
-	file.write(reinterpret_cast<const char*>(&x), sizeof(x));
-	file.write(reinterpret_cast<const char*>(&y), sizeof(y));
-	file.write(reinterpret_cast<const char*>(&_radius), sizeof(_radius));
+void CircularEnt::serialize(WorldImageBuilder& image)
+{
+    image.addEntity(*this, _shapeID);
 }
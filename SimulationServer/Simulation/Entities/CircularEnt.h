@@ -8,25 +8,35 @@ class CircularEnt : public SimEnt
 {
 	public:
 		// x, y -> center coords
-		CircularEnt(uint16_t id, uint32_t weight, bool movable, double center_x, double center_y, double radius);
-		CircularEnt(std::ifstream& file, bool readBinary);
+		CircularEnt(uint32_t id, uint32_t weight, bool movable, Scalar center_x, Scalar center_y, Scalar radius);
+		CircularEnt(std::istream& file, uint16_t formatVersion = WORLD_FORMAT_VERSION);
         CircularEnt(const CircularEnt& other);
-		virtual ~CircularEnt() { delete _center; }
+        explicit CircularEnt(FieldSource& source);
 
-		double collisionLength(SimEnt& other, Point& proj);
-		double getX() { return _center->getX(); }
-		double getY() { return _center->getY(); }
-		double getRadius() { return _radius; }
-		Point& getCenter() { return *_center; }
+		Scalar collisionLength(SimEnt& other, Point& proj);
+		Scalar getX() { return _center.getX(); }
+		Scalar getY() { return _center.getY(); }
+		Scalar getRadius() { return _radius; }
+		Point& getCenter() { return _center; }
 
-		virtual void translate(double x, double y);
+		virtual void translate(Scalar x, Scalar y);
+        virtual BoundingBox getBoundingBox();
 
 		virtual void serialize(Buffer& buffer);
-		virtual void serialize(std::ofstream& file);
+		virtual void serialize(std::ostream& file);
+        virtual void serialize(WorldImageBuilder& image);
+
+        template <typename Visitor>
+        void visitFields(Visitor& visitor)
+        {
+            SimEnt::visitFields(visitor);
+            visitor.point(_center);
+            visitor.real64(_radius);
+        }
 
 	protected:
-		Point* _center;
-		double _radius;
+		Point _center;
+		Scalar _radius;
 };
 
 #endif
@@ -2,43 +2,58 @@
 #include "../Sensors/Sensor.h"
 #include "../Sensors/ProximitySensor.h"
 
-KheperaRobot::KheperaRobot(uint16_t id, uint32_t weight, double x,
-	double y, double robotRadius, uint16_t wheelRadius, uint16_t wheelDistance,
-	float directionAngle) : CircularEnt(id, weight, true, x, y, robotRadius),
-	_wheelRadius(wheelRadius), _wheelDistance(wheelDistance), _directionAngle(directionAngle)
+KheperaRobot::KheperaRobot(uint32_t id, uint32_t weight, Scalar x,
+	Scalar y, Scalar robotRadius, uint16_t wheelRadius, uint16_t wheelDistance,
+	Scalar directionAngle, Arena* arena) : CircularEnt(id, weight, true, x, y, robotRadius),
+	_wheelRadius(wheelRadius), _wheelDistance(wheelDistance), _directionAngle(directionAngle),
+    _arena(arena), _sensors(SensorList::allocator_type(arena)), _stepStart(_center), _contactCount(0)
 {
 	_shapeID = SimEnt::KHEPERA_ROBOT;
     setLeftMotorSpeed(0);
     setRightMotorSpeed(0);
 }
 
-KheperaRobot::KheperaRobot(std::ifstream& file, bool readBinary) : CircularEnt(file, readBinary)
+KheperaRobot::KheperaRobot(std::istream& file, uint16_t formatVersion, Arena* arena)
+    : CircularEnt(0, 0, true, 0, 0, 0), _wheelRadius(0), _wheelDistance(0), _directionAngle(0),
+    _arena(arena), _sensors(SensorList::allocator_type(arena)), _contactCount(0)
 {
 	_shapeID = SimEnt::KHEPERA_ROBOT;
-    if (readBinary)
-    {
-        file.read(reinterpret_cast<char*>(&_wheelRadius), sizeof(_wheelRadius));
-        file.read(reinterpret_cast<char*>(&_wheelDistance), sizeof(_wheelDistance));
-        file.read(reinterpret_cast<char*>(&_directionAngle), sizeof(_directionAngle));
-    }
-    else
-        file >> _wheelRadius >> _wheelDistance >> _directionAngle;
+    setLeftMotorSpeed(0);
+    setRightMotorSpeed(0);
+    readFields(*this, file, formatVersion);
+    _stepStart = _center;
 }
 
-KheperaRobot::KheperaRobot(const KheperaRobot& other) : CircularEnt(other)
+KheperaRobot::KheperaRobot(FieldSource& source, Arena* arena)
+    : CircularEnt(0, 0, true, 0, 0, 0), _wheelRadius(0), _wheelDistance(0), _directionAngle(0),
+    _arena(arena), _sensors(SensorList::allocator_type(arena)), _contactCount(0)
+{
+	_shapeID = SimEnt::KHEPERA_ROBOT;
+    setLeftMotorSpeed(0);
+    setRightMotorSpeed(0);
+    visitFields(source);
+    _stepStart = _center;
+}
+
+KheperaRobot::KheperaRobot(const KheperaRobot& other, Arena* arena) : CircularEnt(other),
+    _arena(arena), _sensors(SensorList::allocator_type(arena))
 {
     _wheelRadius = other._wheelRadius;
     _wheelDistance = other._wheelDistance;
     _directionAngle = other._directionAngle;
     _leftMotor = other._leftMotor;
     _rightMotor = other._rightMotor;
-    for (std::vector<Sensor*>::const_iterator it = other._sensors.begin(); it != other._sensors.end(); it++)
+    _accumulators = other._accumulators;
+    _stepStart = other._stepStart;
+    _contactCount = other._contactCount;
+    _sensors.reserve(other._sensors.size());
+    for (SensorList::const_iterator it = other._sensors.begin(); it != other._sensors.end(); it++)
     {
         Sensor* sensor;
         switch ((*it)->getType())
         {
             case Sensor::PROXIMITY:
-                sensor = new ProximitySensor(*dynamic_cast<ProximitySensor*>(*it));
+                sensor = arenaCreate<ProximitySensor>(_arena, *dynamic_cast<ProximitySensor*>(*it));
                 sensor->placeOnRobot(this);
                 break;
             default:
@@ -52,8 +67,14 @@ KheperaRobot::KheperaRobot(const KheperaRobot& other) : CircularEnt(other)
 
 KheperaRobot::~KheperaRobot()
 {
-    for (std::vector<Sensor*>::iterator sensIt = _sensors.begin(); sensIt != _sensors.end(); sensIt++)
-        delete *sensIt;
+    // memory of sensors created in arena is reused by next sensors
+    for (SensorList::iterator sensIt = _sensors.begin(); sensIt != _sensors.end(); sensIt++)
+    {
+        if (_arena == NULL)
+            delete *sensIt;
+        else if ((*sensIt)->getType() == Sensor::PROXIMITY)
+            _arena->destroy(static_cast<ProximitySensor*>(*sensIt));
+    }
 }
 
 bool KheperaRobot::getSensorState(unsigned int sensorNumber, float& state) const
@@ -64,31 +85,49 @@ bool KheperaRobot::getSensorState(unsigned int sensorNumber, float& state) const
     return isIndexValid;
 }
 
-double KheperaRobot::updatePosition(double deltaTime)
+bool KheperaRobot::setSensorState(unsigned int sensorNumber, float state)
+{
+    bool isIndexValid = sensorNumber < _sensors.size();
+    if(isIndexValid)
+        _sensors[sensorNumber]->_state = state;
+    return isIndexValid;
+}
+
+Scalar KheperaRobot::updatePosition(Scalar deltaTime)
 {
 	// thanks to http://www.youtube.com/watch?v=aE7RQNhwnPQ 3:30
 	// here is more precise equation: http://robotics.stackexchange.com/a/1679
 
+    _stepStart = _center;
+
 	// angles of which wheels turned during deltaTime
-	double leftWheelTurnAngle = _leftMotor.getSpeed() * deltaTime;
-	double rightWheelTurnAngle = _rightMotor.getSpeed() * deltaTime;
+	Scalar leftWheelTurnAngle = _leftMotor.getSpeed() * deltaTime;
+	Scalar rightWheelTurnAngle = _rightMotor.getSpeed() * deltaTime;
 
-	double deltaFI = ((_wheelRadius / (float) _wheelDistance) * (rightWheelTurnAngle - leftWheelTurnAngle));
-	_directionAngle += (float) deltaFI;
+	Scalar deltaFI = ((_wheelRadius / (Scalar) _wheelDistance) * (rightWheelTurnAngle - leftWheelTurnAngle));
+	_directionAngle += deltaFI;
 
 	// _directionAngle is in radians 
-	double deltaX = (_wheelRadius / 2.0) * (leftWheelTurnAngle + rightWheelTurnAngle) * cos(_directionAngle);
-	double deltaY = (_wheelRadius / 2.0) * (leftWheelTurnAngle + rightWheelTurnAngle) * sin(_directionAngle);
+	Scalar deltaX = (_wheelRadius / 2.0) * (leftWheelTurnAngle + rightWheelTurnAngle) * cos(_directionAngle);
+	Scalar deltaY = (_wheelRadius / 2.0) * (leftWheelTurnAngle + rightWheelTurnAngle) * sin(_directionAngle);
 
     translate(deltaX, deltaY);
     return sqrt(deltaX * deltaX + deltaY * deltaY);
 }
 
-void KheperaRobot::updateSensorsState(const SimEntMap::const_iterator& firstEntity, 
-    const SimEntMap::const_iterator& lastEntity)
+void KheperaRobot::updateSensorsState(const std::vector<SimEnt*>& entities)
+{
+    for (SensorList::const_iterator it = _sensors.begin(); it != _sensors.end(); it++)
+        (*it)->updateState(entities);
+}
+
+Scalar KheperaRobot::getSensorsReach() const
 {
-    for (std::vector<Sensor*>::const_iterator it = _sensors.begin(); it != _sensors.end(); it++)
-        (*it)->updateState(firstEntity, lastEntity);
+    // sensors are placed on the edge of robot
+    Scalar range = 0;
+    for (SensorList::const_iterator it = _sensors.begin(); it != _sensors.end(); it++)
+        range = max(range, (*it)->getRange());
+    return _radius + range;
 }
 
 void KheperaRobot::addSensor(Sensor* sensor)
@@ -96,6 +135,22 @@ void KheperaRobot::addSensor(Sensor* sensor)
     _sensors.push_back(sensor);
 }
 
+void KheperaRobot::accumulate(const AccumulatorsConfig& config)
+{
+    if (config.enabled & ACC_DISTANCE)
+        _accumulators.distanceTravelled += _center.getDistance(_stepStart);
+
+    if (config.enabled & ACC_SPEED_SYMMETRY)
+        _accumulators.speedSymmetrySum += 1 - sqrt(fabs(getLeftMotorSpeed() - getRightMotorSpeed())
+            / (2 * config.maxMotorSpeed));
+
+    if (config.enabled & ACC_MAX_SENSOR)
+        for (SensorList::const_iterator it = _sensors.begin(); it != _sensors.end(); it++)
+            _accumulators.maxSensorActivation = max(_accumulators.maxSensorActivation, (*it)->getState());
+
+    _accumulators.steps++;
+}
+
 /*
 		Serialization format (integers in network-byte-order, doubles and floats in host-byte-order)
 
@@ -144,34 +199,33 @@ DATA_LENGTH = 320 bits
 
 void KheperaRobot::serialize(Buffer& buffer)
 {
-	CircularEnt::serialize(buffer);
-
-	buffer.pack(htons(_wheelRadius));
-	buffer.pack(htons(_wheelDistance));
-	buffer.pack(_directionAngle);
-    buffer.pack(htons(static_cast<uint16_t>(_sensors.size())));
-    for (std::vector<Sensor*>::const_iterator it = _sensors.begin(); it != _sensors.end(); it++)
+    writeFields(*this, _shapeID, buffer);
+    buffer.packBigEndian(static_cast<uint16_t>(_sensors.size()));
+    for (SensorList::const_iterator it = _sensors.begin(); it != _sensors.end(); it++)
         (*it)->serialize(buffer);
 }
 
-void KheperaRobot::serialize(std::ofstream& file)
+void KheperaRobot::serialize(std::ostream& file)
 {
-	CircularEnt::serialize(file);
-
-	file.write(reinterpret_cast<const char*>(&_wheelRadius), sizeof(_wheelRadius));
-	file.write(reinterpret_cast<const char*>(&_wheelDistance), sizeof(_wheelDistance));
-	file.write(reinterpret_cast<const char*>(&_directionAngle), sizeof(_directionAngle));
+    writeFields(*this, _shapeID, file);
     uint16_t numberOfSensors = (uint16_t) _sensors.size();
     file.write(reinterpret_cast<const char*>(&numberOfSensors), sizeof(numberOfSensors));
-    for (std::vector<Sensor*>::const_iterator it = _sensors.begin(); it != _sensors.end(); it++)
+    for (SensorList::const_iterator it = _sensors.begin(); it != _sensors.end(); it++)
         (*it)->serialize(file);
 
 	/* TODO: Serialize information about motors(probably about their type) */
 }
 
+void KheperaRobot::serialize(WorldImageBuilder& image)
+{
+    image.addEntity(*this, _shapeID);
+    for (SensorList::const_iterator it = _sensors.begin(); it != _sensors.end(); it++)
+        (*it)->serialize(image);
+}
+
 void KheperaRobot::serializeForController(Buffer& buffer)
 {
-    buffer.pack(htons(static_cast<uint16_t>(_sensors.size())));
-    for (std::vector<Sensor*>::const_iterator it = _sensors.begin(); it != _sensors.end(); it++)
+    buffer.packBigEndian(static_cast<uint16_t>(_sensors.size()));
+    for (SensorList::const_iterator it = _sensors.begin(); it != _sensors.end(); it++)
         buffer.pack((*it)->_state);
 }
\ No newline at end of file
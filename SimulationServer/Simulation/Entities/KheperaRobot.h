@@ -2,6 +2,7 @@
 #define ROBOT_H
 
 #include "CircularEnt.h"
+#include "../Metrics/RobotAccumulators.h"
 #include <vector>
 
 class Sensor;
@@ -9,53 +10,98 @@ class Sensor;
 class Motor
 {
     public:
-        double getSpeed() const { return _speed; } // returns speed in [ rad / sec ]
-        void setSpeed(double speed) { _speed = speed; }
+        Scalar getSpeed() const { return _speed; } // returns speed in [ rad / sec ]
+        void setSpeed(Scalar speed) { _speed = speed; }
+
+        template <typename Visitor>
+        void visitFields(Visitor& visitor) { visitor.real64(_speed); }
 
     protected:
-        double  _speed; // [ rad / sec ]
+        Scalar  _speed; // [ rad / sec ]
 };
 
+typedef std::vector<Sensor*, ArenaAllocator<Sensor*> > SensorList;
+
 class KheperaRobot : public CircularEnt
 {
 	public:
-		KheperaRobot(uint16_t id, uint32_t weight, double x, double y, double robotRadius, uint16_t wheelRadius,
-			uint16_t wheelDistance, float directionAngle = 0);
-        KheperaRobot(std::ifstream& file, bool readBinary);
-        KheperaRobot(const KheperaRobot& other);
+        // if ARENA is given, robot keeps its sensors list in it and is not an owner of its sensors
+		KheperaRobot(uint32_t id, uint32_t weight, Scalar x, Scalar y, Scalar robotRadius, uint16_t wheelRadius,
+			uint16_t wheelDistance, Scalar directionAngle = 0, Arena* arena = NULL);
+        KheperaRobot(std::istream& file, uint16_t formatVersion = WORLD_FORMAT_VERSION,
+            Arena* arena = NULL);
+        KheperaRobot(const KheperaRobot& other, Arena* arena = NULL);
+        explicit KheperaRobot(FieldSource& source, Arena* arena = NULL);
         ~KheperaRobot();
 
-		void setRightMotorSpeed(double speed) { _rightMotor.setSpeed(speed); }
-		void setLeftMotorSpeed(double speed) { _leftMotor.setSpeed(speed); }
-        void setDirectionAngle(float angle) { _directionAngle = angle; }
+		void setRightMotorSpeed(Scalar speed) { _rightMotor.setSpeed(speed); }
+		void setLeftMotorSpeed(Scalar speed) { _leftMotor.setSpeed(speed); }
+        void setDirectionAngle(Scalar angle) { _directionAngle = angle; }
 
-		double getRightMotorSpeed() const { return _rightMotor.getSpeed(); }
-		double getLeftMotorSpeed() const { return _leftMotor.getSpeed(); }
-        float getDirectionAngle() const { return _directionAngle; }
+		Scalar getRightMotorSpeed() const { return _rightMotor.getSpeed(); }
+		Scalar getLeftMotorSpeed() const { return _leftMotor.getSpeed(); }
+        Scalar getDirectionAngle() const { return _directionAngle; }
         int getSensorCount() const { return _sensors.size(); }
+        Sensor* getSensor(int sensorNumber) const { return _sensors[sensorNumber]; }
         bool getSensorState(unsigned int sensorNumber, float& state) const;
+        // for replays - state is normally computed by the sensor itself
+        bool setSensorState(unsigned int sensorNumber, float state);
+        RobotAccumulators& getAccumulators() { return _accumulators; }
+        // contacts since robot was created, independent of accumulators configuration
+        uint32_t getContactCount() const { return _contactCount; }
+        void registerContact() { _contactCount++; }
 
 		// deltaTime in [ sec ]
-		double updatePosition(double deltaTime);
-        void updateSensorsState(const SimEntMap::const_iterator& firstEntity, 
-            const SimEntMap::const_iterator& lastEntity);
+		Scalar updatePosition(Scalar deltaTime);
+        // ENTITIES have to contain at least all entities within getSensorsReach from robot center
+        void updateSensorsState(const std::vector<SimEnt*>& entities);
+        Scalar getSensorsReach() const;
         void addSensor(Sensor* sensor);
+        // updates accumulators, that depend only on robot itself, at the end of simulation step
+        void accumulate(const AccumulatorsConfig& config);
 
 		virtual void serialize(Buffer& buffer);
-		virtual void serialize(std::ofstream& file);
+		virtual void serialize(std::ostream& file);
+        virtual void serialize(WorldImageBuilder& image);
 
         void serializeForController(Buffer& buffer);
 
+        // sensors follow the robot as separate records, preceded by their count
+        template <typename Visitor>
+        void visitFields(Visitor& visitor)
+        {
+            CircularEnt::visitFields(visitor);
+            visitor.integer(_wheelRadius);
+            visitor.integer(_wheelDistance);
+            visitor.angle(_directionAngle);
+        }
+        // without sensors, they have their own state
+        template <typename Visitor>
+        void visitState(Visitor& visitor)
+        {
+            SimEnt::visitState(visitor);
+            visitor.real64(_directionAngle);
+            _leftMotor.visitFields(visitor);
+            _rightMotor.visitFields(visitor);
+            _accumulators.visitFields(visitor);
+            visitor.integer(_contactCount);
+        }
+
 	protected:
 		uint16_t    _wheelRadius;
 		uint16_t    _wheelDistance;
 
-		float       _directionAngle; // angle beetween x axis and robot heading direction, in radians
+		Scalar      _directionAngle; // angle beetween x axis and robot heading direction, in radians
 
 		Motor       _leftMotor;
 		Motor       _rightMotor;
 
-        std::vector<Sensor*> _sensors;
+        Arena*      _arena;
+        SensorList  _sensors;
+
+        RobotAccumulators   _accumulators;
+        Point               _stepStart; // center at the beginning of current step
+        uint32_t            _contactCount;
 };
 
 #endif
\ No newline at end of file
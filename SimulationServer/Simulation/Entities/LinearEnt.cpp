@@ -1,48 +1,37 @@
 #include "LinearEnt.h"
 
-LinearEnt::LinearEnt(uint16_t id, double begX, double begY,
-	double endX, double endY) : SimEnt(id, SimEnt::LINE, 0, false)
+LinearEnt::LinearEnt(uint32_t id, Scalar begX, Scalar begY,
+	Scalar endX, Scalar endY) : SimEnt(id, SimEnt::LINE, 0, false)
 {
     initializeEntity(begX, begY, endX, endY);
 }
 
-LinearEnt::LinearEnt(std::ifstream& file, bool readBinary) : SimEnt(file, readBinary, SimEnt::LINE)
+LinearEnt::LinearEnt(std::istream& file, uint16_t formatVersion)
+    : SimEnt(0, SimEnt::LINE, 0, false), _length(0)
 {
-    double begX, begY, endX, endY;
-    if (readBinary)
-    {
-        file.read(reinterpret_cast<char*>(&begX), sizeof(begX));
-        file.read(reinterpret_cast<char*>(&begY), sizeof(begY));
-        file.read(reinterpret_cast<char*>(&endX), sizeof(endX));
-        file.read(reinterpret_cast<char*>(&endY), sizeof(endY));
-    }
-    else
-        file >> begX >> begY >> endX >> endY;
-
-    initializeEntity(begX, begY, endX, endY);
+    readFields(*this, file, formatVersion);
+    initializeEntity(_beg.getX(), _beg.getY(), _end.getX(), _end.getY());
 }
 
-LinearEnt::LinearEnt(const LinearEnt& other) : SimEnt(other)
+LinearEnt::LinearEnt(FieldSource& source) : SimEnt(0, SimEnt::LINE, 0, false), _length(0)
 {
-    _beg = new Point(*other._beg);
-    _end = new Point(*other._end);
-    _length = other._length;
+    visitFields(source);
+    initializeEntity(_beg.getX(), _beg.getY(), _end.getX(), _end.getY());
 }
 
-void LinearEnt::initializeEntity(double begX, double begY, double endX, double endY)
+LinearEnt::LinearEnt(const LinearEnt& other) : SimEnt(other), _beg(other._beg), _end(other._end),
+    _length(other._length)
 {
-    _beg = new Point(begX, begY);
-    _end = new Point(endX, endY);
-    _length = _beg->getDistance(*_end);
 }
 
-LinearEnt::~LinearEnt()
+void LinearEnt::initializeEntity(Scalar begX, Scalar begY, Scalar endX, Scalar endY)
 {
-	delete _beg;
-	delete _end;
+    _beg.setCoords(begX, begY);
+    _end.setCoords(endX, endY);
+    _length = _beg.getDistance(_end);
 }
 
-double LinearEnt::collisionLength(SimEnt& other, Point& proj)
+Scalar LinearEnt::collisionLength(SimEnt& other, Point& proj)
 {
     switch (other.getShapeID())
     {
@@ -56,31 +45,29 @@ double LinearEnt::collisionLength(SimEnt& other, Point& proj)
     }
 }
 
-void LinearEnt::translate(double x, double y)
+void LinearEnt::translate(Scalar x, Scalar y)
 {
-	_beg->translate(x, y);
-	_end->translate(x, y);
+	_beg.translate(x, y);
+	_end.translate(x, y);
+}
+
+BoundingBox LinearEnt::getBoundingBox()
+{
+    return BoundingBox(min(_beg.getX(), _end.getX()), min(_beg.getY(), _end.getY()),
+        max(_beg.getX(), _end.getX()), max(_beg.getY(), _end.getY()));
 }
 
 void LinearEnt::serialize(Buffer& buffer)
 {
-    SimEnt::serialize(buffer);
-	buffer.pack(_beg->getX());
-	buffer.pack(_beg->getY());
-	buffer.pack(_end->getX());
-	buffer.pack(_end->getY());
+    writeFields(*this, _shapeID, buffer);
 }
 
-void LinearEnt::serialize(std::ofstream& file)
+void LinearEnt::serialize(std::ostream& file)
 {
-    SimEnt::serialize(file);
+    writeFields(*this, _shapeID, file);
+}
 
-    double begX = _beg->getX();
-    double begY = _beg->getY();
-    double endX = _end->getX();
-    double endY = _end->getY();
-    file.write(reinterpret_cast<const char*>(&begX), sizeof(begX));
-    file.write(reinterpret_cast<const char*>(&begY), sizeof(begY));
-    file.write(reinterpret_cast<const char*>(&endX), sizeof(endX));
-    file.write(reinterpret_cast<const char*>(&endY), sizeof(endY));
+void LinearEnt::serialize(WorldImageBuilder& image)
+{
+    image.addEntity(*this, _shapeID);
 }
\ No newline at end of file
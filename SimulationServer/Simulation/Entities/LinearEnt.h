@@ -7,27 +7,37 @@
 class LinearEnt : public SimEnt
 {
     public:
-	    LinearEnt(uint16_t id, double begX, double begY, double endX, double endY);
-        LinearEnt(std::ifstream& file, bool readBinary);
+	    LinearEnt(uint32_t id, Scalar begX, Scalar begY, Scalar endX, Scalar endY);
+        LinearEnt(std::istream& file, uint16_t formatVersion = WORLD_FORMAT_VERSION);
         LinearEnt(const LinearEnt& other);
-	    ~LinearEnt();
+        explicit LinearEnt(FieldSource& source);
 
-	    Point& getBeg() { return *_beg; }
-	    Point& getEnd() { return *_end; }
-	    double getLength() { return _length; }
+	    Point& getBeg() { return _beg; }
+	    Point& getEnd() { return _end; }
+	    Scalar getLength() { return _length; }
 
-	    double collisionLength(SimEnt& other, Point& proj);
-	    void translate(double x, double y);
+	    Scalar collisionLength(SimEnt& other, Point& proj);
+	    void translate(Scalar x, Scalar y);
+        BoundingBox getBoundingBox();
 
 	    void serialize(Buffer& buffer);
-        void serialize(std::ofstream& file);
+        void serialize(std::ostream& file);
+        void serialize(WorldImageBuilder& image);
+
+        template <typename Visitor>
+        void visitFields(Visitor& visitor)
+        {
+            SimEnt::visitFields(visitor);
+            visitor.point(_beg);
+            visitor.point(_end);
+        }
 
     private:
-        void initializeEntity(double begX, double begY, double endX, double endY);
+        void initializeEntity(Scalar begX, Scalar begY, Scalar endX, Scalar endY);
 
-	    Point* _beg;
-	    Point* _end;
-	    double _length;
+	    Point _beg;
+	    Point _end;
+	    Scalar _length;
     
 };
 
@@ -1,47 +1,41 @@
 #include "RectangularEnt.h"
 
-RectangularEnt::RectangularEnt(uint16_t id, uint32_t weight, bool movable, double x,
-	double y, double width, double height, float angle) : SimEnt(id, SimEnt::RECTANGLE, weight, movable),
+RectangularEnt::RectangularEnt(uint32_t id, uint32_t weight, bool movable, Scalar x,
+	Scalar y, Scalar width, Scalar height, Scalar angle) : SimEnt(id, SimEnt::RECTANGLE, weight, movable),
 	_width(width), _height(height), _angle(angle)
 {
     initializeEntity(x, y);
 }
 
-RectangularEnt::RectangularEnt(std::ifstream& file, bool readBinary) : SimEnt(file, readBinary, SimEnt::RECTANGLE)
+RectangularEnt::RectangularEnt(std::istream& file, uint16_t formatVersion)
+    : SimEnt(0, SimEnt::RECTANGLE, 0, false), _width(0), _height(0), _angle(0)
 {
-    double x, y;
-    if (readBinary)
-    {
-        file.read(reinterpret_cast<char*>(&x), sizeof(x));
-        file.read(reinterpret_cast<char*>(&y), sizeof(y));
-        file.read(reinterpret_cast<char*>(&_width), sizeof(_width));
-        file.read(reinterpret_cast<char*>(&_height), sizeof(_height));
-        file.read(reinterpret_cast<char*>(&_angle), sizeof(_angle));
-    }
-    else
-        file >> x >> y >> _width >> _height >> _angle;
-    initializeEntity(x, y);
+    readFields(*this, file, formatVersion);
+    initializeEntity(_bottLeft.getX(), _bottLeft.getY());
+}
+
+RectangularEnt::RectangularEnt(FieldSource& source)
+    : SimEnt(0, SimEnt::RECTANGLE, 0, false), _width(0), _height(0), _angle(0)
+{
+    visitFields(source);
+    initializeEntity(_bottLeft.getX(), _bottLeft.getY());
 }
 
-RectangularEnt::RectangularEnt(const RectangularEnt& other) : SimEnt(other)
+RectangularEnt::RectangularEnt(const RectangularEnt& other) : SimEnt(other), _bottLeft(other._bottLeft),
+    _center(other._center), _width(other._width), _height(other._height), _angle(other._angle)
 {
-    _bottLeft = new Point(*other._bottLeft);
-    _center = new Point(*other._center);
-    _width = other._width;
-    _height = other._height;
-    _angle = other._angle;
 }
 
-void RectangularEnt::initializeEntity(double bottLeftX, double bottLeftY)
+void RectangularEnt::initializeEntity(Scalar bottLeftX, Scalar bottLeftY)
 {
-    _bottLeft = new Point(bottLeftX, bottLeftY);
-    double ang_cos = cos(_angle);
-    double ang_sin = sin(_angle);
-    _center = new Point(_bottLeft->getX() + _width / 2.0 * ang_cos + _height / 2.0 * ang_sin,
-        _bottLeft->getY() - _width / 2.0 * ang_sin + _height / 2.0 * ang_cos);
+    _bottLeft.setCoords(bottLeftX, bottLeftY);
+    Scalar ang_cos = cos(_angle);
+    Scalar ang_sin = sin(_angle);
+    _center.setCoords(_bottLeft.getX() + _width / 2.0 * ang_cos + _height / 2.0 * ang_sin,
+        _bottLeft.getY() - _width / 2.0 * ang_sin + _height / 2.0 * ang_cos);
 }
 
-double RectangularEnt::collisionLength(SimEnt& other, Point& proj)
+Scalar RectangularEnt::collisionLength(SimEnt& other, Point& proj)
 {
     switch (other.getShapeID())
     {
@@ -49,7 +43,7 @@ double RectangularEnt::collisionLength(SimEnt& other, Point& proj)
         case SimEnt::KHEPERA_ROBOT:
         {
             CircularEnt &converted = *dynamic_cast<CircularEnt*>(&other);
-            Point clone(*_bottLeft);
+            Point clone(_bottLeft);
             return check_and_divide(converted, clone, _width, _height, 1);
         }
 
@@ -59,33 +53,42 @@ double RectangularEnt::collisionLength(SimEnt& other, Point& proj)
     }
 }
 
-void RectangularEnt::translate(double x, double y)
+void RectangularEnt::translate(Scalar x, Scalar y)
 {
-	_bottLeft->translate(x, y);
+	_bottLeft.translate(x, y);
+	_center.translate(x, y);
 }
 
-double RectangularEnt::check_and_divide(CircularEnt& other, Point& bottLeft, double width, double height, int level)
+BoundingBox RectangularEnt::getBoundingBox()
+{
+    // whatever the rotation, the rectangle fits into the circle around its corner with diagonal as radius
+    Scalar diagonal = sqrt(_width * _width + _height * _height);
+    return BoundingBox(_bottLeft.getX() - diagonal, _bottLeft.getY() - diagonal,
+        _bottLeft.getX() + diagonal, _bottLeft.getY() + diagonal);
+}
+
+Scalar RectangularEnt::check_and_divide(CircularEnt& other, Point& bottLeft, Scalar width, Scalar height, int level)
 {
 	if (level > DIVIDING_LEVEL)
 		return INF_COLLISION;
 
-	double ang_cos = cos(_angle);
-	double ang_sin = sin(_angle);
+	Scalar ang_cos = cos(_angle);
+	Scalar ang_sin = sin(_angle);
 	width /= 2.0;
 	height /= 2.0;
 
 	// center point is calculated as a result of multiplication of 3 transformation matrices (-translate bottLeft, rotate _angle, translate bottLeft)
 	Point center(bottLeft.getX() + width * ang_cos - height * ang_sin, bottLeft.getY() + width * ang_sin + height * ang_cos);
-	double radius = center.getDistance(bottLeft);
+	Scalar radius = center.getDistance(bottLeft);
 
-	double radiuses_sum = radius + other.getRadius();
-	double centres_diff = center.getDistance(other.getCenter());
+	Scalar radiuses_sum = radius + other.getRadius();
+	Scalar centres_diff = center.getDistance(other.getCenter());
 
     if (centres_diff > radiuses_sum)
         return radiuses_sum - centres_diff;
 	else
 	{
-		double max_coll = NO_COLLISION;
+		Scalar max_coll = NO_COLLISION;
 		level++;
 
 		Point copy = Point(bottLeft);
@@ -179,31 +182,28 @@ double RectangularEnt::check_and_divide(CircularEnt& other, Point& bottLeft, dou
 
 */
 
+void RectangularEnt::getCorners(Point* corners)
+{
+    Scalar ang_cos = cos(_angle);
+    Scalar ang_sin = sin(_angle);
+    corners[0].setCoords(_bottLeft.getX(), _bottLeft.getY());
+    corners[1].setCoords(_bottLeft.getX() - _height * ang_sin, _bottLeft.getY() + _height * ang_cos);
+    corners[2].setCoords(_bottLeft.getX() - _height * ang_sin + _width * ang_cos,
+        _bottLeft.getY() + _height * ang_cos + _width * ang_sin);
+    corners[3].setCoords(_bottLeft.getX() + _width * ang_cos, _bottLeft.getY() + _width * ang_sin);
+}
+
 void RectangularEnt::serialize(Buffer& buffer)
 {
-    SimEnt::serialize(buffer);
-
-    double ang_cos = cos(_angle);
-    double ang_sin = sin(_angle);
-    buffer.pack(_bottLeft->getX());
-    buffer.pack(_bottLeft->getY());
-    buffer.pack(_bottLeft->getX() - _height * ang_sin);
-    buffer.pack(_bottLeft->getY() + _height * ang_cos);
-    buffer.pack(_bottLeft->getX() - _height * ang_sin + _width * ang_cos);
-    buffer.pack(_bottLeft->getY() + _height * ang_cos + _width * ang_sin);
-    buffer.pack(_bottLeft->getX() + _width * ang_cos);
-    buffer.pack(_bottLeft->getY() + _width * ang_sin);
+    writeFields(*this, _shapeID, buffer);
+}
+
+void RectangularEnt::serialize(std::ostream& file)
+{
+    writeFields(*this, _shapeID, file);
 }
 
-void RectangularEnt::serialize(std::ofstream& file)
+void RectangularEnt::serialize(WorldImageBuilder& image)
 {
-    double x = _bottLeft->getX();
-    double y = _bottLeft->getY();
-
-    SimEnt::serialize(file);
-    file.write(reinterpret_cast<const char*>(&x), sizeof(x));
-    file.write(reinterpret_cast<const char*>(&y), sizeof(y));
-    file.write(reinterpret_cast<const char*>(&_width), sizeof(_width));
-    file.write(reinterpret_cast<const char*>(&_height), sizeof(_height));
-    file.write(reinterpret_cast<const char*>(&_angle), sizeof(_angle));
+    image.addEntity(*this, _shapeID);
 }
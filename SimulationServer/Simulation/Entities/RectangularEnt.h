@@ -10,33 +10,64 @@ class RectangularEnt : public SimEnt
 {
 	public:
 		// x, y -> left-bottom corner coords, rotating clockwise
-		RectangularEnt(uint16_t id, uint32_t weight, bool movable, double x,
-			double y, double width, double height, float angle = 0);
-        RectangularEnt(std::ifstream& file, bool readBinary);
+		RectangularEnt(uint32_t id, uint32_t weight, bool movable, Scalar x,
+			Scalar y, Scalar width, Scalar height, Scalar angle = 0);
+        RectangularEnt(std::istream& file, uint16_t formatVersion = WORLD_FORMAT_VERSION);
         RectangularEnt(const RectangularEnt& other);
+        explicit RectangularEnt(FieldSource& source);
 
-		virtual ~RectangularEnt() { delete _bottLeft; delete _center; }
+		Scalar collisionLength(SimEnt& other, Point& proj);
+		Point& getBottLeft() { return _bottLeft; }
+		Point& getCenter() { return _center; }
+        void getCorners(Point* corners); // bottom left first, clockwise
 
-		double collisionLength(SimEnt& other, Point& proj);
-		Point& getBottLeft() { return *_bottLeft; }
-		Point& getCenter() { return *_center; }
-
-		virtual void translate(double x, double y);
+		virtual void translate(Scalar x, Scalar y);
+        virtual BoundingBox getBoundingBox();
 
 		virtual void serialize(Buffer& buffer);
-		virtual void serialize(std::ofstream& file);
+		virtual void serialize(std::ostream& file);
+        virtual void serialize(WorldImageBuilder& image);
+
+        // files keep the rectangle as it was defined, visualisers get its corners, not to rotate it themselves
+        template <typename Visitor>
+        void visitFields(Visitor& visitor)
+        {
+            SimEnt::visitFields(visitor);
+            if (visitor.isWire())
+            {
+                Point corners[4];
+                getCorners(corners);
+                for (int i = 0; i < 4; i++)
+                    visitor.point(corners[i]);
+            }
+            else
+            {
+                visitor.point(_bottLeft);
+                visitor.real64(_width);
+                visitor.real64(_height);
+                visitor.angle(_angle);
+            }
+        }
+        // center is derived from the angle
+        template <typename Visitor>
+        void visitState(Visitor& visitor)
+        {
+            SimEnt::visitState(visitor);
+            visitor.real64(_angle);
+            visitor.point(_center);
+        }
 
 	protected:
-		double check_and_divide(CircularEnt& other, Point& bottLeft, double width, double height, int level);
+		Scalar check_and_divide(CircularEnt& other, Point& bottLeft, Scalar width, Scalar height, int level);
 
-		Point* _bottLeft;
-		Point* _center;
-		double _width;
-		double _height;
-		float _angle; // in radians, rotating clockwise
+		Point _bottLeft;
+		Point _center;
+		Scalar _width;
+		Scalar _height;
+		Scalar _angle; // in radians, rotating clockwise
 
     private:
-        void initializeEntity(double bottLeftX, double bottLeftY);
+        void initializeEntity(Scalar bottLeftX, Scalar bottLeftY);
 };
 
 #endif
@@ -16,6 +16,9 @@
 #include "../Buffer.h"
 #include "../Math/Point.h"
 #include "../Math/MathLib.h"
+#include "../Math/BoundingBox.h"
+#include "../Serialization/Fields.h"
+#include "../Serialization/WorldImage.h"
 
 class SimEnt
 {
@@ -26,34 +29,80 @@ class SimEnt
 		static const uint8_t KHEPERA_ROBOT = 2;
 		static const uint8_t LINE = 3;
 
-		SimEnt(uint16_t id, uint8_t shape, uint32_t weight, bool movable) : _id(id), _shapeID(shape),
-			_weight(weight), _movable(movable) {}
-		SimEnt(std::ifstream& file, bool readBinary, uint8_t shapeID);
+		SimEnt(uint32_t id, uint8_t shape, uint32_t weight, bool movable) : _id(id), _shapeID(shape),
+			_weight(weight), _movable(movable), _serial(0), _slot(0), _odometer(0) {}
 
 		virtual ~SimEnt() {}
 
-		int getID() const { return _id; }
+		uint32_t getID() const { return _id; }
         int getShapeID() const { return _shapeID; }
         int getWeight() const { return _weight; }
         bool isMovable() const { return _movable != 0; }
+        // assigned by simulation, unique for its whole lifetime
+        uint32_t getSerial() const { return _serial; }
+        void setSerial(uint32_t serial) { _serial = serial; }
+        // index of entity in dense table of simulation, reused after entity is removed
+        uint32_t getSlot() const { return _slot; }
+        void setSlot(uint32_t slot) { _slot = slot; }
+        // total distance travelled by entity, so that cached distances do not have to be updated on every move
+        double getOdometer() const { return _odometer; }
+        void addToOdometer(double distance) { _odometer += distance; }
 
-		virtual double collisionLength(SimEnt& other, Point& proj) = 0;
+		virtual Scalar collisionLength(SimEnt& other, Point& proj) = 0;
 		// virtual void rotate(double angle) = 0; TODO: Later
-		virtual void translate(double x, double y) = 0;
+		virtual void translate(Scalar x, Scalar y) = 0;
+        virtual BoundingBox getBoundingBox() = 0;
 
-        virtual double updatePosition(double deltaTime) { return 0; }
+        virtual Scalar updatePosition(Scalar deltaTime) { return 0; }
 
 		// serialize for network transmission
 		virtual void serialize(Buffer& buffer) = 0;
 		// serialize for file storage. WARNING: Uses host-byte-order
-		virtual void serialize(std::ofstream& file) = 0;
+		virtual void serialize(std::ostream& file) = 0;
+        // store as a row of world image
+        virtual void serialize(WorldImageBuilder& image) = 0;
+
+        /*
+            Serialization format (integers in network-byte-order on the wire and in host-byte-order in files,
+            doubles and floats always in host-byte-order)
+            ENTITY_ID has 16 bits in protocol (and world file format) version 1, 32 bits since version 2
+
+            +-------------------+--------------------------------------+-------------------+
+            |                   |                                      |                   |
+            |   SHAPE_ID        |              ENTITY_ID               |    MOVABLE        |
+            |    8 bits         |             16 / 32 bits             |    8 bits         |
+            +-------------------+--------------------------------------+-------------------+
+            |                                                                              |
+            |                                WEIGHT                                        |
+            |                                32 bits                                       |
+            +------------------------------------------------------------------------------+
+            |                                                                              |
+            |                            SHAPE_SPECIFIC_DATA                               |
+            |                              variable length                                 |
+            +------------------------------------------------------------------------------+
+
+        */
+        // fields of every entity, shape specific data follow them (see Serialization/Fields.h)
+        template <typename Visitor>
+        void visitFields(Visitor& visitor)
+        {
+            visitor.id(_id);
+            visitor.integer(_movable);
+            visitor.integer(_weight);
+        }
+        template <typename Visitor>
+        void visitState(Visitor& visitor) { visitor.real64(_odometer); }
+
 	protected:
 
 		/* TODO: Maybe we should store color information, so that visualiser user will be able to distinct diffrent entities */
-        uint16_t   _id;
+        uint32_t   _id;
         uint8_t    _shapeID;
         uint32_t   _weight;
 		uint8_t    _movable; // stored as integer, to be able to send it through socket
+        uint32_t   _serial;
+        uint32_t   _slot;
+        double     _odometer;
 };
 
 #endif
\ No newline at end of file
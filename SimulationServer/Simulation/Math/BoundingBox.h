@@ -0,0 +1,27 @@
+#ifndef BOUNDING_BOX_H
+#define BOUNDING_BOX_H
+
+// axis aligned rectangle containing whole entity
+struct BoundingBox
+{
+    BoundingBox(Scalar minX = 0, Scalar minY = 0, Scalar maxX = 0, Scalar maxY = 0)
+        : minX(minX), minY(minY), maxX(maxX), maxY(maxY) {}
+
+    bool intersects(const BoundingBox& other) const
+    {
+        return minX <= other.maxX && other.minX <= maxX && minY <= other.maxY && other.minY <= maxY;
+    }
+
+    // grows box by MARGIN in every direction
+    BoundingBox expanded(Scalar margin) const
+    {
+        return BoundingBox(minX - margin, minY - margin, maxX + margin, maxY + margin);
+    }
+
+    Scalar minX;
+    Scalar minY;
+    Scalar maxX;
+    Scalar maxY;
+};
+
+#endif
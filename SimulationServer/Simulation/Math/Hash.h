@@ -0,0 +1,17 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <stdint.h>
+#include <cstddef>
+
+#define FNV_OFFSET_BASIS    0xCBF29CE484222325ULL // initial value of hash
+
+// FNV-1a, used for state hashes and checksums of files
+inline void hashBytes(uint64_t& hash, const void* data, size_t length)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < length; i++)
+        hash = (hash ^ bytes[i]) * 0x100000001B3ULL;
+}
+
+#endif
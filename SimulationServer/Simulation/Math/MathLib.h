@@ -17,13 +17,13 @@
 #endif
 
 //	computes cosinus with an argument in arc degrees
-double cosD(double arcDegrees);
+Scalar cosD(Scalar arcDegrees);
 
 //	computes sinus with an argument in arc degrees
-double sinD(double arcDegrees);
+Scalar sinD(Scalar arcDegrees);
 
 //	returns sign of this number
-int sign(double number);
+int sign(Scalar number);
 
 //	computes orthogonal projection of point P into line defined by two poins: LINE_BEG and LINE_END
 Point orthogonalProjection(Point& p, Point& line_beg, Point& line_end, bool* belongs_to_line = 0);
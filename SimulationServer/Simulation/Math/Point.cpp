@@ -1,18 +1,18 @@
 #include "Point.h"
 
-double Point::getDistance(Point& other) const
+Scalar Point::getDistance(Point& other) const
 {
-	double x_diff = getXDiff(other);
-	double y_diff = getYDiff(other);
+	Scalar x_diff = getXDiff(other);
+	Scalar y_diff = getYDiff(other);
 	return sqrt(x_diff * x_diff + y_diff * y_diff);
 }
 
-double Point::dot(Point& other)
+Scalar Point::dot(Point& other)
 {
 	return _x * other.getX() + _y * other.getY();
 }
 
-double Point::cross(Point& other)
+Scalar Point::cross(Point& other)
 {
     return _x * other.getY() - other.getX() * _y;
 }
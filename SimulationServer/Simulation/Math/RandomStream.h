@@ -0,0 +1,52 @@
+#ifndef RANDOM_STREAM_H
+#define RANDOM_STREAM_H
+
+#include <stdint.h>
+
+// counter based generator - n-th number of a stream is a hash of its key and n (SplitMix64 output function),
+// so streams can be split from each other without sharing any state, and every one of them replays exactly,
+// whatever order they are used in; satisfies UniformRandomBitGenerator
+class RandomStream
+{
+    public:
+        typedef uint64_t result_type;
+
+        explicit RandomStream(uint64_t seed = 0) : _key(mix(seed)), _counter(0) {}
+
+        // in parentheses, not to be expanded by min and max macros from MathLib
+        static result_type (min)() { return 0; }
+        static result_type (max)() { return UINT64_MAX; }
+        result_type operator()() { return mix(_key + ++_counter * GOLDEN_GAMMA); }
+
+        // independent stream, identified by STREAM - the same for every call with the same STREAM
+        RandomStream split(uint64_t stream) const
+        {
+            RandomStream child;
+            child._key = mix(_key ^ mix(stream + GOLDEN_GAMMA));
+            return child;
+        }
+
+        // uniform number from [from, to) - std distributions differ between standard libraries
+        double uniform(double from, double to) { return from + (to - from) * ((*this)() >> 11) * (1.0 / (1ULL << 53)); }
+
+        // number of values drawn so far, together with the key it is the whole state of the stream
+        uint64_t getCounter() const { return _counter; }
+        void setCounter(uint64_t counter) { _counter = counter; }
+        uint64_t getKey() const { return _key; }
+        void setKey(uint64_t key) { _key = key; }
+
+    private:
+        static const uint64_t GOLDEN_GAMMA = 0x9E3779B97F4A7C15ULL;
+
+        static uint64_t mix(uint64_t z)
+        {
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            return z ^ (z >> 31);
+        }
+
+        uint64_t    _key;
+        uint64_t    _counter;
+};
+
+#endif
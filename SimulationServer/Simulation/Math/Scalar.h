@@ -0,0 +1,21 @@
+#ifndef SCALAR_H
+#define SCALAR_H
+
+#include <cmath>
+
+// precision of simulation geometry, build with SIMULATION_FLOAT_PRECISION defined (make PRECISION=float)
+// for single precision engine; world files and network protocol use the same types in both builds
+#ifdef SIMULATION_FLOAT_PRECISION
+typedef float Scalar;
+#else
+typedef double Scalar;
+#endif
+
+// float overloads are declared only in std namespace
+using std::sqrt;
+using std::sin;
+using std::cos;
+using std::acos;
+using std::fabs;
+
+#endif
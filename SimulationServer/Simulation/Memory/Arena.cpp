@@ -0,0 +1,71 @@
+#include "Arena.h"
+
+#include <cstdint>
+
+Arena::Arena(size_t initialBlockSize) : _current(NULL), _end(NULL), _nextBlockSize(initialBlockSize),
+    _initialBlockSize(initialBlockSize), _reservedBytes(0)
+{
+}
+
+void* Arena::allocate(size_t size, size_t alignment)
+{
+    // recycled pieces are always whole size classes, so any of them fits
+    size_t sizeClass = getSizeClass(size, alignment);
+    if (sizeClass != 0)
+    {
+        if (sizeClass < _freeLists.size() && _freeLists[sizeClass] != NULL)
+        {
+            void* piece = _freeLists[sizeClass];
+            _freeLists[sizeClass] = *static_cast<void**>(piece);
+            return piece;
+        }
+        size = sizeClass * SIZE_CLASS;
+        alignment = SIZE_CLASS;
+    }
+
+    uintptr_t aligned = (reinterpret_cast<uintptr_t>(_current) + alignment - 1) & ~(uintptr_t)(alignment - 1);
+    if (_current == NULL || aligned + size > reinterpret_cast<uintptr_t>(_end))
+    {
+        addBlock(size + alignment);
+        aligned = (reinterpret_cast<uintptr_t>(_current) + alignment - 1) & ~(uintptr_t)(alignment - 1);
+    }
+    _current = reinterpret_cast<char*>(aligned + size);
+    return reinterpret_cast<void*>(aligned);
+}
+
+void Arena::recycle(void* ptr, size_t size, size_t alignment)
+{
+    // pieces of other sizes stay unused until the arena is released
+    size_t sizeClass = getSizeClass(size, alignment);
+    if (ptr == NULL || sizeClass == 0)
+        return;
+    if (sizeClass >= _freeLists.size())
+        _freeLists.resize(sizeClass + 1, NULL);
+    *static_cast<void**>(ptr) = _freeLists[sizeClass];
+    _freeLists[sizeClass] = ptr;
+}
+
+void Arena::addBlock(size_t minSize)
+{
+    size_t blockSize = _nextBlockSize > minSize ? _nextBlockSize : minSize;
+    char* block = static_cast<char*>(::operator new(blockSize));
+    _blocks.push_back(block);
+    _current = block;
+    _end = block + blockSize;
+    _reservedBytes += blockSize;
+
+    // blocks grow geometrically, so big worlds don't end up with long lists of small blocks
+    if (_nextBlockSize < MAX_BLOCK_SIZE)
+        _nextBlockSize *= 2;
+}
+
+void Arena::release()
+{
+    for (std::vector<char*>::iterator it = _blocks.begin(); it != _blocks.end(); it++)
+        ::operator delete(*it);
+    _blocks.clear();
+    _freeLists.clear();
+    _current = _end = NULL;
+    _nextBlockSize = _initialBlockSize;
+    _reservedBytes = 0;
+}
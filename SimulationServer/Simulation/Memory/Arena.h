@@ -0,0 +1,132 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+
+// memory arena - memory is handed out linearly from big blocks and is returned to the system only all at once,
+// when arena is destroyed or released; small pieces given back by recycle (or destroy) are reused for the next
+// allocations of the same size class, so objects created and removed again and again do not grow the arena
+// WARNING: destructors of objects created in arena are called only by destroy, so such objects may own only
+// arena memory (or no memory at all)
+
+class Arena
+{
+    public:
+        static const size_t DEFAULT_BLOCK_SIZE = 16 * 1024;
+        static const size_t MAX_BLOCK_SIZE = 1024 * 1024;
+        static const size_t SIZE_CLASS = 16; // granularity of recycled pieces, also their alignment
+        static const size_t MAX_RECYCLED_SIZE = 1024; // bigger pieces are not reused
+
+        Arena(size_t initialBlockSize = DEFAULT_BLOCK_SIZE);
+        ~Arena() { release(); }
+
+        void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+        // constructs object of type T in arena memory
+        template <typename T, typename... Args>
+        T* create(Args&&... args);
+
+        // memory at PTR, allocated with the same SIZE and ALIGNMENT, will be given to the next allocation
+        // of similar size
+        void recycle(void* ptr, size_t size, size_t alignment = alignof(std::max_align_t));
+        // calls destructor of OBJECT created by create and recycles its memory
+        template <typename T>
+        void destroy(T* object);
+
+        // returns all blocks at once, every object created in arena becomes invalid
+        void release();
+
+        size_t getReservedBytes() const { return _reservedBytes; }
+
+    private:
+        // no cloning
+        Arena(const Arena& other);
+        Arena& operator=(const Arena& other);
+
+        void addBlock(size_t minSize);
+        // index of free list for pieces of SIZE bytes, 0 if they are not recycled
+        static size_t getSizeClass(size_t size, size_t alignment)
+        {
+            return alignment <= SIZE_CLASS && size <= MAX_RECYCLED_SIZE ? (size + SIZE_CLASS - 1) / SIZE_CLASS : 0;
+        }
+
+        std::vector<char*>   _blocks;
+        std::vector<void*>   _freeLists; // first free piece of every size class, it points to the next one
+        char*                _current;
+        char*                _end;
+        size_t               _nextBlockSize;
+        size_t               _initialBlockSize;
+        size_t               _reservedBytes;
+};
+
+template <typename T, typename... Args>
+T* Arena::create(Args&&... args)
+{
+    return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+}
+
+template <typename T>
+void Arena::destroy(T* object)
+{
+    object->~T();
+    recycle(object, sizeof(T), alignof(T));
+}
+
+// creates object in ARENA or on the heap if no arena was given
+template <typename T, typename... Args>
+T* arenaCreate(Arena* arena, Args&&... args)
+{
+    if (arena != NULL)
+        return arena->create<T>(std::forward<Args>(args)...);
+    return new T(std::forward<Args>(args)...);
+}
+
+// allocator adapter, that lets standard containers keep their storage in arena
+// allocator without arena falls back to global heap
+template <typename T>
+class ArenaAllocator
+{
+    public:
+        typedef T value_type;
+
+        ArenaAllocator(Arena* arena = NULL) : _arena(arena) {}
+        template <typename U>
+        ArenaAllocator(const ArenaAllocator<U>& other) : _arena(other.getArena()) {}
+
+        T* allocate(size_t n)
+        {
+            if (_arena != NULL)
+                return static_cast<T*>(_arena->allocate(n * sizeof(T), alignof(T)));
+            return static_cast<T*>(::operator new(n * sizeof(T)));
+        }
+
+        void deallocate(T* ptr, size_t n)
+        {
+            if (_arena != NULL)
+                _arena->recycle(ptr, n * sizeof(T), alignof(T));
+            else
+                ::operator delete(ptr);
+        }
+
+        Arena* getArena() const { return _arena; }
+
+    private:
+        Arena* _arena;
+};
+
+template <typename T, typename U>
+bool operator==(const ArenaAllocator<T>& fst, const ArenaAllocator<U>& snd)
+{
+    return fst.getArena() == snd.getArena();
+}
+
+template <typename T, typename U>
+bool operator!=(const ArenaAllocator<T>& fst, const ArenaAllocator<U>& snd)
+{
+    return !(fst == snd);
+}
+
+#endif
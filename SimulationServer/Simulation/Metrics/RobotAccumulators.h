@@ -0,0 +1,61 @@
+#ifndef ROBOT_ACCUMULATORS_H
+#define ROBOT_ACCUMULATORS_H
+
+#include <stdint.h>
+
+#include "../Constants.h"
+
+// accumulators IDs, used as flags in AccumulatorsConfig
+#define ACC_DISTANCE                1
+#define ACC_SPEED_SYMMETRY          2
+#define ACC_MAX_SENSOR              4
+#define ACC_COLLISIONS              8
+#define ACC_NEAR_WALLS              16
+#define ACC_ALL                     (ACC_DISTANCE | ACC_SPEED_SYMMETRY | ACC_MAX_SENSOR | ACC_COLLISIONS | ACC_NEAR_WALLS)
+
+// near walls accumulator needs distance to every line in the world, so it is off by default
+#define ACC_DEFAULT                 (ACC_ALL & ~ACC_NEAR_WALLS)
+
+struct AccumulatorsConfig
+{
+    AccumulatorsConfig() : enabled(ACC_DEFAULT), nearWallDistance(0), maxMotorSpeed(DEFAULT_MAX_MOTOR_SPEED) {}
+
+    uint32_t    enabled;            // ACC_* flags
+    double      nearWallDistance;   // robot is near wall, if gap between them is smaller
+    double      maxMotorSpeed;      // used to normalize speed symmetry
+};
+
+// fitness related statistics of a single robot, updated natively by Simulation::update
+// plain structure, so that it can be passed directly through DllInterface
+struct RobotAccumulators
+{
+    RobotAccumulators() { reset(); }
+    void reset()
+    {
+        distanceTravelled = 0;
+        speedSymmetrySum = 0;
+        maxSensorActivation = 0;
+        collisions = 0;
+        timeNearWalls = 0;
+        steps = 0;
+    }
+    template <typename Visitor>
+    void visitFields(Visitor& visitor)
+    {
+        visitor.real64(distanceTravelled);
+        visitor.real64(speedSymmetrySum);
+        visitor.real32(maxSensorActivation);
+        visitor.integer(collisions);
+        visitor.real64(timeNearWalls);
+        visitor.integer(steps);
+    }
+
+    double      distanceTravelled;    // real displacement (after collisions), summed over steps
+    double      speedSymmetrySum;     // 1 - sqrt(|left - right| / (2 * maxMotorSpeed)), summed over steps
+    float       maxSensorActivation;  // the highest state reached by any of robot sensors
+    int32_t     collisions;           // number of collisions robot took part in
+    double      timeNearWalls;        // [ s ]
+    int32_t     steps;                // number of steps accumulated since last reset
+};
+
+#endif
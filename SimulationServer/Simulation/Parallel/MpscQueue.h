@@ -0,0 +1,92 @@
+#ifndef MPSC_QUEUE_H
+#define MPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// bounded lock-free queue for any number of producer threads and one consumer thread
+// every slot has sequence number telling, whose turn it is: producer of lap N may fill it, when sequence is
+// N * capacity + index, consumer may empty it, when it is one more
+template <typename T>
+class MpscQueue
+{
+    public:
+        // CAPACITY is rounded up to power of two
+        explicit MpscQueue(size_t capacity) : _head(0), _tail(0)
+        {
+            size_t size = 1;
+            while (size < capacity)
+                size <<= 1;
+            _slots = new Slot[size];
+            for (size_t i = 0; i < size; i++)
+                _slots[i].sequence.store(i, std::memory_order_relaxed);
+            _mask = size - 1;
+        }
+        ~MpscQueue() { delete[] _slots; }
+
+        // any thread, false if queue is full
+        bool push(const T& item)
+        {
+            size_t tail = _tail.load(std::memory_order_relaxed);
+            Slot* slot;
+            while (true)
+            {
+                slot = &_slots[tail & _mask];
+                intptr_t lap = static_cast<intptr_t>(slot->sequence.load(std::memory_order_acquire))
+                    - static_cast<intptr_t>(tail);
+                if (lap == 0)
+                {
+                    // slot is free, it is ours if no other producer took it meanwhile
+                    if (_tail.compare_exchange_weak(tail, tail + 1, std::memory_order_relaxed))
+                        break;
+                }
+                else if (lap < 0)
+                    return false; // consumer did not empty the slot from previous lap
+                else
+                    tail = _tail.load(std::memory_order_relaxed);
+            }
+            slot->item = item;
+            slot->sequence.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        // consumer only, false if queue is empty (or the oldest item is still being written)
+        bool pop(T& item)
+        {
+            size_t head = _head.load(std::memory_order_relaxed);
+            Slot& slot = _slots[head & _mask];
+            if (slot.sequence.load(std::memory_order_acquire) != head + 1)
+                return false;
+            item = slot.item;
+            slot.sequence.store(head + _mask + 1, std::memory_order_release);
+            _head.store(head + 1, std::memory_order_relaxed);
+            return true;
+        }
+
+        // items waiting, only approximate while other threads push or pop
+        size_t getSize() const
+        {
+            size_t head = _head.load(std::memory_order_relaxed);
+            size_t tail = _tail.load(std::memory_order_relaxed);
+            return tail > head ? tail - head : 0;
+        }
+        size_t getCapacity() const { return _mask + 1; }
+
+    private:
+        MpscQueue(const MpscQueue& other);
+
+        struct Slot
+        {
+            std::atomic<size_t> sequence;
+            T                   item;
+        };
+
+        Slot*               _slots;
+        size_t              _mask;
+        // on separate cache lines, so that producers do not invalidate line of consumer on every item
+        alignas(64) std::atomic<size_t> _head; // next item to pop
+        alignas(64) std::atomic<size_t> _tail; // next slot to be taken by producer
+};
+
+#endif
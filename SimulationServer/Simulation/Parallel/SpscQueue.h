@@ -0,0 +1,59 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// bounded lock-free queue for exactly one producer thread and one consumer thread
+// items are moved in and out, so slots keep their capacity (e.g. of strings) for next items
+template <typename T>
+class SpscQueue
+{
+    public:
+        // CAPACITY is rounded up to power of two
+        explicit SpscQueue(size_t capacity) : _head(0), _tail(0)
+        {
+            size_t size = 1;
+            while (size < capacity)
+                size <<= 1;
+            _slots.resize(size);
+            _mask = size - 1;
+        }
+
+        // producer only, false if queue is full (ITEM is left untouched then)
+        bool push(T& item)
+        {
+            size_t tail = _tail.load(std::memory_order_relaxed);
+            if (tail - _head.load(std::memory_order_acquire) > _mask)
+                return false;
+            std::swap(_slots[tail & _mask], item);
+            _tail.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        // consumer only, false if queue is empty
+        bool pop(T& item)
+        {
+            size_t head = _head.load(std::memory_order_relaxed);
+            if (head == _tail.load(std::memory_order_acquire))
+                return false;
+            std::swap(item, _slots[head & _mask]);
+            _head.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+        size_t getCapacity() const { return _mask + 1; }
+
+    private:
+        SpscQueue(const SpscQueue& other);
+
+        std::vector<T>      _slots;
+        size_t              _mask;
+        // on separate cache lines, so that both threads do not invalidate each other's line on every item
+        alignas(64) std::atomic<size_t> _head; // next item to pop
+        alignas(64) std::atomic<size_t> _tail; // next free slot
+};
+
+#endif
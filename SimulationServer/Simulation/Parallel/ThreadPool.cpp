@@ -0,0 +1,74 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(int threadCount) : _task(NULL), _count(0), _pending(0), _generation(0), _stopping(false)
+{
+    for (int i = 1; i < threadCount; i++)
+        _workers.push_back(std::thread(&ThreadPool::workerLoop, this, i));
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _started.notify_all();
+    for (size_t i = 0; i < _workers.size(); i++)
+        _workers[i].join();
+}
+
+void ThreadPool::parallelFor(int count, const Task& task)
+{
+    if (_workers.empty() || count < 2)
+    {
+        task(0, count, 0);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _task = &task;
+        _count = count;
+        _pending = (int) _workers.size();
+        _generation++;
+    }
+    _started.notify_all();
+
+    runRange(0);
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    _finished.wait(lock, [this] { return _pending == 0; });
+    _task = NULL;
+}
+
+void ThreadPool::runRange(int worker)
+{
+    int threads = getThreadCount();
+    int begin = (int) ((long long) _count * worker / threads);
+    int end = (int) ((long long) _count * (worker + 1) / threads);
+    if (begin < end)
+        (*_task)(begin, end, worker);
+}
+
+void ThreadPool::workerLoop(int worker)
+{
+    unsigned int seenGeneration = 0;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _started.wait(lock, [&] { return _stopping || _generation != seenGeneration; });
+            if (_stopping)
+                return;
+            seenGeneration = _generation;
+        }
+
+        runRange(worker);
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _pending--;
+        }
+        _finished.notify_one();
+    }
+}
@@ -0,0 +1,43 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// fixed set of workers running ranges of a loop; [0, count) is always split into the same contiguous ranges
+// for given number of threads, and tasks write only to their own elements, so results do not depend on
+// scheduling - only work done by every thread does
+class ThreadPool
+{
+    public:
+        // TASK(begin, end, worker) - WORKER is in [0, getThreadCount()), so that tasks can keep per-worker buffers
+        typedef std::function<void(int, int, int)> Task;
+
+        explicit ThreadPool(int threadCount); // including calling thread
+        ~ThreadPool();
+
+        int getThreadCount() const { return (int) _workers.size() + 1; }
+        // runs TASK for ranges covering [0, COUNT) and waits until all of them are finished
+        // calling thread processes the first range itself
+        void parallelFor(int count, const Task& task);
+
+    private:
+        ThreadPool(const ThreadPool& other);
+        void workerLoop(int worker);
+        void runRange(int worker);
+
+        std::vector<std::thread>    _workers;
+        std::mutex                  _mutex;
+        std::condition_variable     _started;
+        std::condition_variable     _finished;
+        const Task*                 _task;
+        int                         _count;
+        int                         _pending; // workers, which did not finish current task yet
+        unsigned int                _generation; // incremented for every task, so workers know there is a new one
+        bool                        _stopping;
+};
+
+#endif
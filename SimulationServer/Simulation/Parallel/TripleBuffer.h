@@ -0,0 +1,47 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <atomic>
+#include <cstdint>
+
+// three values shared by one writer thread and one reader thread without waiting for each other: writer fills
+// the back value and publishes it, reader takes the newest published one as its front value; values, which
+// reader did not take in time, are overwritten, so reader always gets the latest one
+template <typename T>
+class TripleBuffer
+{
+    public:
+        TripleBuffer() : _back(0), _middle(1), _front(2) {}
+
+        // writer only
+        T& getBack() { return _values[_back]; }
+        void publish()
+        {
+            _back = _middle.exchange(_back | NEW_FLAG, std::memory_order_acq_rel) & INDEX_MASK;
+        }
+
+        // reader only
+        bool hasNew() const { return (_middle.load(std::memory_order_acquire) & NEW_FLAG) != 0; }
+        // false if nothing was published since the last call, front value stays the same then
+        bool takeNew()
+        {
+            if (!hasNew())
+                return false;
+            _front = _middle.exchange(_front, std::memory_order_acq_rel) & INDEX_MASK;
+            return true;
+        }
+        const T& getFront() const { return _values[_front]; }
+
+    private:
+        TripleBuffer(const TripleBuffer& other);
+
+        static const uint8_t INDEX_MASK = 3;
+        static const uint8_t NEW_FLAG = 4; // value in the middle was published and not taken yet
+
+        T                       _values[3];
+        uint8_t                 _back;
+        std::atomic<uint8_t>    _middle; // index and NEW_FLAG
+        uint8_t                 _front;
+};
+
+#endif
@@ -1,40 +1,39 @@
 #include "ProximitySensor.h"
 #include "../Math/MathLib.h"
 
-void ProximitySensor::updateState(const SimEntMap::const_iterator& firstEntity, 
-    const SimEntMap::const_iterator& lastEntity)
+void ProximitySensor::updateState(const std::vector<SimEnt*>& entities)
 {
     Point rangeBeg(_robot->getCenter());
-    float sensorAngle = _robot->getDirectionAngle() - _placingAngle;
+    Scalar sensorAngle = _robot->getDirectionAngle() - _placingAngle;
     rangeBeg.translate(_robot->getRadius() * cos(sensorAngle), _robot->getRadius() * sin(sensorAngle));
     std::vector<Point> rangeEnds(_beams, Point(rangeBeg));
     for (int i = 0; i < _beams; i++)
     {
-        double angle = sensorAngle + _rangeAngle / 2 - i * _rangeAngle / (_beams - 1);
+        Scalar angle = sensorAngle + _rangeAngle / 2 - i * _rangeAngle / (_beams - 1);
         rangeEnds[i].translate(_range * cos(angle), _range * sin(angle));
     }
 
-    double minDetection = _range; // no detection
-    for (SimEntMap::const_iterator it = firstEntity; it != lastEntity; it++)
+    Scalar minDetection = _range; // no detection
+    for (std::vector<SimEnt*>::const_iterator it = entities.begin(); it != entities.end(); it++)
     {
-        if (it->second->getID() != _robot->getID())
+        if ((*it)->getID() != _robot->getID())
         {
-            int shape = it->second->getShapeID();
+            int shape = (*it)->getShapeID();
             for (int i = 0; i < _beams; i++)
             {
                 if (shape == SimEnt::KHEPERA_ROBOT || shape == SimEnt::CIRCLE)
                 {
-                    CircularEnt* entity = dynamic_cast<CircularEnt*>(it->second);
+                    CircularEnt* entity = dynamic_cast<CircularEnt*>(*it);
                     minDetection = min(minDetection, detectCircle(*entity, rangeBeg, rangeEnds[i]));
                 }
                 else if (shape == SimEnt::LINE)
                 {
-                    LinearEnt* entity = dynamic_cast<LinearEnt*>(it->second);
+                    LinearEnt* entity = dynamic_cast<LinearEnt*>(*it);
                     minDetection = min(minDetection, detectLine(*entity, rangeBeg, rangeEnds[i]));
                 }
                 else if (shape == SimEnt::RECTANGLE)
                 {
-                    RectangularEnt* entity = dynamic_cast<RectangularEnt*>(it->second);
+                    RectangularEnt* entity = dynamic_cast<RectangularEnt*>(*it);
                     minDetection = min(minDetection, detectRectange(*entity, rangeBeg, rangeEnds[i]));
                 }
             }
@@ -44,14 +43,14 @@ void ProximitySensor::updateState(const SimEntMap::const_iterator& firstEntity,
     //std::cout << "minDet: " << minDetection << ", sensor state: " << _state << std::endl;
 }
 
-double ProximitySensor::detectCircle(CircularEnt& entity, Point& sensor_beg, Point& sensor_end)
+Scalar ProximitySensor::detectCircle(CircularEnt& entity, Point& sensor_beg, Point& sensor_end)
 {
-    double minDetection = INF_COLLISION;
+    Scalar minDetection = INF_COLLISION;
 
     Point& center = entity.getCenter();
-    double radius = entity.getRadius();
+    Scalar radius = entity.getRadius();
     Point orth_proj = orthogonalProjection(center, sensor_beg, sensor_end);
-    double dist_from_line = orth_proj.getDistance(center);
+    Scalar dist_from_line = orth_proj.getDistance(center);
 
     if (dist_from_line == radius && orth_proj.isBetween(sensor_beg, sensor_end))
         return sensor_beg.getDistance(orth_proj);
@@ -59,11 +58,11 @@ double ProximitySensor::detectCircle(CircularEnt& entity, Point& sensor_beg, Poi
         return sensor_beg.getDistance(orth_proj) - radius;
     else if (dist_from_line < radius)
     {
-        double k = radius / dist_from_line;
-        float touchAngle = (float) acos(dist_from_line / radius);
+        Scalar k = radius / dist_from_line;
+        Scalar touchAngle = acos(dist_from_line / radius);
         Point projOnCircle(center.getX() + orth_proj.getXDiff(center) * k,
             center.getY() + orth_proj.getYDiff(center) * k);
-        float directionAngle = (float) acos(projOnCircle.getXDiff(center) / radius)
+        Scalar directionAngle = acos(projOnCircle.getXDiff(center) / radius)
             * sign(projOnCircle.getYDiff(center));
         Point left(center);
         left.translate(radius * cos(directionAngle + touchAngle),
@@ -79,25 +78,25 @@ double ProximitySensor::detectCircle(CircularEnt& entity, Point& sensor_beg, Poi
     return minDetection;
 }
 
-double ProximitySensor::detectLine(LinearEnt& entity, Point& sensor_beg, Point& sensor_end)
+Scalar ProximitySensor::detectLine(LinearEnt& entity, Point& sensor_beg, Point& sensor_end)
 {
     // check if ends of linear entity are between ends of current beam
     Point temp = sensor_end - sensor_beg;
-    double beg_cross = (entity.getBeg() - sensor_beg).cross(temp);
-    double end_cross = (entity.getEnd() - sensor_beg).cross(temp);
+    Scalar beg_cross = (entity.getBeg() - sensor_beg).cross(temp);
+    Scalar end_cross = (entity.getEnd() - sensor_beg).cross(temp);
     if (beg_cross && end_cross && sign(beg_cross) != sign(end_cross))
     {
         // check if ends of current beam are between ends of linear ent
         Point temp2 = entity.getEnd() - entity.getBeg();
-        double beg2_cross = (sensor_beg - entity.getBeg()).cross(temp2);
-        double end2_cross = (sensor_end - entity.getBeg()).cross(temp2);
+        Scalar beg2_cross = (sensor_beg - entity.getBeg()).cross(temp2);
+        Scalar end2_cross = (sensor_end - entity.getBeg()).cross(temp2);
         if (beg2_cross && end2_cross && sign(beg2_cross) != sign(end2_cross))
             return _range * (beg2_cross / (beg2_cross - end2_cross));
     }
     return INF_COLLISION;
 }
 
-double ProximitySensor::detectRectange(RectangularEnt& entity, Point& sensor_beg, Point& sensor_end)
+Scalar ProximitySensor::detectRectange(RectangularEnt& entity, Point& sensor_beg, Point& sensor_end)
 {
     return INF_COLLISION;
 }
\ No newline at end of file
@@ -8,17 +8,17 @@
 class ProximitySensor : public Sensor
 {
     public:
-        ProximitySensor(double range, float rangeAngle, float placingAngle)
+        ProximitySensor(Scalar range, Scalar rangeAngle, Scalar placingAngle)
             : Sensor(Sensor::PROXIMITY, range, rangeAngle, placingAngle) {}
-        ProximitySensor(std::ifstream& file, bool readBinary) : Sensor(file, readBinary, Sensor::PROXIMITY) {}
+        ProximitySensor(std::istream& file) : Sensor(file, Sensor::PROXIMITY) {}
+        explicit ProximitySensor(FieldSource& source) : Sensor(source, Sensor::PROXIMITY) {}
         ProximitySensor(const ProximitySensor& other) : Sensor(other) {}
-        void updateState(const SimEntMap::const_iterator& firstEntity, 
-            const SimEntMap::const_iterator& lastEntity);
+        void updateState(const std::vector<SimEnt*>& entities);
 
     private:
-        double detectCircle(CircularEnt& entity, Point& sensor_beg, Point& sensor_end);
-        double detectLine(LinearEnt& entity, Point& sensor_beg, Point& sensor_end);
-        double detectRectange(RectangularEnt& entity, Point& sensor_beg, Point& sensor_end);
+        Scalar detectCircle(CircularEnt& entity, Point& sensor_beg, Point& sensor_end);
+        Scalar detectLine(LinearEnt& entity, Point& sensor_beg, Point& sensor_end);
+        Scalar detectRectange(RectangularEnt& entity, Point& sensor_beg, Point& sensor_end);
 };
 
 #endif
\ No newline at end of file
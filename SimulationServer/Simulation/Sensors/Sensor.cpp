@@ -1,7 +1,7 @@
 #include "Sensor.h"
 #include "../Math/MathLib.h"
 
-Sensor::Sensor(uint8_t type, double range, float rangeAngle, float placingAngle)
+Sensor::Sensor(uint8_t type, Scalar range, Scalar rangeAngle, Scalar placingAngle)
     : _range(range), _rangeAngle(rangeAngle), _placingAngle(placingAngle)
 {
     _type = type;
@@ -9,34 +9,31 @@ Sensor::Sensor(uint8_t type, double range, float rangeAngle, float placingAngle)
     _beams = 2 + (int) (6 * _rangeAngle / M_PI);
 }
 
-Sensor::Sensor(std::ifstream& file, bool readBinary, uint8_t type) : _type(type)
+Sensor::Sensor(std::istream& file, uint8_t type) : _type(type), _range(0), _rangeAngle(0),
+    _robot(NULL), _placingAngle(0), _state(0)
 {
-    if (readBinary)
-    {
-        file.read(reinterpret_cast<char*>(&_range), sizeof(_range));
-        file.read(reinterpret_cast<char*>(&_rangeAngle), sizeof(_rangeAngle));
-        file.read(reinterpret_cast<char*>(&_placingAngle), sizeof(_placingAngle));
-        file.read(reinterpret_cast<char*>(&_state), sizeof(_state));
-    }
-    else
-        file >> _range >> _rangeAngle >> _placingAngle >> _state;
+    readFields(*this, file, WORLD_FORMAT_VERSION);
+    _beams = 2 + (int) (6 * _rangeAngle / M_PI);
+}
 
+Sensor::Sensor(FieldSource& source, uint8_t type) : _type(type), _range(0), _rangeAngle(0), _robot(NULL),
+    _placingAngle(0), _state(0)
+{
+    visitFields(source);
     _beams = 2 + (int) (6 * _rangeAngle / M_PI);
 }
 
 void Sensor::serialize(Buffer& buffer) const
 {
-    buffer.pack(_type);
-    buffer.pack(_range);
-    buffer.pack(_rangeAngle);
-    buffer.pack(_placingAngle);
-    buffer.pack(_state);
+    // writers only read the fields
+    writeFields(const_cast<Sensor&>(*this), _type, buffer);
 }
-void Sensor::serialize(std::ofstream& file) const
+void Sensor::serialize(std::ostream& file) const
+{
+    writeFields(const_cast<Sensor&>(*this), _type, file);
+}
+
+void Sensor::serialize(WorldImageBuilder& image) const
 {
-    file.write(reinterpret_cast<const char*>(&_type), sizeof(_type));
-    file.write(reinterpret_cast<const char*>(&_range), sizeof(_range));
-    file.write(reinterpret_cast<const char*>(&_rangeAngle), sizeof(_rangeAngle));
-    file.write(reinterpret_cast<const char*>(&_placingAngle), sizeof(_placingAngle));
-    file.write(reinterpret_cast<const char*>(&_state), sizeof(_state));
+    image.addSensor(const_cast<Sensor&>(*this), _type);
 }
\ No newline at end of file
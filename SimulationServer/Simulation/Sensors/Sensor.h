@@ -12,23 +12,43 @@ class Sensor
         static const uint8_t PROXIMITY = 0;
         static const uint8_t COLOR = 1; // not implemented yet
 
-        Sensor(uint8_t type, double range, float rangeAngle, float placingAngle);
-        Sensor(std::ifstream& file, bool readBinary, uint8_t type);
+        Sensor(uint8_t type, Scalar range, Scalar rangeAngle, Scalar placingAngle);
+        Sensor(std::istream& file, uint8_t type);
+        Sensor(FieldSource& source, uint8_t type);
         void placeOnRobot(KheperaRobot* robot) { _robot = robot; }
-        virtual void updateState(const SimEntMap::const_iterator& firstEntity, 
-            const SimEntMap::const_iterator& lastEntity) = 0;
+        // ENTITIES have to contain at least all entities in range of sensor
+        virtual void updateState(const std::vector<SimEnt*>& entities) = 0;
+        Scalar getRange() const { return _range; }
         uint8_t getType() { return _type; }
         float getState() { return _state; }
 
         virtual void serialize(Buffer& buffer) const;
-        virtual void serialize(std::ofstream& file) const;
+        virtual void serialize(std::ostream& file) const;
+        virtual void serialize(WorldImageBuilder& image) const;
+
+        template <typename Visitor>
+        void visitFields(Visitor& visitor)
+        {
+            visitor.real64(_range);
+            visitor.angle(_rangeAngle);
+            visitor.angle(_placingAngle);
+            visitor.fraction(_state);
+        }
+        // number of beams is derived from the range angle
+        template <typename Visitor>
+        void visitState(Visitor& visitor)
+        {
+            visitor.real64(_rangeAngle);
+            visitor.real64(_placingAngle);
+            visitor.integer(_beams);
+        }
 
     protected:
         uint8_t _type;
-        double _range;
-        float _rangeAngle;
+        Scalar _range;
+        Scalar _rangeAngle;
         KheperaRobot* _robot;
-        float _placingAngle;
+        Scalar _placingAngle;
         float _state;
         int _beams;
 };
@@ -0,0 +1,142 @@
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#include "Checkpointer.h"
+#include "Compression.h"
+#include "../Math/Hash.h"
+
+Checkpointer::Checkpointer(const std::string& fileName, unsigned int interval) : _fileName(fileName),
+    _interval(interval > 0 ? interval : 1), _steps(0), _snapshot(NULL), _stopping(false), _writtenCount(0),
+    _droppedCount(0), _thread(&Checkpointer::run, this)
+{
+}
+
+Checkpointer::~Checkpointer()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _snapshotReady.notify_one();
+    _thread.join();
+    delete _snapshot;
+}
+
+void Checkpointer::stepFinished(const Simulation& simulation)
+{
+    if (++_steps % _interval == 0)
+        takeSnapshot(simulation);
+}
+
+void Checkpointer::takeSnapshot(const Simulation& simulation)
+{
+    Simulation* snapshot = simulation.createSnapshot();
+
+    // snapshot, that was not written yet, is not needed any more
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_snapshot != NULL)
+            _droppedCount++;
+        std::swap(_snapshot, snapshot);
+    }
+    _snapshotReady.notify_one();
+    delete snapshot;
+}
+
+void Checkpointer::run()
+{
+    while (true)
+    {
+        Simulation* snapshot;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            while (_snapshot == NULL && !_stopping)
+                _snapshotReady.wait(lock);
+            if (_snapshot == NULL)
+                return;
+            snapshot = _snapshot;
+            _snapshot = NULL;
+        }
+        std::ostringstream stream(std::ios::out | std::ios::binary);
+        snapshot->serialize(stream);
+        snapshot->serializeState(stream);
+        delete snapshot;
+        if (write(stream.str()))
+            _writtenCount++;
+    }
+}
+
+bool Checkpointer::write(const std::string& payload)
+{
+    std::string data;
+    compress(reinterpret_cast<const uint8_t*>(payload.data()), payload.size(), data);
+    uint32_t magic = CHECKPOINT_MAGIC;
+    uint16_t version = CHECKPOINT_VERSION;
+    uint64_t payloadLength = payload.size();
+    uint64_t dataLength = data.size();
+    uint64_t checksum = FNV_OFFSET_BASIS;
+    hashBytes(checksum, payload.data(), payload.size());
+
+    std::string temporaryName = _fileName + ".tmp";
+    {
+        std::ofstream file(temporaryName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(&magic), sizeof(magic));
+        file.write(reinterpret_cast<const char*>(&version), sizeof(version));
+        file.write(reinterpret_cast<const char*>(&payloadLength), sizeof(payloadLength));
+        file.write(reinterpret_cast<const char*>(&dataLength), sizeof(dataLength));
+        file.write(reinterpret_cast<const char*>(&checksum), sizeof(checksum));
+        file.write(data.data(), data.size());
+        if (!file.flush())
+            return false;
+    }
+    // previous checkpoint stays valid until the new one replaces it
+#ifdef _WIN32
+    std::remove(_fileName.c_str());
+#endif
+    return std::rename(temporaryName.c_str(), _fileName.c_str()) == 0;
+}
+
+bool Checkpointer::isCheckpoint(std::istream& file)
+{
+    std::streampos start = file.tellg();
+    uint32_t magic = 0;
+    file.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+    file.clear();
+    file.seekg(start);
+    return magic == CHECKPOINT_MAGIC;
+}
+
+bool Checkpointer::read(std::istream& file, std::string& payload, bool& hasState)
+{
+    uint32_t magic;
+    uint16_t version;
+    uint64_t payloadLength, dataLength, checksum;
+    file.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+    file.read(reinterpret_cast<char*>(&version), sizeof(version));
+    file.read(reinterpret_cast<char*>(&payloadLength), sizeof(payloadLength));
+    file.read(reinterpret_cast<char*>(&dataLength), sizeof(dataLength));
+    file.read(reinterpret_cast<char*>(&checksum), sizeof(checksum));
+    if (!file || magic != CHECKPOINT_MAGIC || version < 1 || version > CHECKPOINT_VERSION)
+        return false;
+    hasState = version >= 2;
+
+    // data cannot be longer than the rest of the file
+    std::streampos dataStart = file.tellg();
+    file.seekg(0, std::ios::end);
+    std::streamoff available = file.tellg() - dataStart;
+    file.seekg(dataStart);
+    if (dataStart < 0 || (uint64_t) available < dataLength)
+        return false;
+
+    std::string data;
+    data.resize((size_t) dataLength);
+    if (dataLength > 0 && !file.read(&data[0], data.size()))
+        return false;
+    if (!decompress(reinterpret_cast<const uint8_t*>(data.data()), data.size(), (size_t) payloadLength, payload))
+        return false;
+
+    uint64_t payloadChecksum = FNV_OFFSET_BASIS;
+    hashBytes(payloadChecksum, payload.data(), payload.size());
+    return payloadChecksum == checksum;
+}
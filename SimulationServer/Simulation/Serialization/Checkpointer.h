@@ -0,0 +1,69 @@
+#ifndef CHECKPOINTER_H
+#define CHECKPOINTER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <istream>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "../Simulation.h"
+
+/*
+    Checkpoint file format (host byte order):
+
+    +-------------------+-------------------+--------------------------------------------------------------+
+    |   MAGIC           |   VERSION         |   PAYLOAD_LENGTH                                             |
+    |   32 bits         |   16 bits         |   64 bits                                                    |
+    +-------------------+-------------------+--------------------------------------------------------------+
+    |   DATA_LENGTH     64 bits             |   CHECKSUM (FNV-1a of payload)   64 bits                     |
+    +---------------------------------------+--------------------------------------------------------------+
+    |   DATA - payload compressed as described in Compression.h                                            |
+    +------------------------------------------------------------------------------------------------------+
+
+    Payload is binary world file (WORLD_FORMAT_VERSION), followed by state of simulation since version 2
+    (see Simulation::serializeState) - simulation restored from it continues exactly as the saved one would.
+    Checkpoint is accepted everywhere, where binary world file is (e.g. server -in option).
+*/
+
+// writes checkpoints of simulation in background - simulation thread only copies the simulation,
+// serialization, compression and writing is done by thread of checkpointer
+class Checkpointer
+{
+    public:
+        // every INTERVAL steps; FILE_NAME is replaced only after the new checkpoint is completely written
+        Checkpointer(const std::string& fileName, unsigned int interval = DEFAULT_CHECKPOINT_INTERVAL);
+        ~Checkpointer(); // writes the last snapshot, if it is still waiting
+
+        // has to be called by simulation thread after every step, between steps
+        void stepFinished(const Simulation& simulation);
+        void takeSnapshot(const Simulation& simulation);
+
+        unsigned int getWrittenCount() const { return _writtenCount; }
+        // snapshots replaced by newer ones, before they were written (disk is slower than INTERVAL)
+        unsigned int getDroppedCount() const { return _droppedCount; }
+
+        static bool isCheckpoint(std::istream& file);
+        // PAYLOAD stored in checkpoint, false if checkpoint is damaged; HAS_STATE is not set for version 1,
+        // which has only the world file
+        static bool read(std::istream& file, std::string& payload, bool& hasState);
+
+    private:
+        void run();
+        bool write(const std::string& payload);
+
+        std::string                 _fileName;
+        unsigned int                _interval;
+        unsigned int                _steps;
+
+        std::mutex                  _mutex;
+        std::condition_variable     _snapshotReady;
+        Simulation*                 _snapshot; // waiting to be written, NULL if there is none
+        bool                        _stopping;
+        std::atomic<unsigned int>   _writtenCount;
+        std::atomic<unsigned int>   _droppedCount;
+        std::thread                 _thread; // started, when all other members are initialized
+};
+
+#endif
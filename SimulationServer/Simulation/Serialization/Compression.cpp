@@ -0,0 +1,108 @@
+#include "Compression.h"
+
+#include <cstring>
+#include <vector>
+
+#define HASH_BITS   15 // positions of 4-byte sequences are kept in table of 2^HASH_BITS entries
+
+void putVarint(std::string& output, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        output.push_back((char) ((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    output.push_back((char) value);
+}
+
+bool getVarint(const uint8_t*& data, const uint8_t* end, uint64_t& value)
+{
+    value = 0;
+    for (int shift = 0; data < end && shift < 64; shift += 7)
+    {
+        uint8_t byte = *data++;
+        value |= (uint64_t) (byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0)
+            return true;
+    }
+    return false;
+}
+
+static uint32_t hashSequence(const uint8_t* data)
+{
+    uint32_t sequence;
+    memcpy(&sequence, data, sizeof(sequence));
+    return (sequence * 2654435761u) >> (32 - HASH_BITS);
+}
+
+void compress(const uint8_t* data, size_t length, std::string& output)
+{
+    output.clear();
+    output.reserve(length / 2 + 16);
+    std::vector<size_t> lastPosition(1 << HASH_BITS, (size_t) -1);
+
+    size_t literalsBegin = 0;
+    size_t position = 0;
+    while (position + COMPRESSION_MIN_MATCH <= length)
+    {
+        uint32_t hash = hashSequence(data + position);
+        size_t candidate = lastPosition[hash];
+        lastPosition[hash] = position;
+        if (candidate == (size_t) -1 || position - candidate > COMPRESSION_MAX_OFFSET
+            || memcmp(data + candidate, data + position, COMPRESSION_MIN_MATCH) != 0)
+        {
+            position++;
+            continue;
+        }
+
+        size_t matchLength = COMPRESSION_MIN_MATCH;
+        while (position + matchLength < length && data[candidate + matchLength] == data[position + matchLength])
+            matchLength++;
+
+        putVarint(output, position - literalsBegin);
+        output.append(reinterpret_cast<const char*>(data + literalsBegin), position - literalsBegin);
+        putVarint(output, matchLength - COMPRESSION_MIN_MATCH);
+        size_t offset = position - candidate;
+        output.push_back((char) (offset & 0xFF));
+        output.push_back((char) (offset >> 8));
+
+        position += matchLength;
+        literalsBegin = position;
+    }
+
+    putVarint(output, length - literalsBegin);
+    output.append(reinterpret_cast<const char*>(data + literalsBegin), length - literalsBegin);
+}
+
+bool decompress(const uint8_t* data, size_t length, size_t originalLength, std::string& output)
+{
+    output.clear();
+    // damaged length must not make it allocate too much
+    if (originalLength / 256 <= length)
+        output.reserve(originalLength);
+    const uint8_t* end = data + length;
+    while (true)
+    {
+        uint64_t literals;
+        if (!getVarint(data, end, literals) || literals > (size_t) (end - data)
+            || literals > originalLength - output.size())
+            return false;
+        output.append(reinterpret_cast<const char*>(data), literals);
+        data += literals;
+        if (data == end)
+            return output.size() == originalLength;
+
+        uint64_t matchLength;
+        if (!getVarint(data, end, matchLength) || end - data < 2)
+            return false;
+        matchLength += COMPRESSION_MIN_MATCH;
+        size_t offset = data[0] | (size_t) data[1] << 8;
+        data += 2;
+        if (offset == 0 || offset > output.size() || matchLength > originalLength - output.size())
+            return false;
+        // byte by byte, as the match may overlap with its own output
+        size_t from = output.size() - offset;
+        for (size_t i = 0; i < matchLength; i++)
+            output.push_back(output[from + i]);
+    }
+}
@@ -0,0 +1,33 @@
+#ifndef COMPRESSION_H
+#define COMPRESSION_H
+
+#include <stdint.h>
+#include <cstddef>
+#include <string>
+
+/*
+    Simple LZ77 compression of snapshots (no external library is needed). Compressed data is a sequence of:
+
+        LITERAL_COUNT (varint), LITERALS, MATCH_LENGTH - MIN_MATCH (varint), MATCH_OFFSET (16 bits, little endian)
+
+    and ends right after literals of the last sequence. Varints have 7 bits in every byte, lowest bits first,
+    the highest bit set, if more bytes follow. Matches copy MATCH_LENGTH bytes starting MATCH_OFFSET bytes back
+    in output, they may overlap with the bytes being produced.
+*/
+
+#define COMPRESSION_MIN_MATCH   4
+#define COMPRESSION_MAX_OFFSET  0xFFFF
+
+void compress(const uint8_t* data, size_t length, std::string& output);
+// false, if DATA is not a valid result of compression of ORIGINAL_LENGTH bytes
+bool decompress(const uint8_t* data, size_t length, size_t originalLength, std::string& output);
+
+// varints as described above, also used by other compact formats
+void putVarint(std::string& output, uint64_t value);
+// false, if varint does not end before END; DATA is moved after it
+bool getVarint(const uint8_t*& data, const uint8_t* end, uint64_t& value);
+// signed values are zigzag encoded, so that small negative ones have short varints too
+inline uint64_t toZigzag(int64_t value) { return ((uint64_t) value << 1) ^ (uint64_t) (value >> 63); }
+inline int64_t fromZigzag(uint64_t value) { return (int64_t) (value >> 1) ^ -(int64_t) (value & 1); }
+
+#endif
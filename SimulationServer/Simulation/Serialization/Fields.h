@@ -0,0 +1,390 @@
+#ifndef FIELDS_H
+#define FIELDS_H
+
+#include <stdint.h>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+#ifdef _WIN32
+#include <Ws2tcpip.h>
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <netinet/in.h>
+#endif
+
+#include "../Buffer.h"
+#include "../Constants.h"
+#include "../Math/Point.h"
+
+/*
+    Every serialized class lists its fields once, in the order they are stored:
+
+        template <typename Visitor>
+        void visitFields(Visitor& visitor)
+
+    calling visitor.integer, visitor.id, visitor.real64, visitor.real32, visitor.angle, visitor.fraction and
+    visitor.point for them. Visitors below turn the list into binary file reader, file writer, network encoders and
+    exact copies in memory, FieldSource is the base of other readers (text parser, world image):
+    - integers are in network byte order on the wire and in host byte order in files,
+      doubles and floats are in host byte order in both
+    - angle (in radians) and fraction (float in [0, 1], sensor state) are stored as real32
+    - compact network encoding quantises lengths (real64), positions, angles and fractions
+    - IDs have 16 bits in protocol and file format version 1, 32 bits since version 2
+    - binary record is encoded into (or read from) memory at once, so file gets one write per record
+      (buffer records are encoded directly at its end)
+    Field lists of files and network match except for the rectangle, which is sent as its four corners
+    (see isWire).
+
+    State, that changes during simulation and is not stored in world file (or is stored as real32 there), is
+    listed the same way by visitState - checkpoints keep it in file records (see Simulation::serializeState).
+*/
+
+// records are short (the longest one - rectangle on the wire - has 74 bytes)
+#define MAX_RECORD_SIZE     256
+
+inline uint8_t toNetworkOrder(uint8_t value) { return value; }
+inline uint16_t toNetworkOrder(uint16_t value) { return htons(value); }
+inline uint32_t toNetworkOrder(uint32_t value) { return htonl(value); }
+inline int32_t toNetworkOrder(int32_t value) { return (int32_t) htonl((uint32_t) value); }
+
+// computes size of binary record
+class FieldSize
+{
+    public:
+        FieldSize(uint16_t version, bool wire) : _version(version), _wire(wire), _size(0) {}
+
+        bool isWire() const { return _wire; }
+        template <typename T>
+        void integer(T&) { _size += sizeof(T); }
+        void id(uint32_t&) { _size += _version < 2 ? sizeof(uint16_t) : sizeof(uint32_t); }
+        template <typename T>
+        void real64(T&) { _size += sizeof(double); }
+        template <typename T>
+        void real32(T&) { _size += sizeof(float); }
+        template <typename T>
+        void angle(T& member) { real32(member); }
+        template <typename T>
+        void fraction(T& member) { real32(member); }
+        void point(Point&) { _size += 2 * sizeof(double); }
+
+        int getSize() const { return _size; }
+
+    private:
+        uint16_t    _version;
+        bool        _wire;
+        int         _size;
+};
+
+// encodes fields into memory - network frame, if WIRE is set, file record otherwise
+class BinaryWriter
+{
+    public:
+        BinaryWriter(uint8_t* data, uint16_t version, bool wire) : _data(data), _version(version), _wire(wire) {}
+
+        bool isWire() const { return _wire; }
+        template <typename T>
+        void integer(T& member) { put(_wire ? toNetworkOrder(member) : member); }
+        void id(uint32_t& member)
+        {
+            if (_version < 2)
+            {
+                uint16_t id16 = static_cast<uint16_t>(member);
+                integer(id16);
+            }
+            else
+                integer(member);
+        }
+        template <typename T>
+        void real64(T& member) { put(static_cast<double>(member)); }
+        template <typename T>
+        void real32(T& member) { put(static_cast<float>(member)); }
+        template <typename T>
+        void angle(T& member) { real32(member); }
+        template <typename T>
+        void fraction(T& member) { real32(member); }
+        void point(Point& member)
+        {
+            put(static_cast<double>(member.getX()));
+            put(static_cast<double>(member.getY()));
+        }
+
+        uint8_t* getEnd() const { return _data; }
+
+    private:
+        template <typename T>
+        void put(T value)
+        {
+            memcpy(_data, &value, sizeof(value));
+            _data += sizeof(value);
+        }
+
+        uint8_t*    _data;
+        uint16_t    _version;
+        bool        _wire;
+};
+
+// encodes fields into compact network frame - integers and real32 as on the wire, 16-bit lengths and coordinates
+// in UNITs (clamped to 0 .. COMPACT_STEPS), 16-bit angles (2 pi / 65536) and 8-bit fractions (1 / 255)
+class CompactWriter
+{
+    public:
+        CompactWriter(uint8_t* data, double unit) : _data(data), _unit(unit) {}
+
+        bool isWire() const { return true; }
+        template <typename T>
+        void integer(T& member) { put(toNetworkOrder(member)); }
+        void id(uint32_t& member) { integer(member); }
+        template <typename T>
+        void real64(T& member) { put(toNetworkOrder(quantiseLength(member))); }
+        template <typename T>
+        void real32(T& member) { put(static_cast<float>(member)); }
+        template <typename T>
+        void angle(T& member) { put(toNetworkOrder(quantiseAngle(member))); }
+        template <typename T>
+        void fraction(T& member)
+        {
+            double level = member * 255 + 0.5;
+            put(static_cast<uint8_t>(level <= 0 ? 0 : level >= 255 ? 255 : level));
+        }
+        void point(Point& member)
+        {
+            put(toNetworkOrder(quantiseLength(member.getX())));
+            put(toNetworkOrder(quantiseLength(member.getY())));
+        }
+
+        uint8_t* getEnd() const { return _data; }
+
+    private:
+        uint16_t quantiseLength(double value) const
+        {
+            double steps = value / _unit + 0.5;
+            return static_cast<uint16_t>(steps <= 0 ? 0 : steps >= COMPACT_STEPS ? COMPACT_STEPS : steps);
+        }
+        uint16_t quantiseAngle(double angle) const
+        {
+            double turns = angle / 6.28318530717958647692; // 2 pi, MathLib cannot be included here
+            return static_cast<uint16_t>(static_cast<int64_t>(floor((turns - floor(turns)) * 65536 + 0.5)) & 0xFFFF);
+        }
+        template <typename T>
+        void put(T value)
+        {
+            memcpy(_data, &value, sizeof(value));
+            _data += sizeof(value);
+        }
+
+        uint8_t*    _data;
+        double      _unit;
+};
+
+// decodes fields of file record from memory
+class BinaryReader
+{
+    public:
+        BinaryReader(const uint8_t* data, uint16_t version) : _data(data), _version(version) {}
+
+        bool isWire() const { return false; }
+        template <typename T>
+        void integer(T& member) { get(member); }
+        void id(uint32_t& member)
+        {
+            if (_version < 2)
+            {
+                uint16_t id16;
+                get(id16);
+                member = id16;
+            }
+            else
+                get(member);
+        }
+        template <typename T>
+        void real64(T& member)
+        {
+            double value;
+            get(value);
+            member = value;
+        }
+        template <typename T>
+        void real32(T& member)
+        {
+            float value;
+            get(value);
+            member = value;
+        }
+        template <typename T>
+        void angle(T& member) { real32(member); }
+        template <typename T>
+        void fraction(T& member) { real32(member); }
+        void point(Point& member)
+        {
+            double x, y;
+            get(x);
+            get(y);
+            member.setCoords(x, y);
+        }
+
+    private:
+        template <typename T>
+        void get(T& value)
+        {
+            memcpy(&value, _data, sizeof(value));
+            _data += sizeof(value);
+        }
+
+        const uint8_t*  _data;
+        uint16_t        _version;
+};
+
+// copies fields in memory exactly as they are (every member in its own type), for copies of the world within
+// one process (see Simulation::copyFields)
+class CopyWriter
+{
+    public:
+        explicit CopyWriter(uint8_t* data) : _data(data) {}
+
+        bool isWire() const { return false; }
+        template <typename T>
+        void integer(T& member) { put(member); }
+        void id(uint32_t& member) { put(member); }
+        template <typename T>
+        void real64(T& member) { put(member); }
+        template <typename T>
+        void real32(T& member) { put(member); }
+        template <typename T>
+        void angle(T& member) { put(member); }
+        template <typename T>
+        void fraction(T& member) { put(member); }
+        void point(Point& member)
+        {
+            put(member.getX());
+            put(member.getY());
+        }
+
+        uint8_t* getEnd() const { return _data; }
+
+    private:
+        template <typename T>
+        void put(T value)
+        {
+            memcpy(_data, &value, sizeof(value));
+            _data += sizeof(value);
+        }
+
+        uint8_t*    _data;
+};
+
+// reads fields copied by CopyWriter
+class CopyReader
+{
+    public:
+        explicit CopyReader(const uint8_t* data) : _data(data) {}
+
+        bool isWire() const { return false; }
+        template <typename T>
+        void integer(T& member) { get(member); }
+        void id(uint32_t& member) { get(member); }
+        template <typename T>
+        void real64(T& member) { get(member); }
+        template <typename T>
+        void real32(T& member) { get(member); }
+        template <typename T>
+        void angle(T& member) { get(member); }
+        template <typename T>
+        void fraction(T& member) { get(member); }
+        void point(Point& member)
+        {
+            Scalar x, y;
+            get(x);
+            get(y);
+            member.setCoords(x, y);
+        }
+
+    private:
+        template <typename T>
+        void get(T& value)
+        {
+            memcpy(&value, _data, sizeof(value));
+            _data += sizeof(value);
+        }
+
+        const uint8_t*  _data;
+};
+
+// reader, that entities and sensors can be constructed from - every one of them has a constructor taking it
+class FieldSource
+{
+    public:
+        virtual ~FieldSource() {}
+
+        bool isWire() const { return false; }
+        template <typename T>
+        void integer(T& member) { member = (T) getInteger(sizeof(T) == 1 ? 0xFFu : sizeof(T) == 2 ? 0xFFFFu : 0xFFFFFFFFu); }
+        void id(uint32_t& member) { member = getId(); }
+        template <typename T>
+        void real64(T& member) { member = getReal64(); }
+        template <typename T>
+        void real32(T& member) { member = getReal32(); }
+        template <typename T>
+        void angle(T& member) { member = getReal32(); }
+        template <typename T>
+        void fraction(T& member) { member = getReal32(); }
+        void point(Point& member)
+        {
+            double x = getReal64();
+            member.setCoords(x, getReal64());
+        }
+
+    protected:
+        virtual uint32_t getInteger(uint32_t maxValue) = 0;
+        virtual uint32_t getId() { return getInteger(0xFFFFFFFFu); }
+        virtual double getReal64() = 0;
+        virtual float getReal32() = 0;
+};
+
+// reads fields of OBJECT from binary world file in FORMAT_VERSION
+template <typename T>
+bool readFields(T& object, std::istream& file, uint16_t formatVersion)
+{
+    FieldSize size(formatVersion, false);
+    object.visitFields(size);
+    uint8_t data[MAX_RECORD_SIZE];
+    if (size.getSize() > MAX_RECORD_SIZE || !file.read(reinterpret_cast<char*>(data), size.getSize()))
+        return false;
+
+    BinaryReader reader(data, formatVersion);
+    object.visitFields(reader);
+    return true;
+}
+
+// writes HEADER (shape or type ID) followed by fields of OBJECT, in WORLD_FORMAT_VERSION
+template <typename T>
+void writeFields(T& object, uint8_t header, std::ostream& file)
+{
+    uint8_t data[MAX_RECORD_SIZE];
+    BinaryWriter writer(data, WORLD_FORMAT_VERSION, false);
+    writer.integer(header);
+    object.visitFields(writer);
+    file.write(reinterpret_cast<const char*>(data), writer.getEnd() - data);
+}
+
+// appends HEADER (shape or type ID) followed by fields of OBJECT, in protocol version of BUFFER
+template <typename T>
+void writeFields(T& object, uint8_t header, Buffer& buffer)
+{
+    uint8_t* data = buffer.getTail(MAX_RECORD_SIZE);
+    if (buffer.isCompact())
+    {
+        CompactWriter writer(data, buffer.getCompactUnit());
+        writer.integer(header);
+        object.visitFields(writer);
+        buffer.advance(writer.getEnd() - data);
+        return;
+    }
+    BinaryWriter writer(data, buffer.getProtocolVersion(), true);
+    writer.integer(header);
+    object.visitFields(writer);
+    buffer.advance(writer.getEnd() - data);
+}
+
+#endif
@@ -0,0 +1,144 @@
+#include "TextParser.h"
+
+#include <cctype>
+#include <charconv>
+#include <sstream>
+
+#define MAX_QUOTED_TOKEN    20 // characters of wrong token quoted in error message
+
+static std::string formatMessage(const std::string& message, int line, int column)
+{
+    if (line == 0)
+        return message;
+    std::ostringstream text;
+    text << "line " << line << ", column " << column << ": " << message;
+    return text.str();
+}
+
+WorldFormatError::WorldFormatError(const std::string& message, int line, int column)
+    : std::runtime_error(formatMessage(message, line, column)), _line(line), _column(column)
+{
+}
+
+TextParser::TextParser(const std::string& text) : _position(text.data()), _end(text.data() + text.size()),
+    _lineStart(text.data()), _line(1), _token(text.data()), _tokenLine(1), _tokenLineStart(text.data())
+{
+}
+
+std::string TextParser::readAll(std::istream& stream)
+{
+    // one read of the rest of the stream, text mode may make it shorter (e.g. CRLF on Windows)
+    std::streampos start = stream.tellg();
+    stream.seekg(0, std::ios::end);
+    std::streamoff size = stream.tellg() - start;
+    stream.seekg(start);
+    if (start < 0 || size <= 0)
+    {
+        stream.clear();
+        std::ostringstream text;
+        text << stream.rdbuf();
+        return text.str();
+    }
+
+    std::string text((size_t) size, '\0');
+    stream.read(&text[0], size);
+    text.resize((size_t) stream.gcount());
+    stream.clear();
+    return text;
+}
+
+void TextParser::skipSpaces()
+{
+    while (_position < _end && isspace((unsigned char) *_position))
+    {
+        if (*_position == '\n')
+        {
+            _line++;
+            _lineStart = _position + 1;
+        }
+        _position++;
+    }
+    _token = _position;
+    _tokenLine = _line;
+    _tokenLineStart = _lineStart;
+}
+
+const char* TextParser::tokenEnd() const
+{
+    const char* end = _position;
+    while (end < _end && !isspace((unsigned char) *end))
+        end++;
+    return end;
+}
+
+void TextParser::fail(const std::string& message)
+{
+    throw WorldFormatError(message, _tokenLine, (int) (_token - _tokenLineStart) + 1);
+}
+
+bool TextParser::isKeywordNext()
+{
+    skipSpaces();
+    return _position < _end && isalpha((unsigned char) *_position);
+}
+
+std::string TextParser::readKeyword()
+{
+    skipSpaces();
+    const char* end = tokenEnd();
+    std::string keyword(_position, end);
+    _position = end;
+    return keyword;
+}
+
+void TextParser::expectEnd()
+{
+    skipSpaces();
+    if (_position < _end)
+        fail("unexpected data after the last entity");
+}
+
+template <typename T>
+T TextParser::readNumber(const char* expected)
+{
+    skipSpaces();
+    const char* end = tokenEnd();
+    if (_position == end)
+        fail(std::string("unexpected end of file, expected ") + expected);
+    // from_chars does not accept explicit plus sign, which stream extraction of old parser did
+    const char* start = _position;
+    if (*start == '+' && end - start > 1 && start[1] != '-')
+        start++;
+    T value = 0;
+    std::from_chars_result result = std::from_chars(start, end, value);
+    if (result.ec != std::errc() || result.ptr != end)
+    {
+        const char* quoteEnd = end - _position > MAX_QUOTED_TOKEN ? _position + MAX_QUOTED_TOKEN : end;
+        fail(std::string("expected ") + expected + ", found '" + std::string(_position, quoteEnd) + "'");
+    }
+    _position = end;
+    return value;
+}
+
+uint32_t TextParser::getInteger(uint32_t maxValue)
+{
+    uint32_t value = readNumber<uint32_t>("integer");
+    if (value > maxValue)
+    {
+        std::ostringstream message;
+        message << "integer " << value << " is out of range, maximum is " << maxValue;
+        fail(message.str());
+    }
+    return value;
+}
+
+double TextParser::getReal64()
+{
+    return readNumber<double>("number");
+}
+
+float TextParser::getReal32()
+{
+    // rounded the same way, as when the value is stored in binary file
+    return readNumber<float>("number");
+}
@@ -0,0 +1,64 @@
+#ifndef TEXT_PARSER_H
+#define TEXT_PARSER_H
+
+#include <stdint.h>
+#include <istream>
+#include <stdexcept>
+#include <string>
+
+#include "Fields.h"
+
+// malformed world file - LINE and COLUMN (both from 1) point to the token, that could not be read
+class WorldFormatError : public std::runtime_error
+{
+    public:
+        WorldFormatError(const std::string& message, int line = 0, int column = 0);
+
+        int getLine() const { return _line; }
+        int getColumn() const { return _column; }
+
+    private:
+        int     _line;
+        int     _column;
+};
+
+// parses text world file from memory, tokens are separated by whitespaces
+// every read, that fails, throws WorldFormatError
+class TextParser : public FieldSource
+{
+    public:
+        // TEXT has to outlive the parser
+        explicit TextParser(const std::string& text);
+
+        static std::string readAll(std::istream& stream);
+
+        bool isKeywordNext(); // next token starts with a letter
+        std::string readKeyword();
+        uint32_t readInteger(uint32_t maxValue = 0xFFFFFFFFu) { return getInteger(maxValue); }
+        double readReal() { return getReal64(); }
+        // fails, unless only whitespaces are left
+        void expectEnd();
+        // throws WorldFormatError pointing to the beginning of the last token
+        [[noreturn]] void fail(const std::string& message);
+
+    protected:
+        uint32_t getInteger(uint32_t maxValue);
+        double getReal64();
+        float getReal32();
+
+    private:
+        void skipSpaces();
+        const char* tokenEnd() const;
+        template <typename T>
+        T readNumber(const char* expected);
+
+        const char*     _position;
+        const char*     _end;
+        const char*     _lineStart;
+        int             _line;
+        const char*     _token; // beginning of the last token
+        int             _tokenLine;
+        const char*     _tokenLineStart;
+};
+
+#endif
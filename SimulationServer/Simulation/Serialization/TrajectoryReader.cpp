@@ -0,0 +1,251 @@
+#include <algorithm>
+#include <sstream>
+
+#include "TrajectoryReader.h"
+#include "Compression.h"
+#include "../Entities/KheperaRobot.h"
+
+static bool isEarlier(uint32_t tick, const TrajectoryKeyframe& keyframe)
+{
+    return tick < keyframe.tick;
+}
+
+TrajectoryReader::TrajectoryReader() : _positionStep(DEFAULT_POSITION_STEP), _angleStep(DEFAULT_ANGLE_STEP),
+    _stepCount(0), _recordsEnd(0), _position(0), _simulation(NULL), _tick(0), _time(0)
+{
+}
+
+TrajectoryReader::~TrajectoryReader()
+{
+    close();
+}
+
+bool TrajectoryReader::open(const std::string& fileName)
+{
+    close();
+    _file.open(fileName.c_str(), std::ios::in | std::ios::binary);
+    uint32_t magic = 0;
+    uint16_t version = 0;
+    uint32_t keyframeInterval;
+    if (!get(magic) || !get(version) || !get(_positionStep) || !get(_angleStep) || !get(keyframeInterval)
+        || magic != TRAJECTORY_MAGIC || version != TRAJECTORY_VERSION)
+    {
+        close();
+        return false;
+    }
+
+    _file.seekg(0, std::ios::end);
+    uint64_t fileLength = (uint64_t) _file.tellg();
+    if (!readIndex(fileLength))
+        rebuildIndex(fileLength);
+
+    _position = TRAJECTORY_HEADER_SIZE;
+    _file.clear();
+    _file.seekg(_position);
+    return true;
+}
+
+void TrajectoryReader::close()
+{
+    if (_file.is_open())
+        _file.close();
+    _file.clear();
+    delete _simulation;
+    _simulation = NULL;
+    _entities.clear();
+    _keyframes.clear();
+    _stepCount = 0;
+    _recordsEnd = 0;
+    _tick = 0;
+    _time = 0;
+}
+
+bool TrajectoryReader::readIndex(uint64_t fileLength)
+{
+    uint64_t indexOffset = 0;
+    uint32_t magic = 0;
+    uint32_t keyframeCount = 0;
+    if (fileLength < TRAJECTORY_HEADER_SIZE + TRAJECTORY_FOOTER_SIZE)
+        return false;
+    _file.seekg(fileLength - TRAJECTORY_FOOTER_SIZE);
+    if (!get(indexOffset) || !get(magic) || magic != TRAJECTORY_INDEX_MAGIC || indexOffset < TRAJECTORY_HEADER_SIZE
+        || indexOffset > fileLength - TRAJECTORY_FOOTER_SIZE)
+        return false;
+
+    _file.seekg(indexOffset);
+    if (!get(keyframeCount) || !get(_stepCount)
+        || indexOffset + 8 + (uint64_t) keyframeCount * 20 + TRAJECTORY_FOOTER_SIZE != fileLength)
+        return false;
+    _keyframes.resize(keyframeCount);
+    for (uint32_t i = 0; i < keyframeCount; i++)
+    {
+        if (!get(_keyframes[i].tick) || !get(_keyframes[i].time) || !get(_keyframes[i].offset))
+            return false;
+    }
+    _recordsEnd = indexOffset;
+    return true;
+}
+
+void TrajectoryReader::rebuildIndex(uint64_t fileLength)
+{
+    // records are skipped using their lengths, the last one may be incomplete
+    _file.clear();
+    _keyframes.clear();
+    _stepCount = 0;
+    uint64_t position = TRAJECTORY_HEADER_SIZE;
+    while (position + TRAJECTORY_RECORD_SIZE <= fileLength)
+    {
+        uint8_t type;
+        uint32_t tick, length;
+        double time;
+        _file.seekg(position);
+        if (!get(type) || !get(tick) || !get(time) || !get(length)
+            || position + TRAJECTORY_RECORD_SIZE + length > fileLength)
+            break;
+        if (type == TRAJECTORY_KEYFRAME)
+        {
+            TrajectoryKeyframe keyframe = { tick, time, position };
+            _keyframes.push_back(keyframe);
+        }
+        _stepCount = tick + 1;
+        position += TRAJECTORY_RECORD_SIZE + length;
+    }
+    _recordsEnd = position;
+}
+
+bool TrajectoryReader::seek(uint32_t tick)
+{
+    if (tick >= _stepCount || _keyframes.empty() || tick < _keyframes.front().tick)
+        return false;
+    std::vector<TrajectoryKeyframe>::const_iterator keyframe =
+        std::upper_bound(_keyframes.begin(), _keyframes.end(), tick, isEarlier) - 1;
+
+    // going forward within the same keyframe does not need to load it again
+    if (_simulation == NULL || _tick > tick || _tick < keyframe->tick)
+    {
+        _position = keyframe->offset;
+        _file.clear();
+        _file.seekg(_position);
+        delete _simulation;
+        _simulation = NULL;
+    }
+    while (_simulation == NULL || _tick < tick)
+    {
+        if (!next())
+            return false;
+    }
+    return true;
+}
+
+bool TrajectoryReader::next()
+{
+    uint8_t type;
+    uint32_t tick, length;
+    double time;
+    if (_position + TRAJECTORY_RECORD_SIZE > _recordsEnd || !get(type) || !get(tick) || !get(time) || !get(length)
+        || _position + TRAJECTORY_RECORD_SIZE + length > _recordsEnd)
+        return false;
+    _data.resize(length);
+    if (length > 0 && !_file.read(&_data[0], length))
+        return false;
+    _position += TRAJECTORY_RECORD_SIZE + length;
+
+    if (type == TRAJECTORY_KEYFRAME)
+    {
+        if (!loadKeyframe())
+            return false;
+    }
+    // delta has to follow the step it refers to
+    else if (type != TRAJECTORY_DELTA || _simulation == NULL || tick != _tick + 1 || !applyDelta())
+        return false;
+
+    _tick = tick;
+    _time = time;
+    _simulation->setTime(time);
+    return true;
+}
+
+bool TrajectoryReader::loadKeyframe()
+{
+    uint64_t worldLength;
+    if (_data.size() < sizeof(worldLength))
+        return false;
+    memcpy(&worldLength, _data.data(), sizeof(worldLength));
+    if (!decompress(reinterpret_cast<const uint8_t*>(_data.data()) + sizeof(worldLength),
+        _data.size() - sizeof(worldLength), (size_t) worldLength, _world))
+        return false;
+
+    Simulation* simulation;
+    try
+    {
+        std::istringstream stream(_world, std::ios::in | std::ios::binary);
+        simulation = new Simulation(stream, true);
+    }
+    catch (const WorldFormatError&)
+    {
+        return false;
+    }
+    delete _simulation;
+    _simulation = simulation;
+
+    // deltas are relative to poses in keyframe
+    const SimEntMap& entities = _simulation->getEntities();
+    _entities.clear();
+    for (SimEntMap::const_iterator it = entities.begin(); it != entities.end(); it++)
+    {
+        ReplayedEntity replayed;
+        replayed.entity = it->second;
+        replayed.robot = it->second->getShapeID() == SimEnt::KHEPERA_ROBOT
+            ? dynamic_cast<KheperaRobot*>(it->second) : NULL;
+        BoundingBox box = replayed.entity->getBoundingBox();
+        replayed.x = TrajectoryRecorder::quantise(box.minX, _positionStep);
+        replayed.y = TrajectoryRecorder::quantise(box.minY, _positionStep);
+        replayed.angle = replayed.robot != NULL
+            ? TrajectoryRecorder::quantise(replayed.robot->getDirectionAngle(), _angleStep) : 0;
+        _entities.push_back(replayed);
+    }
+    return true;
+}
+
+bool TrajectoryReader::applyDelta()
+{
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(_data.data());
+    const uint8_t* end = data + _data.size();
+    uint64_t count, gap;
+    if (!getVarint(data, end, count))
+        return false;
+
+    uint64_t next = 0;
+    for (uint64_t i = 0; i < count; i++)
+    {
+        if (!getVarint(data, end, gap) || gap >= _entities.size() - next || data == end)
+            return false;
+        ReplayedEntity& replayed = _entities[next + gap];
+        next += gap + 1;
+        uint8_t flags = *data++;
+
+        if (flags & TRAJECTORY_POSE_CHANGED)
+        {
+            uint64_t dx, dy, dangle;
+            if (!getVarint(data, end, dx) || !getVarint(data, end, dy) || !getVarint(data, end, dangle))
+                return false;
+            replayed.x += fromZigzag(dx);
+            replayed.y += fromZigzag(dy);
+            replayed.angle += fromZigzag(dangle);
+
+            BoundingBox box = replayed.entity->getBoundingBox();
+            replayed.entity->translate(replayed.x * _positionStep - box.minX, replayed.y * _positionStep - box.minY);
+            if (replayed.robot != NULL)
+                replayed.robot->setDirectionAngle(replayed.angle * _angleStep);
+        }
+        if (flags & TRAJECTORY_SENSORS_CHANGED)
+        {
+            int sensorCount = replayed.robot != NULL ? replayed.robot->getSensorCount() : 0;
+            if (end - data < sensorCount)
+                return false;
+            for (int s = 0; s < sensorCount; s++)
+                replayed.robot->setSensorState(s, *data++ / 255.0f);
+        }
+    }
+    return data == end;
+}
@@ -0,0 +1,68 @@
+#ifndef TRAJECTORY_READER_H
+#define TRAJECTORY_READER_H
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "TrajectoryRecorder.h"
+
+// streaming reader of trajectory files (see TrajectoryRecorder.h) - only index and the current record are kept
+// in memory, world of the current step is rebuilt from the last keyframe and deltas following it
+class TrajectoryReader
+{
+    public:
+        TrajectoryReader();
+        ~TrajectoryReader();
+
+        // reads header and index (or rebuilds it, if recording was not finished), false if it is not a trajectory
+        bool open(const std::string& fileName);
+        void close();
+
+        // world after step TICK - the closest keyframe before it is loaded and deltas up to TICK are applied
+        bool seek(uint32_t tick);
+        // moves to the following step, false at the end of trajectory or if the file is damaged
+        bool next();
+
+        // world of the current step, owned by reader and replaced by every keyframe; NULL before the first step
+        Simulation* getSimulation() { return _simulation; }
+        uint32_t getTick() const { return _tick; }
+        double getTime() const { return _time; }
+        uint32_t getStepCount() const { return _stepCount; }
+        const std::vector<TrajectoryKeyframe>& getKeyframes() const { return _keyframes; }
+
+    private:
+        struct ReplayedEntity
+        {
+            SimEnt*         entity;
+            KheperaRobot*   robot; // NULL for other entities
+            int64_t         x; // lower left corner of bounding box and heading, in steps
+            int64_t         y;
+            int64_t         angle;
+        };
+
+        TrajectoryReader(const TrajectoryReader& other);
+        bool readIndex(uint64_t fileLength);
+        void rebuildIndex(uint64_t fileLength);
+        bool loadKeyframe();
+        bool applyDelta();
+        template <typename T>
+        bool get(T& value) { return (bool) _file.read(reinterpret_cast<char*>(&value), sizeof(value)); }
+
+        std::ifstream                   _file;
+        double                          _positionStep;
+        double                          _angleStep;
+        std::vector<TrajectoryKeyframe> _keyframes;
+        uint32_t                        _stepCount;
+        uint64_t                        _recordsEnd; // offset, where index begins
+        uint64_t                        _position; // of the next record
+
+        Simulation*                     _simulation;
+        std::vector<ReplayedEntity>     _entities; // in order of IDs
+        uint32_t                        _tick;
+        double                          _time;
+        std::string                     _data; // of current record
+        std::string                     _world; // decompressed keyframe
+};
+
+#endif
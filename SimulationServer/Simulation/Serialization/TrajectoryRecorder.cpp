@@ -0,0 +1,224 @@
+#include <chrono>
+#include <sstream>
+
+#include "TrajectoryRecorder.h"
+#include "Compression.h"
+#include "../Entities/KheperaRobot.h"
+
+TrajectoryRecorder::TrajectoryRecorder(const std::string& fileName, unsigned int keyframeInterval,
+    double positionStep, double angleStep) : _keyframeInterval(keyframeInterval > 0 ? keyframeInterval : 1),
+    _positionStep(positionStep), _angleStep(angleStep), _tick(0), _lastKeyframe(0), _stallCount(0),
+    _file(fileName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc), _offset(0),
+    _queue(TRAJECTORY_QUEUE_CAPACITY), _stopping(false)
+{
+    uint32_t magic = TRAJECTORY_MAGIC;
+    uint16_t version = TRAJECTORY_VERSION;
+    uint32_t interval = _keyframeInterval;
+    put(magic);
+    put(version);
+    put(_positionStep);
+    put(_angleStep);
+    put(interval);
+    _offset = TRAJECTORY_HEADER_SIZE;
+    _isOpen = (bool) _file;
+    _thread = std::thread(&TrajectoryRecorder::run, this);
+}
+
+TrajectoryRecorder::~TrajectoryRecorder()
+{
+    _stopping.store(true, std::memory_order_release);
+    _thread.join();
+}
+
+uint8_t TrajectoryRecorder::quantiseState(float state)
+{
+    float level = state * 255 + 0.5f;
+    return level <= 0 ? 0 : level >= 255 ? 255 : (uint8_t) level;
+}
+
+void TrajectoryRecorder::stepFinished(const Simulation& simulation)
+{
+    if (!_isOpen)
+        return;
+
+    uint32_t tick = _tick;
+    _record.tick = tick;
+    _record.time = simulation.getTime();
+    if (tick == 0 || tick - _lastKeyframe >= _keyframeInterval || !hasSameEntities(simulation))
+        encodeKeyframe(simulation);
+    else
+        encodeDelta();
+
+    // simulation waits only if writer is behind by the whole queue
+    if (!_queue.push(_record))
+    {
+        _stallCount++;
+        while (!_queue.push(_record))
+            std::this_thread::yield();
+    }
+    _tick = tick + 1;
+}
+
+bool TrajectoryRecorder::hasSameEntities(const Simulation& simulation) const
+{
+    const SimEntMap& entities = simulation.getEntities();
+    if (entities.size() != _entities.size())
+        return false;
+    std::vector<RecordedEntity>::const_iterator recorded = _entities.begin();
+    for (SimEntMap::const_iterator it = entities.begin(); it != entities.end(); it++, recorded++)
+    {
+        if (it->second != recorded->entity
+            || (recorded->robot != NULL && recorded->robot->getSensorCount() != recorded->sensorCount))
+            return false;
+    }
+    return true;
+}
+
+void TrajectoryRecorder::encodeKeyframe(const Simulation& simulation)
+{
+    // world is compressed by writer
+    std::ostringstream stream(std::ios::out | std::ios::binary);
+    simulation.serialize(stream);
+    _record.type = TRAJECTORY_KEYFRAME;
+    _record.data = stream.str();
+    _lastKeyframe = _record.tick;
+
+    // following deltas are relative to poses in keyframe
+    const SimEntMap& entities = simulation.getEntities();
+    _entities.clear();
+    _sensorStates.clear();
+    for (SimEntMap::const_iterator it = entities.begin(); it != entities.end(); it++)
+    {
+        RecordedEntity recorded;
+        recorded.entity = it->second;
+        recorded.robot = it->second->getShapeID() == SimEnt::KHEPERA_ROBOT
+            ? dynamic_cast<KheperaRobot*>(it->second) : NULL;
+        BoundingBox box = recorded.entity->getBoundingBox();
+        recorded.x = quantise(box.minX, _positionStep);
+        recorded.y = quantise(box.minY, _positionStep);
+        recorded.angle = recorded.robot != NULL ? quantise(recorded.robot->getDirectionAngle(), _angleStep) : 0;
+        recorded.firstSensor = _sensorStates.size();
+        recorded.sensorCount = recorded.robot != NULL ? recorded.robot->getSensorCount() : 0;
+        for (int i = 0; i < recorded.sensorCount; i++)
+        {
+            float state = 0;
+            recorded.robot->getSensorState(i, state);
+            _sensorStates.push_back(quantiseState(state));
+        }
+        _entities.push_back(recorded);
+    }
+}
+
+void TrajectoryRecorder::encodeDelta()
+{
+    _changes.clear();
+    uint64_t count = 0;
+    size_t next = 0; // index following the last changed entity
+    for (size_t i = 0; i < _entities.size(); i++)
+    {
+        RecordedEntity& recorded = _entities[i];
+        // static entities never move on their own, but they can be pushed
+        BoundingBox box = recorded.entity->getBoundingBox();
+        int64_t x = quantise(box.minX, _positionStep);
+        int64_t y = quantise(box.minY, _positionStep);
+        int64_t angle = recorded.robot != NULL ? quantise(recorded.robot->getDirectionAngle(), _angleStep) : 0;
+        uint8_t flags = 0;
+        if (x != recorded.x || y != recorded.y || angle != recorded.angle)
+            flags |= TRAJECTORY_POSE_CHANGED;
+
+        uint8_t* states = recorded.sensorCount > 0 ? &_sensorStates[recorded.firstSensor] : NULL;
+        for (int s = 0; s < recorded.sensorCount; s++)
+        {
+            float state = 0;
+            recorded.robot->getSensorState(s, state);
+            uint8_t level = quantiseState(state);
+            if (level != states[s])
+            {
+                flags |= TRAJECTORY_SENSORS_CHANGED;
+                states[s] = level;
+            }
+        }
+        if (flags == 0)
+            continue;
+
+        putVarint(_changes, i - next);
+        _changes.push_back((char) flags);
+        if (flags & TRAJECTORY_POSE_CHANGED)
+        {
+            putVarint(_changes, toZigzag(x - recorded.x));
+            putVarint(_changes, toZigzag(y - recorded.y));
+            putVarint(_changes, toZigzag(angle - recorded.angle));
+            recorded.x = x;
+            recorded.y = y;
+            recorded.angle = angle;
+        }
+        if (flags & TRAJECTORY_SENSORS_CHANGED)
+            _changes.append(reinterpret_cast<const char*>(states), recorded.sensorCount);
+        next = i + 1;
+        count++;
+    }
+
+    _record.type = TRAJECTORY_DELTA;
+    _record.data.clear();
+    putVarint(_record.data, count);
+    _record.data.append(_changes);
+}
+
+void TrajectoryRecorder::run()
+{
+    Record record;
+    while (true)
+    {
+        // steps pushed before stopping was set are all visible, once it is seen
+        bool stopping = _stopping.load(std::memory_order_acquire);
+        if (_queue.pop(record))
+            write(record);
+        else if (stopping)
+            break;
+        else
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    uint64_t indexOffset = _offset;
+    uint32_t keyframeCount = (uint32_t) _keyframes.size();
+    uint32_t stepCount = _tick;
+    uint32_t magic = TRAJECTORY_INDEX_MAGIC;
+    put(keyframeCount);
+    put(stepCount);
+    for (std::vector<TrajectoryKeyframe>::const_iterator it = _keyframes.begin(); it != _keyframes.end(); it++)
+    {
+        put(it->tick);
+        put(it->time);
+        put(it->offset);
+    }
+    put(indexOffset);
+    put(magic);
+    _file.close();
+}
+
+void TrajectoryRecorder::write(Record& record)
+{
+    const std::string* data = &record.data;
+    uint64_t worldLength = record.data.size();
+    if (record.type == TRAJECTORY_KEYFRAME)
+    {
+        TrajectoryKeyframe keyframe = { record.tick, record.time, _offset };
+        _keyframes.push_back(keyframe);
+        compress(reinterpret_cast<const uint8_t*>(record.data.data()), record.data.size(), _compressed);
+        data = &_compressed;
+    }
+
+    uint32_t length = (uint32_t) data->size() + (record.type == TRAJECTORY_KEYFRAME ? sizeof(worldLength) : 0);
+    put(record.type);
+    put(record.tick);
+    put(record.time);
+    put(length);
+    if (record.type == TRAJECTORY_KEYFRAME)
+        put(worldLength);
+    _file.write(data->data(), data->size());
+    _offset += TRAJECTORY_RECORD_SIZE + length;
+
+    // steps up to the keyframe survive a killed server (the index is written only on regular stop)
+    if (record.type == TRAJECTORY_KEYFRAME)
+        _file.flush();
+}
@@ -0,0 +1,148 @@
+#ifndef TRAJECTORY_RECORDER_H
+#define TRAJECTORY_RECORDER_H
+
+#include <atomic>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../Parallel/SpscQueue.h"
+#include "../Simulation.h"
+
+/*
+    Trajectory file format (host byte order) - record of every step of simulation:
+
+    +-------------------+-------------------+------------------------------+------------------------------+
+    |   MAGIC           |   VERSION         |   POSITION_STEP              |   ANGLE_STEP                 |
+    |   32 bits         |   16 bits         |   64 bits (double)           |   64 bits (double)           |
+    +-------------------+-------------------+------------------------------+------------------------------+
+    |   KEYFRAME_INTERVAL  32 bits          |   RECORDS - one for every step, see below                     |
+    +---------------------------------------+---------------------------------------------------------------+
+    |   INDEX - written, when recording is finished                                                        |
+    +------------------------------------------------------------------------------------------------------+
+
+    Record:
+
+    +-------------------+-------------------+------------------------------+-------------------+----------+
+    |   TYPE            |   TICK            |   TIME                       |   LENGTH          |   DATA   |
+    |   8 bits          |   32 bits         |   64 bits (double)           |   32 bits         |          |
+    +-------------------+-------------------+------------------------------+-------------------+----------+
+
+    KEYFRAME data - WORLD_LENGTH (64 bits) and binary world file compressed as described in Compression.h
+    DELTA data - varint COUNT of changed entities, then for every one of them:
+        INDEX_GAP   varint - index of entity (in order of IDs) minus index of previous changed entity + 1
+        FLAGS       8 bits - TRAJECTORY_POSE_CHANGED, TRAJECTORY_SENSORS_CHANGED
+        DX, DY      zigzag varints - change of lower left corner of bounding box, in POSITION_STEPs
+        DANGLE      zigzag varint - change of heading of robot (0 for others), in ANGLE_STEPs
+        SENSORS     8 bits for every sensor of robot (state * 255), only with TRAJECTORY_SENSORS_CHANGED
+
+    Quantised values are differences from the previous step, but they sum up to the exact difference from
+    the last keyframe - errors do not accumulate. Keyframe is written every KEYFRAME_INTERVAL steps and
+    whenever the set of entities changes, so every delta refers to the entities of the last keyframe.
+
+    Index:
+
+    +-------------------+-------------------+-------------------------------------------------------------+
+    |   KEYFRAME_COUNT  |   STEP_COUNT      |   KEYFRAME_COUNT x (TICK 32 bits, TIME 64 bits,              |
+    |   32 bits         |   32 bits         |                     OFFSET of record 64 bits)               |
+    +-------------------+-------------------+-------------------------------------------------------------+
+    |   INDEX_OFFSET    64 bits             |   INDEX_MAGIC  32 bits                                       |
+    +---------------------------------------+-------------------------------------------------------------+
+
+    If recording was not finished (e.g. server was killed), reader rebuilds index from record headers.
+*/
+
+enum TrajectoryRecordType
+{
+    TRAJECTORY_KEYFRAME,
+    TRAJECTORY_DELTA
+};
+
+#define TRAJECTORY_POSE_CHANGED     1
+#define TRAJECTORY_SENSORS_CHANGED  2
+#define TRAJECTORY_HEADER_SIZE      (4 + 2 + 8 + 8 + 4)
+#define TRAJECTORY_RECORD_SIZE      (1 + 4 + 8 + 4) // without data
+#define TRAJECTORY_FOOTER_SIZE      (8 + 4)
+
+struct TrajectoryKeyframe
+{
+    uint32_t    tick;
+    double      time;
+    uint64_t    offset; // of its record
+};
+
+// writes trajectory of simulation - the simulation thread only encodes steps, writing and compression of
+// keyframes is done by thread of recorder; steps are passed to it through lock-free queue
+class TrajectoryRecorder
+{
+    public:
+        TrajectoryRecorder(const std::string& fileName, unsigned int keyframeInterval = DEFAULT_KEYFRAME_INTERVAL,
+            double positionStep = DEFAULT_POSITION_STEP, double angleStep = DEFAULT_ANGLE_STEP);
+        ~TrajectoryRecorder(); // writes all waiting steps and index
+
+        bool isOpen() const { return _isOpen; }
+        // has to be called by simulation thread after every step, between steps
+        void stepFinished(const Simulation& simulation);
+
+        uint32_t getStepCount() const { return _tick; }
+        // steps, in which simulation had to wait for writer, because the queue was full
+        unsigned int getStallCount() const { return _stallCount; }
+
+        static int64_t quantise(double value, double step) { return (int64_t) floor(value / step + 0.5); }
+        static uint8_t quantiseState(float state);
+
+    private:
+        struct RecordedEntity
+        {
+            SimEnt*         entity;
+            KheperaRobot*   robot; // NULL for other entities
+            int64_t         x; // last written pose, in steps
+            int64_t         y;
+            int64_t         angle;
+            size_t          firstSensor; // in _sensorStates
+            int             sensorCount;
+        };
+
+        struct Record
+        {
+            uint8_t         type;
+            uint32_t        tick;
+            double          time;
+            std::string     data;
+        };
+
+        TrajectoryRecorder(const TrajectoryRecorder& other);
+        bool hasSameEntities(const Simulation& simulation) const;
+        void encodeKeyframe(const Simulation& simulation);
+        void encodeDelta();
+        void run();
+        void write(Record& record);
+        template <typename T>
+        void put(const T& value) { _file.write(reinterpret_cast<const char*>(&value), sizeof(value)); }
+
+        // used by simulation thread only
+        unsigned int                _keyframeInterval;
+        double                      _positionStep;
+        double                      _angleStep;
+        std::vector<RecordedEntity> _entities; // in order of IDs
+        std::vector<uint8_t>        _sensorStates; // last written
+        std::string                 _changes; // entries of delta being encoded
+        Record                      _record; // being encoded, keeps capacity of strings from the queue
+        std::atomic<uint32_t>       _tick;
+        uint32_t                    _lastKeyframe;
+        std::atomic<unsigned int>   _stallCount;
+
+        // used by writer thread only
+        std::ofstream               _file;
+        bool                        _isOpen;
+        uint64_t                    _offset;
+        std::vector<TrajectoryKeyframe>  _keyframes;
+        std::string                 _compressed;
+
+        SpscQueue<Record>           _queue;
+        std::atomic<bool>           _stopping;
+        std::thread                 _thread; // started, when all other members are initialized
+};
+
+#endif
@@ -0,0 +1,226 @@
+#include "WorldImage.h"
+#include "TextParser.h"
+#include "../Math/Hash.h"
+
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static size_t alignOffset(size_t offset)
+{
+    return (offset + WORLD_IMAGE_ALIGNMENT - 1) / WORLD_IMAGE_ALIGNMENT * WORLD_IMAGE_ALIGNMENT;
+}
+
+WorldImage::WorldImage() : _data(NULL), _size(0)
+#ifdef _WIN32
+    , _file(INVALID_HANDLE_VALUE), _mapping(NULL)
+#endif
+{
+}
+
+WorldImage::~WorldImage()
+{
+    close();
+}
+
+bool WorldImage::open(const char* fileName)
+{
+    close();
+#ifdef _WIN32
+    _file = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (_file == INVALID_HANDLE_VALUE)
+        return false;
+    LARGE_INTEGER size;
+    GetFileSizeEx(_file, &size);
+    _size = (size_t) size.QuadPart;
+    _mapping = _size >= sizeof(WorldImageHeader) ? CreateFileMappingA(_file, NULL, PAGE_READONLY, 0, 0, NULL) : NULL;
+    if (_mapping != NULL)
+        _data = static_cast<const uint8_t*>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0));
+#else
+    int file = ::open(fileName, O_RDONLY);
+    if (file < 0)
+        return false;
+    struct stat status;
+    if (fstat(file, &status) == 0 && (size_t) status.st_size >= sizeof(WorldImageHeader))
+    {
+        _size = status.st_size;
+        void* data = mmap(NULL, _size, PROT_READ, MAP_SHARED, file, 0);
+        _data = data != MAP_FAILED ? static_cast<const uint8_t*>(data) : NULL;
+    }
+    ::close(file); // mapping stays valid
+#endif
+    if (_data == NULL)
+    {
+        close();
+        return false;
+    }
+
+    // only header is read, columns are paged in when they are used
+    const WorldImageHeader& header = getHeader();
+    bool valid = header.magic == WORLD_IMAGE_MAGIC && header.version == WORLD_IMAGE_VERSION
+        && header.headerSize == sizeof(WorldImageHeader) && header.byteOrder == IMAGE_BYTE_ORDER;
+    for (int section = 0; valid && section < IMAGE_SECTION_COUNT; section++)
+    {
+        uint64_t offset = header.sectionOffsets[section];
+        uint64_t length = (uint64_t) getElementSize(section)
+            * getElementCount(section, header.entityCount, header.sensorCount);
+        valid = offset % WORLD_IMAGE_ALIGNMENT == 0 && offset >= sizeof(WorldImageHeader) && offset <= _size
+            && length <= _size - offset;
+    }
+    if (!valid)
+        close();
+    return valid;
+}
+
+void WorldImage::close()
+{
+#ifdef _WIN32
+    if (_data != NULL)
+        UnmapViewOfFile(_data);
+    if (_mapping != NULL)
+        CloseHandle(_mapping);
+    if (_file != INVALID_HANDLE_VALUE)
+        CloseHandle(_file);
+    _mapping = NULL;
+    _file = INVALID_HANDLE_VALUE;
+#else
+    if (_data != NULL)
+        munmap(const_cast<uint8_t*>(_data), _size);
+#endif
+    _data = NULL;
+    _size = 0;
+}
+
+bool WorldImage::verifyChecksum() const
+{
+    return isOpen() && getChecksum(_data + sizeof(WorldImageHeader), _size - sizeof(WorldImageHeader))
+        == getHeader().checksum;
+}
+
+uint64_t WorldImage::getChecksum(const uint8_t* data, size_t length)
+{
+    uint64_t hash = FNV_OFFSET_BASIS;
+    hashBytes(hash, data, length);
+    return hash;
+}
+
+size_t WorldImage::getElementSize(int section)
+{
+    if (section == IMAGE_SHAPES || section == IMAGE_SENSOR_TYPES)
+        return sizeof(uint8_t);
+    if (section == IMAGE_IDS || section == IMAGE_SENSOR_BEGIN || section < IMAGE_REALS)
+        return sizeof(uint32_t);
+    return sizeof(double);
+}
+
+size_t WorldImage::getElementCount(int section, uint32_t entityCount, uint32_t sensorCount)
+{
+    if (section == IMAGE_SENSOR_BEGIN)
+        return (size_t) entityCount + 1;
+    if (section >= IMAGE_SENSOR_TYPES)
+        return sensorCount;
+    return entityCount;
+}
+
+uint32_t ImageRow::getInteger(uint32_t maxValue)
+{
+    // checksum does not prove, that the image was built from a valid world
+    uint32_t value = _image.getSection<uint32_t>(IMAGE_INTEGERS + _integers++)[_row];
+    if (value > maxValue)
+    {
+        std::ostringstream message;
+        message << "integer " << value << " in row " << _row << " of world image is out of range, maximum is "
+            << maxValue;
+        throw WorldFormatError(message.str());
+    }
+    return value;
+}
+
+ImageRowWriter::ImageRowWriter(WorldImageBuilder& builder, bool sensor) : _builder(builder),
+    _firstInteger(IMAGE_INTEGERS), _integerColumns(sensor ? 0 : IMAGE_INTEGER_COLUMNS),
+    _firstReal(sensor ? IMAGE_SENSOR_REALS : IMAGE_REALS),
+    _realColumns(sensor ? IMAGE_SENSOR_REAL_COLUMNS : IMAGE_REAL_COLUMNS), _integers(0), _reals(0)
+{
+}
+
+void ImageRowWriter::id(uint32_t& member)
+{
+    _builder.append(IMAGE_IDS, member);
+}
+
+void ImageRowWriter::putInteger(uint32_t value)
+{
+    if (_integers < _integerColumns)
+        _builder.append(_firstInteger + _integers, value);
+    _integers++;
+}
+
+void ImageRowWriter::putReal(double value)
+{
+    if (_reals < _realColumns)
+        _builder.append(_firstReal + _reals, value);
+    _reals++;
+}
+
+bool ImageRowWriter::finish()
+{
+    bool fits = _integers <= _integerColumns && _reals <= _realColumns;
+    while (_integers < _integerColumns)
+        putInteger(0);
+    while (_reals < _realColumns)
+        putReal(0);
+    return fits;
+}
+
+WorldImageBuilder::WorldImageBuilder()
+{
+    memset(&_header, 0, sizeof(_header));
+    _header.magic = WORLD_IMAGE_MAGIC;
+    _header.version = WORLD_IMAGE_VERSION;
+    _header.headerSize = sizeof(WorldImageHeader);
+    _header.byteOrder = IMAGE_BYTE_ORDER;
+}
+
+void WorldImageBuilder::setWorld(uint32_t worldWidth, uint32_t worldHeight, double time, bool hasBounds)
+{
+    _header.worldWidth = worldWidth;
+    _header.worldHeight = worldHeight;
+    _header.hasBounds = hasBounds;
+    _header.time = time;
+}
+
+bool WorldImageBuilder::write(const char* fileName)
+{
+    // whole image is composed in memory, so that checksum can be computed before it is written
+    std::vector<uint8_t> image(alignOffset(sizeof(WorldImageHeader)), 0);
+    for (int section = 0; section < IMAGE_SECTION_COUNT; section++)
+    {
+        std::vector<uint8_t> column(_sections[section]);
+        if (section == IMAGE_SENSOR_BEGIN)
+        {
+            const uint8_t* end = reinterpret_cast<const uint8_t*>(&_header.sensorCount);
+            column.insert(column.end(), end, end + sizeof(_header.sensorCount));
+        }
+        _header.sectionOffsets[section] = image.size();
+        image.insert(image.end(), column.begin(), column.end());
+        image.resize(alignOffset(image.size()), 0);
+    }
+    _header.checksum = WorldImage::getChecksum(&image[sizeof(WorldImageHeader)],
+        image.size() - sizeof(WorldImageHeader));
+    memcpy(&image[0], &_header, sizeof(_header));
+
+    std::ofstream file(fileName, std::ios::out | std::ios::binary);
+    file.write(reinterpret_cast<const char*>(&image[0]), image.size());
+    return file.good();
+}
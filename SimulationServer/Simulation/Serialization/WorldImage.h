@@ -0,0 +1,225 @@
+#ifndef WORLD_IMAGE_H
+#define WORLD_IMAGE_H
+
+#include <stdint.h>
+#include <cstddef>
+#include <vector>
+
+#include "../Constants.h"
+#include "Fields.h"
+
+/*
+    World image is binary world file, which is memory-mapped while a simulation is created from it - opening it
+    only checks the header, entities are then constructed from columns read straight from the mapping. Simulation
+    does not keep the image, its entities live in its own arena as if they were read from binary world file.
+    Images are created by WorldConverter tool (or saveWorldImage) from text and binary world files.
+
+    Image consists of header followed by columns, each of them aligned to WORLD_IMAGE_ALIGNMENT bytes:
+
+    +--------------------------------------------------------------------------------------------------+
+    |   HEADER (WorldImageHeader) - sizes of world, counts, checksum and offsets of all columns        |
+    +--------------------------------------------------------------------------------------------------+
+    |   SHAPES          8 bits x entities            |   IDS            32 bits x entities           |
+    +-------------------------------------------------+------------------------------------------------+
+    |   INTEGERS        4 columns, 32 bits x entities  - integer fields of entity, in order of visitFields|
+    +--------------------------------------------------------------------------------------------------+
+    |   REALS           5 columns, 64 bits x entities  - real fields and points, in order of visitFields |
+    +--------------------------------------------------------------------------------------------------+
+    |   SENSOR_BEGIN    32 bits x (entities + 1)       - sensors of entity I are SENSOR_BEGIN[I] ..      |
+    |                                                    SENSOR_BEGIN[I + 1] - 1                        |
+    +--------------------------------------------------------------------------------------------------+
+    |   SENSOR_TYPES    8 bits x sensors               |   SENSOR_REALS   4 columns, 64 bits x sensors  |
+    +--------------------------------------------------------------------------------------------------+
+
+    Unused columns of entity (e.g. 4th and 5th real of circle) are zero. Everything is in host byte order,
+    BYTE_ORDER in header is used to refuse images created on machines with other one. World bounds are not stored,
+    they are recreated according to HAS_BOUNDS.
+*/
+
+enum WorldImageSection
+{
+    IMAGE_SHAPES,
+    IMAGE_IDS,
+    IMAGE_INTEGERS,
+    IMAGE_REALS = IMAGE_INTEGERS + 4,
+    IMAGE_SENSOR_BEGIN = IMAGE_REALS + 5,
+    IMAGE_SENSOR_TYPES,
+    IMAGE_SENSOR_REALS,
+    IMAGE_SECTION_COUNT = IMAGE_SENSOR_REALS + 4
+};
+
+#define IMAGE_INTEGER_COLUMNS       (IMAGE_REALS - IMAGE_INTEGERS)
+#define IMAGE_REAL_COLUMNS          (IMAGE_SENSOR_BEGIN - IMAGE_REALS)
+#define IMAGE_SENSOR_REAL_COLUMNS   (IMAGE_SECTION_COUNT - IMAGE_SENSOR_REALS)
+#define IMAGE_BYTE_ORDER            0x01020304u
+
+struct WorldImageHeader
+{
+    uint32_t    magic;      // WORLD_IMAGE_MAGIC
+    uint16_t    version;    // WORLD_IMAGE_VERSION
+    uint16_t    headerSize;
+    uint32_t    byteOrder;  // IMAGE_BYTE_ORDER
+    uint32_t    worldWidth;
+    uint32_t    worldHeight;
+    uint32_t    entityCount;
+    uint32_t    sensorCount;
+    uint8_t     hasBounds;
+    uint8_t     reserved[3];
+    double      time;
+    uint64_t    checksum;   // FNV-1a of everything after header
+    uint64_t    sectionOffsets[IMAGE_SECTION_COUNT]; // from the beginning of image
+};
+
+// read-only view of world image file
+class WorldImage
+{
+    public:
+        WorldImage();
+        ~WorldImage();
+
+        // maps image and checks its header, false if it is not a valid image of this version
+        bool open(const char* fileName);
+        void close();
+        // reads whole image, so it is not done by open
+        bool verifyChecksum() const;
+
+        bool isOpen() const { return _data != NULL; }
+        const WorldImageHeader& getHeader() const { return *reinterpret_cast<const WorldImageHeader*>(_data); }
+        uint32_t getEntityCount() const { return getHeader().entityCount; }
+        uint32_t getSensorCount() const { return getHeader().sensorCount; }
+        template <typename T>
+        const T* getSection(int section) const
+        {
+            return reinterpret_cast<const T*>(_data + getHeader().sectionOffsets[section]);
+        }
+
+        static uint64_t getChecksum(const uint8_t* data, size_t length);
+        // size of element of SECTION in bytes
+        static size_t getElementSize(int section);
+        // number of elements of SECTION in image with given counts
+        static size_t getElementCount(int section, uint32_t entityCount, uint32_t sensorCount);
+
+    private:
+        // no cloning - declared only
+        WorldImage(const WorldImage& other);
+
+        const uint8_t*  _data;
+        size_t          _size;
+#ifdef _WIN32
+        void*           _file;
+        void*           _mapping;
+#endif
+};
+
+class WorldImageBuilder;
+
+// stores fields of one entity or sensor into columns of image being built
+class ImageRowWriter
+{
+    public:
+        ImageRowWriter(WorldImageBuilder& builder, bool sensor);
+
+        bool isWire() const { return false; }
+        template <typename T>
+        void integer(T& member) { putInteger((uint32_t) member); }
+        void id(uint32_t& member);
+        template <typename T>
+        void real64(T& member) { putReal(member); }
+        template <typename T>
+        void real32(T& member) { putReal(member); }
+        template <typename T>
+        void angle(T& member) { putReal(member); }
+        template <typename T>
+        void fraction(T& member) { putReal(member); }
+        template <typename T>
+        void point(T& member)
+        {
+            putReal(member.getX());
+            putReal(member.getY());
+        }
+
+        // fills unused columns of the row, false if the row did not fit into columns
+        bool finish();
+
+    private:
+        void putInteger(uint32_t value);
+        void putReal(double value);
+
+        WorldImageBuilder&  _builder;
+        int                 _firstInteger;
+        int                 _integerColumns;
+        int                 _firstReal;
+        int                 _realColumns;
+        int                 _integers;
+        int                 _reals;
+};
+
+// reads fields of one entity or sensor from columns of mapped image
+class ImageRow : public FieldSource
+{
+    public:
+        ImageRow(const WorldImage& image, uint32_t row, bool sensor)
+            : _image(image), _row(row), _firstReal(sensor ? IMAGE_SENSOR_REALS : IMAGE_REALS), _integers(0), _reals(0) {}
+
+    protected:
+        uint32_t getInteger(uint32_t maxValue); // throws WorldFormatError, if the value does not fit MAX_VALUE
+        uint32_t getId() { return _image.getSection<uint32_t>(IMAGE_IDS)[_row]; }
+        double getReal64() { return getReal(); }
+        float getReal32() { return (float) getReal(); }
+
+    private:
+        double getReal() { return _image.getSection<double>(_firstReal + _reals++)[_row]; }
+
+        const WorldImage&   _image;
+        uint32_t            _row;
+        int                 _firstReal;
+        int                 _integers;
+        int                 _reals;
+};
+
+// collects columns of image in memory and writes them to file
+class WorldImageBuilder
+{
+    friend class ImageRowWriter;
+
+    public:
+        WorldImageBuilder();
+
+        void setWorld(uint32_t worldWidth, uint32_t worldHeight, double time, bool hasBounds);
+
+        // sensors belong to the last added entity
+        template <typename T>
+        bool addEntity(T& entity, uint8_t shapeID)
+        {
+            _sections[IMAGE_SHAPES].push_back(shapeID);
+            append(IMAGE_SENSOR_BEGIN, _header.sensorCount);
+            _header.entityCount++;
+            ImageRowWriter writer(*this, false);
+            entity.visitFields(writer);
+            return writer.finish();
+        }
+        template <typename T>
+        bool addSensor(T& sensor, uint8_t type)
+        {
+            _sections[IMAGE_SENSOR_TYPES].push_back(type);
+            _header.sensorCount++;
+            ImageRowWriter writer(*this, true);
+            sensor.visitFields(writer);
+            return writer.finish();
+        }
+
+        bool write(const char* fileName);
+
+    private:
+        template <typename T>
+        void append(int section, T value)
+        {
+            const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+            _sections[section].insert(_sections[section].end(), bytes, bytes + sizeof(value));
+        }
+
+        WorldImageHeader        _header;
+        std::vector<uint8_t>    _sections[IMAGE_SECTION_COUNT];
+};
+
+#endif
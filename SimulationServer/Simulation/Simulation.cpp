@@ -4,80 +4,229 @@
 #include "Entities/KheperaRobot.h"
 #include "Entities/LinearEnt.h"
 #include "Sensors/ProximitySensor.h"
+#include "Math/Hash.h"
+#include "Serialization/Checkpointer.h"
 
+#include <atomic>
 #include <iterator>
 
+// versions of entities sets are unique among all simulations
+static std::atomic<uint64_t> lastEntitiesVersion(0);
+
+static uint64_t newEntitiesVersion()
+{
+    return ++lastEntitiesVersion;
+}
+
 Simulation::Simulation(unsigned int worldWidth, unsigned int worldHeight, bool addBounds,
 	double simulationStep , int simulationDelay) :
-	_worldWidth(worldWidth), _worldHeight(worldHeight), _simulationStep(simulationStep),
-	_simulationDelay(simulationDelay), _isRunning(false)
+	_distances(DistanceMap::key_compare(), DistanceMap::allocator_type(&_arena)),
+	_entities(SimEntMap::key_compare(), SimEntMap::allocator_type(&_arena)),
+	_contacts(ContactList::allocator_type(&_arena)), _lastSerial(0), _entitiesVersion(newEntitiesVersion()),
+	_worldWidth(worldWidth), _worldHeight(worldHeight), _time(0), _simulationStep(simulationStep),
+	_simulationDelay(simulationDelay), _orderChanged(true), _threadCount(1), _threadPool(NULL),
+	_random(DEFAULT_RANDOM_SEED), _cloneCount(0), _isRunning(false)
 {
+    _grid.reset(_worldWidth, _worldHeight, DEFAULT_GRID_CELL_SIZE);
     _hasBounds = addBounds;
     if (_hasBounds)
         this->addBounds();
 }
 
-Simulation::Simulation(std::ifstream& file, bool readBinary, double simulationStep, int simulationDelay)
-    : _simulationStep(simulationStep), _simulationDelay(simulationDelay), _isRunning(false)
+Simulation::Simulation(std::istream& file, bool readBinary, double simulationStep, int simulationDelay)
+    : _distances(DistanceMap::key_compare(), DistanceMap::allocator_type(&_arena)),
+    _entities(SimEntMap::key_compare(), SimEntMap::allocator_type(&_arena)),
+    _contacts(ContactList::allocator_type(&_arena)), _lastSerial(0), _entitiesVersion(newEntitiesVersion()), _simulationStep(simulationStep), _simulationDelay(simulationDelay),
+    _orderChanged(true), _threadCount(1), _threadPool(NULL), _random(DEFAULT_RANDOM_SEED), _cloneCount(0), _isRunning(false)
 {
-	uint16_t numberOfEntities;
+    if (!readBinary)
+    {
+        // text file is parsed from memory
+        std::string text = TextParser::readAll(file);
+        TextParser parser(text);
+        readText(parser);
+        return;
+    }
+    if (Checkpointer::isCheckpoint(file))
+    {
+        std::string data;
+        bool hasState;
+        if (!Checkpointer::read(file, data, hasState))
+            throw WorldFormatError("checkpoint is damaged");
+        std::istringstream stream(data);
+        readBinaryWorld(stream);
+        if (hasState)
+            readState(stream);
+        return;
+    }
+    readBinaryWorld(file);
+}
 
-    if (readBinary)
+void Simulation::readBinaryWorld(std::istream& file)
+{
+	uint32_t numberOfEntities;
+    uint16_t formatVersion = readHeader(file);
+
+    file.read(reinterpret_cast<char*>(&_time), sizeof(_time));
+    file.read(reinterpret_cast<char*>(&_hasBounds), sizeof(_hasBounds));
+    if (formatVersion < 2)
     {
-        file.read(reinterpret_cast<char*>(&_worldWidth), sizeof(_worldWidth));
-        file.read(reinterpret_cast<char*>(&_worldHeight), sizeof(_worldHeight));
-        file.read(reinterpret_cast<char*>(&_time), sizeof(_time));
-        file.read(reinterpret_cast<char*>(&_hasBounds), sizeof(_hasBounds));
-        file.read(reinterpret_cast<char*>(&numberOfEntities), sizeof(numberOfEntities));
+        uint16_t numberOfEntities16;
+        file.read(reinterpret_cast<char*>(&numberOfEntities16), sizeof(numberOfEntities16));
+        numberOfEntities = numberOfEntities16;
     }
     else
-        file >> _worldWidth >> _worldHeight >> _time >>  _hasBounds >> numberOfEntities;
+        file.read(reinterpret_cast<char*>(&numberOfEntities), sizeof(numberOfEntities));
+    _grid.reset(_worldWidth, _worldHeight, DEFAULT_GRID_CELL_SIZE);
 
     if (_hasBounds)
         this->addBounds();
 
-	for (int i = 0; i < numberOfEntities; i++)
+	for (uint32_t i = 0; i < numberOfEntities && file; i++)
 	{
-        SimEnt* newEntity = readEntity(file, readBinary);
-        if (newEntity != NULL)
+        SimEnt* newEntity = readEntity(file, formatVersion);
+        // world bounds saved in version 1 used lower reserved IDs
+        if (formatVersion >= 2 || newEntity->getID() < RESERVED_ID_LEVEL_V1)
+            addEntity(newEntity);
+        if (newEntity->getShapeID() == SimEnt::KHEPERA_ROBOT)
         {
+            uint16_t numberOfSensors;
+            file.read(reinterpret_cast<char*>(&numberOfSensors), sizeof(numberOfSensors));
+            for (uint16_t i = 0; i < numberOfSensors && file; i++)
+                addSensor(readSensor(file), newEntity->getID());
+        }
+	}
+    if (!file)
+        throw WorldFormatError("binary world file is truncated");
+}
+
+void Simulation::readText(TextParser& parser)
+{
+    uint16_t formatVersion = 1;
+    if (parser.isKeywordNext())
+    {
+        if (parser.readKeyword() != "WORLD")
+            parser.fail("expected WORLD keyword or world width");
+        formatVersion = (uint16_t) parser.readInteger(WORLD_FORMAT_VERSION);
+        if (formatVersion < 1)
+            parser.fail("unsupported version of world file");
+    }
+    _worldWidth = parser.readInteger();
+    _worldHeight = parser.readInteger();
+    _time = parser.readReal();
+    _hasBounds = parser.readInteger(1) != 0;
+    uint32_t numberOfEntities = parser.readInteger(formatVersion < 2 ? 0xFFFFu : 0xFFFFFFFFu);
+    _grid.reset(_worldWidth, _worldHeight, DEFAULT_GRID_CELL_SIZE);
+
+    if (_hasBounds)
+        this->addBounds();
+
+    for (uint32_t i = 0; i < numberOfEntities; i++)
+    {
+        SimEnt* newEntity = createEntity((uint8_t) parser.readInteger(0xFF), parser);
+        if (newEntity == NULL)
+            parser.fail("unknown shape ID");
+        if (formatVersion >= 2 || newEntity->getID() < RESERVED_ID_LEVEL_V1)
             addEntity(newEntity);
-            if (newEntity->getShapeID() == SimEnt::KHEPERA_ROBOT)
+        if (newEntity->getShapeID() == SimEnt::KHEPERA_ROBOT)
+        {
+            uint16_t numberOfSensors = (uint16_t) parser.readInteger(0xFFFF);
+            for (uint16_t i = 0; i < numberOfSensors; i++)
             {
-                uint16_t numberOfSensors;
-                if (readBinary)
-                    file.read(reinterpret_cast<char*>(&numberOfSensors), sizeof(numberOfSensors));
-                else
-                    file >> numberOfSensors;
-                for (uint16_t i = 0; i < numberOfSensors; i++)
-                {
-                    Sensor* sensor = readSensor(file, readBinary);
-                    if (sensor != NULL)
-                        addSensor(sensor, newEntity->getID());
-                    else
-                        ;// handle exception
-                }
+                Sensor* sensor = createSensor((uint8_t) parser.readInteger(0xFF), parser);
+                if (sensor == NULL)
+                    parser.fail("unknown sensor type");
+                addSensor(sensor, newEntity->getID());
             }
         }
-        else
-            ;// handle exception
-	}
+    }
+    parser.expectEnd();
+}
 
+Simulation::Simulation(const WorldImage& image, double simulationStep, int simulationDelay)
+    : _distances(DistanceMap::key_compare(), DistanceMap::allocator_type(&_arena)),
+    _entities(SimEntMap::key_compare(), SimEntMap::allocator_type(&_arena)),
+    _contacts(ContactList::allocator_type(&_arena)), _lastSerial(0), _entitiesVersion(newEntitiesVersion()), _simulationStep(simulationStep), _simulationDelay(simulationDelay),
+    _orderChanged(true), _threadCount(1), _threadPool(NULL), _random(DEFAULT_RANDOM_SEED), _cloneCount(0), _isRunning(false)
+{
+    const WorldImageHeader& header = image.getHeader();
+    _worldWidth = header.worldWidth;
+    _worldHeight = header.worldHeight;
+    _time = header.time;
+    _hasBounds = header.hasBounds != 0;
+    _grid.reset(_worldWidth, _worldHeight, DEFAULT_GRID_CELL_SIZE);
+
+    if (_hasBounds)
+        this->addBounds();
+
+    // entities are created straight from columns of the mapping, nothing is parsed
+    const uint8_t* shapes = image.getSection<uint8_t>(IMAGE_SHAPES);
+    const uint32_t* sensorBegin = image.getSection<uint32_t>(IMAGE_SENSOR_BEGIN);
+    const uint8_t* sensorTypes = image.getSection<uint8_t>(IMAGE_SENSOR_TYPES);
+    for (uint32_t i = 0; i < header.entityCount; i++)
+    {
+        ImageRow row(image, i, false);
+        SimEnt* newEntity = createEntity(shapes[i], row);
+        if (newEntity == NULL)
+            continue;
+        addEntity(newEntity);
+
+        for (uint32_t j = sensorBegin[i]; j < sensorBegin[i + 1] && j < header.sensorCount; j++)
+        {
+            ImageRow sensorRow(image, j, true);
+            Sensor* sensor = createSensor(sensorTypes[j], sensorRow);
+            if (sensor != NULL)
+                addSensor(sensor, newEntity->getID());
+        }
+    }
+}
+
+// reads world size from binary file and returns version of the file format
+uint16_t Simulation::readHeader(std::istream& file)
+{
+    uint16_t formatVersion = 1;
+    uint32_t magic;
+    file.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+    if (magic == WORLD_FILE_MAGIC)
+    {
+        file.read(reinterpret_cast<char*>(&formatVersion), sizeof(formatVersion));
+        file.read(reinterpret_cast<char*>(&_worldWidth), sizeof(_worldWidth));
+    }
+    else
+        _worldWidth = magic; // version 1 starts with width
+    file.read(reinterpret_cast<char*>(&_worldHeight), sizeof(_worldHeight));
+    if (formatVersion < 1 || formatVersion > WORLD_FORMAT_VERSION)
+        throw WorldFormatError("unsupported version of binary world file");
+    return formatVersion;
 }
 
 void Simulation::addBounds()
 {
-    LinearEnt* bottom_line = new LinearEnt(RESERVED_ID_LEVEL + 1, 0, 0, _worldWidth, 0);
-    LinearEnt* top_line = new LinearEnt(RESERVED_ID_LEVEL + 2, 0, _worldHeight, _worldWidth, _worldHeight);
-    LinearEnt* left_line = new LinearEnt(RESERVED_ID_LEVEL + 3, 0, 0, 0, _worldHeight);
-    LinearEnt* right_line = new LinearEnt(RESERVED_ID_LEVEL + 4, _worldWidth, 0, _worldWidth, _worldHeight);
+    LinearEnt* bottom_line = create<LinearEnt>(RESERVED_ID_LEVEL + 1, 0, 0, _worldWidth, 0);
+    LinearEnt* top_line = create<LinearEnt>(RESERVED_ID_LEVEL + 2, 0, _worldHeight, _worldWidth, _worldHeight);
+    LinearEnt* left_line = create<LinearEnt>(RESERVED_ID_LEVEL + 3, 0, 0, 0, _worldHeight);
+    LinearEnt* right_line = create<LinearEnt>(RESERVED_ID_LEVEL + 4, _worldWidth, 0, _worldWidth, _worldHeight);
     addEntityInternal(bottom_line);
     addEntityInternal(top_line);
     addEntityInternal(left_line);
     addEntityInternal(right_line);
 }
 
-Simulation::Simulation(const Simulation& other)
+Simulation::Simulation(const Simulation& other) : Simulation(other, false)
+{
+}
+
+Simulation* Simulation::createSnapshot() const
+{
+    return new Simulation(*this, true);
+}
+
+Simulation::Simulation(const Simulation& other, bool exact)
+    : _distances(DistanceMap::key_compare(), DistanceMap::allocator_type(&_arena)),
+    _entities(SimEntMap::key_compare(), SimEntMap::allocator_type(&_arena)),
+    _contacts(ContactList::allocator_type(&_arena)), _lastSerial(0), _entitiesVersion(newEntitiesVersion()), _orderChanged(true),
+    _threadCount(other._threadCount), _threadPool(NULL),
+    _random(exact ? other._random : other._random.split(++other._cloneCount)), _cloneCount(exact ? other._cloneCount : 0)
 {
     _worldWidth = other._worldWidth;
     _worldHeight = other._worldHeight;
@@ -86,6 +235,8 @@ Simulation::Simulation(const Simulation& other)
     _simulationDelay = other._simulationDelay;
     _hasBounds = other._hasBounds;
     _isRunning = other._isRunning;
+    _accumulatorsConfig = other._accumulatorsConfig;
+    _grid.reset(_worldWidth, _worldHeight, other._grid.getCellSize());
 
     for (SimEntMap::const_iterator it = other._entities.begin(); it != other._entities.end(); it++)
     {
@@ -93,16 +244,16 @@ Simulation::Simulation(const Simulation& other)
         switch (it->second->getShapeID())
         {
             case SimEnt::RECTANGLE:
-                entity = new RectangularEnt(*dynamic_cast<RectangularEnt*>(it->second));
+                entity = create<RectangularEnt>(*dynamic_cast<RectangularEnt*>(it->second));
                 break;
             case SimEnt::CIRCLE:
-                entity = new CircularEnt(*dynamic_cast<CircularEnt*>(it->second));
+                entity = create<CircularEnt>(*dynamic_cast<CircularEnt*>(it->second));
                 break;
             case SimEnt::KHEPERA_ROBOT:
-                entity = new KheperaRobot(*dynamic_cast<KheperaRobot*>(it->second));
+                entity = create<KheperaRobot>(*dynamic_cast<KheperaRobot*>(it->second), &_arena);
                 break;
             case SimEnt::LINE:
-                entity = new LinearEnt(*dynamic_cast<LinearEnt*>(it->second));
+                entity = create<LinearEnt>(*dynamic_cast<LinearEnt*>(it->second));
                 break;
             default:
                 entity = NULL;
@@ -113,87 +264,196 @@ Simulation::Simulation(const Simulation& other)
     }
 }
 
-SimEnt* Simulation::readEntity(std::ifstream& file, bool readBinary)
+SimEnt* Simulation::readEntity(std::istream& file, uint16_t formatVersion)
 {
-    uint8_t shapeID;
-    if (readBinary)
-        file.read(reinterpret_cast<char*>(&shapeID), sizeof(shapeID));
-    else
-    {
-        uint16_t shapeID16;
-        file >> shapeID16;
-        shapeID = (uint8_t) shapeID16;
-    }
+    uint8_t shapeID = 0;
+    file.read(reinterpret_cast<char*>(&shapeID), sizeof(shapeID));
     SimEnt* newEntity;
 
     switch (shapeID)
     {
         case SimEnt::CIRCLE:
-            newEntity = new CircularEnt(file, readBinary);
+            newEntity = create<CircularEnt>(file, formatVersion);
             break;
         case SimEnt::RECTANGLE:
-            newEntity = new RectangularEnt(file, readBinary);
+            newEntity = create<RectangularEnt>(file, formatVersion);
             break;
         case SimEnt::KHEPERA_ROBOT:
-            newEntity = new KheperaRobot(file, readBinary);
+            newEntity = create<KheperaRobot>(file, formatVersion, &_arena);
             break;
         case SimEnt::LINE:
-            newEntity = new LinearEnt(file, readBinary);
+            newEntity = create<LinearEnt>(file, formatVersion);
             break;
         default:
-            newEntity = NULL; /* TODO: Exception handling */
-            break;
+            throw WorldFormatError(file ? "unknown shape ID in binary world file" : "binary world file is truncated");
     }
 
     return newEntity;
 }
 
-Sensor* Simulation::readSensor(std::ifstream& file, bool readBinary)
+Sensor* Simulation::readSensor(std::istream& file)
+{
+    uint8_t type = 0;
+    file.read(reinterpret_cast<char*>(&type), sizeof(type));
+    if (type != Sensor::PROXIMITY)
+        throw WorldFormatError(file ? "unknown sensor type in binary world file" : "binary world file is truncated");
+    return create<ProximitySensor>(file);
+}
+
+// NULL for unknown SHAPE_ID
+SimEnt* Simulation::createEntity(uint8_t shapeID, FieldSource& source)
+{
+    switch (shapeID)
+    {
+        case SimEnt::CIRCLE:
+            return create<CircularEnt>(source);
+        case SimEnt::RECTANGLE:
+            return create<RectangularEnt>(source);
+        case SimEnt::KHEPERA_ROBOT:
+            return create<KheperaRobot>(source, &_arena);
+        case SimEnt::LINE:
+            return create<LinearEnt>(source);
+        default:
+            return NULL;
+    }
+}
+
+// NULL for unknown TYPE
+Sensor* Simulation::createSensor(uint8_t type, FieldSource& source)
+{
+    if (type == Sensor::PROXIMITY)
+        return create<ProximitySensor>(source);
+    return NULL;
+}
+
+Simulation::~Simulation()
+{
+	_isRunning = false; // to stop _simulationThreadHandle
+    delete _threadPool;
+
+    // entities, their sensors and both maps are released all at once, together with _arena
+}
+
+void Simulation::addEntity(SimEnt* newEntity)
 {
-    uint8_t type;
-    if (readBinary)
-        file.read(reinterpret_cast<char*>(&type), sizeof(type));
+    if (newEntity->getID() < RESERVED_ID_LEVEL)
+        addEntityInternal(newEntity);
+}
+
+void Simulation::addEntityInternal(SimEnt* newEntity)
+{
+    SimEntMap::iterator it = _entities.find(newEntity->getID());
+    if (it != _entities.end())
+        removeEntityInternal(it);
+
+    uint32_t slot;
+    if (_freeSlots.empty())
+    {
+        slot = _slots.size();
+        _slots.push_back(newEntity);
+    }
     else
     {
-        uint16_t type16;
-        file >> type16;
-        type = (uint8_t) type16;
+        slot = _freeSlots.back();
+        _freeSlots.pop_back();
+        _slots[slot] = newEntity;
     }
-    Sensor* newSensor;
 
-    switch (type)
+    newEntity->setSlot(slot);
+    newEntity->setSerial(++_lastSerial);
+    _entitiesVersion = newEntitiesVersion();
+    _entities[newEntity->getID()] = newEntity;
+    _grid.insert(newEntity);
+    _orderChanged = true;
+}
+
+void Simulation::removeEntityInternal(SimEntMap::iterator entity)
+{
+    // cached distances are left behind - serials tell that they belong to removed entity
+    SimEnt* removed = entity->second;
+    _grid.remove(removed);
+    _slots[removed->getSlot()] = NULL;
+    _freeSlots.push_back(removed->getSlot());
+    _entities.erase(entity);
+    _entitiesVersion = newEntitiesVersion();
+    _orderChanged = true;
+    destroyEntity(removed);
+}
+
+void Simulation::destroyEntity(SimEnt* entity)
+{
+    switch (entity->getShapeID())
     {
-        case Sensor::PROXIMITY:
-            newSensor = new ProximitySensor(file, readBinary);
+        case SimEnt::RECTANGLE:
+            _arena.destroy(static_cast<RectangularEnt*>(entity));
             break;
-        default:
-            newSensor = NULL;
+        case SimEnt::CIRCLE:
+            _arena.destroy(static_cast<CircularEnt*>(entity));
+            break;
+        case SimEnt::KHEPERA_ROBOT:
+            _arena.destroy(static_cast<KheperaRobot*>(entity));
+            break;
+        case SimEnt::LINE:
+            _arena.destroy(static_cast<LinearEnt*>(entity));
             break;
     }
-    return newSensor;
 }
 
-Simulation::~Simulation()
+bool Simulation::spawnEntity(SimEnt* newEntity)
 {
-	_isRunning = false; // to stop _simulationThreadHandle
+    if (newEntity->getID() >= RESERVED_ID_LEVEL || _entities.find(newEntity->getID()) != _entities.end())
+        return false;
+    addEntityInternal(newEntity);
 
-    for (SimEntMap::iterator it = _entities.begin(); it != _entities.end(); it++)
-        delete it->second;
+    // pairs with other entities are not checked before they become neighbours
+    _neighbours.clear();
+    _grid.query(newEntity->getBoundingBox(), _neighbours);
+    for (std::vector<SimEnt*>::const_iterator it = _neighbours.begin(); it != _neighbours.end(); it++)
+    {
+        Point proj;
+        if (*it != newEntity)
+            setCachedDistance(*newEntity, **it, -newEntity->collisionLength(**it, proj));
+    }
+    return true;
 }
 
-void Simulation::addEntity(SimEnt* newEntity)
+bool Simulation::despawnEntity(uint32_t id)
 {
-    addEntityInternal(newEntity, RESERVED_ID_LEVEL);
+    SimEntMap::iterator it = _entities.find(id);
+    if (id >= RESERVED_ID_LEVEL || it == _entities.end())
+        return false;
+
+    removeEntityInternal(it);
+    return true;
 }
 
-void Simulation::addEntityInternal(SimEnt* newEntity, int idLimit)
+double Simulation::getCachedDistance(SimEnt& fst, SimEnt& snd) const
 {
-    int new_id = newEntity->getID();
-    if (new_id < idLimit)
-        _entities[newEntity->getID()] = newEntity;
+    DistanceMap::const_iterator it = _distances.find(getDistanceKey(fst.getSlot(), snd.getSlot()));
+    if (it == _distances.end())
+        return 0;
+
+    const CachedDistance& entry = it->second;
+    bool fstIsLower = fst.getSlot() < snd.getSlot();
+    if (entry.fstSerial != (fstIsLower ? fst.getSerial() : snd.getSerial()) ||
+        entry.sndSerial != (fstIsLower ? snd.getSerial() : fst.getSerial()))
+        return 0; // left by removed entity
+
+    // gap could not shrink more than both entities travelled
+    return entry.distance - (fst.getOdometer() + snd.getOdometer() - entry.odometers);
+}
+
+void Simulation::setCachedDistance(SimEnt& fst, SimEnt& snd, double distance)
+{
+    CachedDistance& entry = _distances[getDistanceKey(fst.getSlot(), snd.getSlot())];
+    bool fstIsLower = fst.getSlot() < snd.getSlot();
+    entry.distance = distance;
+    entry.odometers = fst.getOdometer() + snd.getOdometer();
+    entry.fstSerial = fstIsLower ? fst.getSerial() : snd.getSerial();
+    entry.sndSerial = fstIsLower ? snd.getSerial() : fst.getSerial();
 }
 
-bool Simulation::addSensor(Sensor* sensor, uint16_t id)
+bool Simulation::addSensor(Sensor* sensor, uint32_t id)
 {
     SimEnt* entity = getEntity(id);
     if (entity && entity->getShapeID() == SimEnt::KHEPERA_ROBOT)
@@ -208,15 +468,17 @@ bool Simulation::addSensor(Sensor* sensor, uint16_t id)
 
 void Simulation::fillDistanceMap()
 {
+    // farther pairs are never checked, so they do not need cached distances
     for (SimEntMap::const_iterator it1 = _entities.begin(); it1 != _entities.end(); it1++)
     {
-        int id1 = it1->second->getID();
-        for (SimEntMap::const_iterator it2 = std::next(it1); it2 != _entities.end(); it2++)
+        SimEnt& fst = *it1->second;
+        _neighbours.clear();
+        _grid.query(fst.getBoundingBox(), _neighbours);
+        for (std::vector<SimEnt*>::const_iterator it2 = _neighbours.begin(); it2 != _neighbours.end(); it2++)
         {
-            int id2 = it2->second->getID();
             Point proj;
-            _distances[min(id1, id2) * MAX_ID_LEVEL + max(id1, id2)] =
-                -it1->second->collisionLength(*(it2->second), proj);
+            if ((*it2)->getID() > fst.getID())
+                setCachedDistance(fst, **it2, -fst.collisionLength(**it2, proj));
         }
     }
 }
@@ -229,31 +491,35 @@ void Simulation::start()
     updateSensorsState();
 }
 
-void Simulation::updateDistanceMap(SimEnt* movingEntity, double distance)
+void Simulation::entityMoved(SimEnt& entity, double distance)
 {
-    int id1 = movingEntity->getID();
-    for (SimEntMap::const_iterator it2 = _entities.begin(); it2 != _entities.end(); it2++)
-    {
-        int id2 = it2->second->getID();
-        _distances[min(id1, id2) * MAX_ID_LEVEL + max(id1, id2)] -= distance;
-    }
+    entity.addToOdometer(distance);
+    _grid.update(&entity);
 }
 
 
 void Simulation::update(double deltaTime)
 {
 	_time += deltaTime;
-    for (SimEntMap::const_iterator it1 = _entities.begin(); it1 != _entities.end(); it1++)
+    _contacts.clear();
+    _contactPairs.clear();
+    refreshOrder();
+
+    // motion of every entity depends only on itself, grid is updated afterwards in order of IDs
+    _moveDistances.resize(_ordered.size());
+    runParallel((int) _ordered.size(), [&](int begin, int end, int) {
+        for (int i = begin; i < end; i++)
+            _moveDistances[i] = _ordered[i]->updatePosition(deltaTime);
+    });
+    for (size_t i = 0; i < _ordered.size(); i++)
     {
-        double moveDistance = it1->second->updatePosition(deltaTime);
-        if (moveDistance > 0)
-        {
-            updateDistanceMap(it1->second, moveDistance);
-        }
+        if (_moveDistances[i] > 0)
+            entityMoved(*_ordered[i], _moveDistances[i]);
     }
 
 	checkCollisions();
     updateSensorsState();
+    updateAccumulators(deltaTime);
 }
 
 void Simulation::update(unsigned int steps)
@@ -262,33 +528,33 @@ void Simulation::update(unsigned int steps)
         update(_simulationStep);
 }
 
-int Simulation::checkCollisions(bool dryRun)
+int Simulation::checkCollisions()
 {
-    int num_checks = dryRun ? 1 : NUMBER_OF_CHECKS;
     int num_colls = 0;
-    for (int i = 0; i < num_checks; i++)
+    for (int i = 0; i < NUMBER_OF_CHECKS; i++)
     {
+        // pairs are visited in the order of IDs, but only entities sharing grid cells can collide
         for (SimEntMap::const_iterator it1 = _entities.begin(); it1 != _entities.end(); it1++)
         {
-            int id1 = it1->second->getID();
-            for (SimEntMap::const_iterator it2 = std::next(it1); it2 != _entities.end(); it2++)
+            SimEnt& fst = *it1->second;
+            _neighbours.clear();
+            _grid.query(fst.getBoundingBox(), _neighbours);
+            for (std::vector<SimEnt*>::const_iterator it2 = _neighbours.begin(); it2 != _neighbours.end(); it2++)
             {
-                int id2 = it2->second->getID();
-                if (_distances[min(id1, id2) * MAX_ID_LEVEL + max(id1, id2)] <= 0)
+                SimEnt& snd = **it2;
+                if (snd.getID() > fst.getID() && getCachedDistance(fst, snd) <= 0)
                 {
                     // orthogonal projection onto line (used only when sth is colliding with line)
                     Point proj;
 
-                    double collision_len = it1->second->collisionLength(*(it2->second), proj);
-                    _distances[min(id1, id2) * MAX_ID_LEVEL + max(id1, id2)] = -collision_len;
+                    Scalar collision_len = fst.collisionLength(snd, proj);
+                    setCachedDistance(fst, snd, -collision_len);
 
                     if (collision_len > EPS)
                     {
                         num_colls++;
-                        if (!dryRun)
-                        {
-                            removeCollision(*it1->second, *it2->second, collision_len, proj);
-                        }
+                        recordContact(fst, snd, collision_len, proj);
+                        removeCollision(fst, snd, collision_len, proj);
                     }
                 }
             }
@@ -297,7 +563,7 @@ int Simulation::checkCollisions(bool dryRun)
     return num_colls;
 }
 
-void Simulation::removeCollision(SimEnt& fst, SimEnt& snd, double collisionLen, Point& proj)
+void Simulation::removeCollision(SimEnt& fst, SimEnt& snd, Scalar collisionLen, Point& proj)
 {
 	int fst_shape = fst.getShapeID();
 	int snd_shape = snd.getShapeID();
@@ -316,27 +582,30 @@ void Simulation::removeCollision(SimEnt& fst, SimEnt& snd, double collisionLen,
         else // if it is Circular Entity or Robot
             center_snd = &dynamic_cast<CircularEnt*>(&snd)->getCenter();
 
-		double weights_sum = fst.getWeight() + snd.getWeight();
-		double fst_coeff = snd.getWeight() / weights_sum * fst.isMovable() + fst.getWeight() / weights_sum * (1 - snd.isMovable());
-		double snd_coeff = fst.getWeight() / weights_sum * snd.isMovable() + snd.getWeight() / weights_sum * (1 - fst.isMovable());
-		double centers_diff = center_fst->getDistance(*center_snd);
+		Scalar weights_sum = fst.getWeight() + snd.getWeight();
+		Scalar fst_coeff = snd.getWeight() / weights_sum * fst.isMovable() + fst.getWeight() / weights_sum * (1 - snd.isMovable());
+		Scalar snd_coeff = fst.getWeight() / weights_sum * snd.isMovable() + snd.getWeight() / weights_sum * (1 - fst.isMovable());
+		Scalar centers_diff = center_fst->getDistance(*center_snd);
         if (centers_diff == 0)
+        {
             snd.translate(0.1, 0.1);
+            entityMoved(snd, 0.1 * sqrt(2.0));
+        }
         else
         {
-		    double x_diff = center_fst->getXDiff(*center_snd);
-		    double y_diff = center_fst->getYDiff(*center_snd);
+		    Scalar x_diff = center_fst->getXDiff(*center_snd);
+		    Scalar y_diff = center_fst->getYDiff(*center_snd);
 
-		    double fst_x_trans = x_diff / centers_diff * collisionLen * fst_coeff;
-		    double fst_y_trans = y_diff / centers_diff * collisionLen * fst_coeff;
+		    Scalar fst_x_trans = x_diff / centers_diff * collisionLen * fst_coeff;
+		    Scalar fst_y_trans = y_diff / centers_diff * collisionLen * fst_coeff;
 
-		    double snd_x_trans = (-1) * x_diff / centers_diff * collisionLen * snd_coeff;
-		    double snd_y_trans = (-1) * y_diff / centers_diff * collisionLen * snd_coeff;
+		    Scalar snd_x_trans = (-1) * x_diff / centers_diff * collisionLen * snd_coeff;
+		    Scalar snd_y_trans = (-1) * y_diff / centers_diff * collisionLen * snd_coeff;
 
 		    fst.translate(fst_x_trans, fst_y_trans);
-            updateDistanceMap(&fst, collisionLen * fst_coeff);
+            entityMoved(fst, collisionLen * fst_coeff);
 		    snd.translate(snd_x_trans, snd_y_trans);
-            updateDistanceMap(&snd, collisionLen * snd_coeff);
+            entityMoved(snd, collisionLen * snd_coeff);
         }
 	}
 
@@ -344,18 +613,21 @@ void Simulation::removeCollision(SimEnt& fst, SimEnt& snd, double collisionLen,
 	{
 		Point& center = dynamic_cast<CircularEnt*>(&snd)->getCenter();
 
-        double proj_diff = center.getDistance(proj);
-        double x_diff = center.getXDiff(proj);
-        double y_diff = center.getYDiff(proj);
+        Scalar proj_diff = center.getDistance(proj);
+        Scalar x_diff = center.getXDiff(proj);
+        Scalar y_diff = center.getYDiff(proj);
 
 		if (proj_diff == 0)
+        {
 			snd.translate(0.1, 0.1);
+            entityMoved(snd, 0.1 * sqrt(2.0));
+        }
 		else
 		{
-			double x_trans = x_diff / proj_diff * collisionLen;
-			double y_trans = y_diff / proj_diff * collisionLen;
+			Scalar x_trans = x_diff / proj_diff * collisionLen;
+			Scalar y_trans = y_diff / proj_diff * collisionLen;
 			snd.translate(x_trans, y_trans);
-            updateDistanceMap(&snd, collisionLen);
+            entityMoved(snd, collisionLen);
 
 		}
 	}
@@ -365,14 +637,164 @@ void Simulation::removeCollision(SimEnt& fst, SimEnt& snd, double collisionLen,
 
 void Simulation::updateSensorsState()
 {
+    // sensors only read positions of other entities, which do not change in this phase
+    refreshOrder();
+    runParallel((int) _robots.size(), [&](int begin, int end, int worker) {
+        std::vector<SimEnt*>& neighbours = _workerNeighbours[worker];
+        for (int i = begin; i < end; i++)
+        {
+            KheperaRobot* robot = _robots[i];
+            Scalar reach = robot->getSensorsReach();
+            neighbours.clear();
+            _grid.query(BoundingBox(robot->getX() - reach, robot->getY() - reach,
+                robot->getX() + reach, robot->getY() + reach), neighbours);
+            robot->updateSensorsState(neighbours);
+        }
+    });
+}
+
+void Simulation::updateAccumulators(double deltaTime)
+{
+    if (_accumulatorsConfig.enabled == 0)
+        return;
+
+    // every robot updates only its own accumulators, so there is nothing to reduce across threads
+    refreshOrder();
+    runParallel((int) _robots.size(), [&](int begin, int end, int worker) {
+        std::vector<SimEnt*>& neighbours = _workerNeighbours[worker];
+        for (int i = begin; i < end; i++)
+        {
+            KheperaRobot* robot = _robots[i];
+            robot->accumulate(_accumulatorsConfig);
+
+            if (_accumulatorsConfig.enabled & ACC_NEAR_WALLS)
+            {
+                neighbours.clear();
+                _grid.query(robot->getBoundingBox().expanded(_accumulatorsConfig.nearWallDistance), neighbours);
+                for (std::vector<SimEnt*>::const_iterator wall = neighbours.begin(); wall != neighbours.end(); wall++)
+                {
+                    Point proj;
+                    // collision length is negative distance between robot edge and the wall
+                    if ((*wall)->getShapeID() == SimEnt::LINE &&
+                        -robot->collisionLength(**wall, proj) < _accumulatorsConfig.nearWallDistance)
+                    {
+                        robot->getAccumulators().timeNearWalls += deltaTime;
+                        break;
+                    }
+                }
+            }
+        }
+    });
+}
+
+void Simulation::refreshOrder()
+{
+    if (!_orderChanged)
+        return;
+
+    _ordered.clear();
+    _robots.clear();
     for (SimEntMap::const_iterator it = _entities.begin(); it != _entities.end(); it++)
     {
+        _ordered.push_back(it->second);
         if (it->second->getShapeID() == SimEnt::KHEPERA_ROBOT)
-            dynamic_cast<KheperaRobot*>(it->second)->updateSensorsState(_entities.begin(), _entities.end());
+            _robots.push_back(dynamic_cast<KheperaRobot*>(it->second));
     }
+    _orderChanged = false;
+}
+
+void Simulation::setThreadCount(int threadCount)
+{
+    _threadCount = max(threadCount, 1);
+    delete _threadPool;
+    _threadPool = NULL;
+}
+
+void Simulation::runParallel(int count, const ThreadPool::Task& task)
+{
+    if (_threadCount > 1 && _threadPool == NULL)
+        _threadPool = new ThreadPool(_threadCount);
+    _workerNeighbours.resize(_threadCount);
+
+    if (_threadPool != NULL)
+        _threadPool->parallelFor(count, task);
+    else
+        task(0, count, 0);
+}
+
+static Point& getEntityCenter(SimEnt& entity)
+{
+    if (entity.getShapeID() == SimEnt::RECTANGLE)
+        return dynamic_cast<RectangularEnt&>(entity).getCenter();
+    else // if it is Circular Entity or Robot
+        return dynamic_cast<CircularEnt&>(entity).getCenter();
 }
 
-SimEnt* Simulation::getEntity(uint16_t id)
+void Simulation::recordContact(SimEnt& fst, SimEnt& snd, Scalar collisionLen, Point& proj)
+{
+    // next checks find also collisions caused by moving entities apart - the pair is reported only once
+    if (!_contactPairs.insert(((uint64_t) fst.getID() << 32) | snd.getID()).second)
+        return;
+
+    ContactEvent contact;
+    contact.fstId = fst.getID();
+    contact.sndId = snd.getID();
+    contact.penetration = collisionLen;
+
+    if (fst.getShapeID() == SimEnt::LINE || snd.getShapeID() == SimEnt::LINE)
+    {
+        contact.x = proj.getX();
+        contact.y = proj.getY();
+    }
+    else
+    {
+        // middle of the overlap, on the line joining centers (at least one of entities is circular)
+        bool fstIsCircle = fst.getShapeID() != SimEnt::RECTANGLE;
+        CircularEnt& circle = dynamic_cast<CircularEnt&>(fstIsCircle ? fst : snd);
+        Point& from = circle.getCenter();
+        Point& to = getEntityCenter(fstIsCircle ? snd : fst);
+        Scalar centers_diff = from.getDistance(to);
+        Scalar offset = centers_diff == 0 ? 0 : (circle.getRadius() - collisionLen / 2) / centers_diff;
+        contact.x = from.getX() - from.getXDiff(to) * offset;
+        contact.y = from.getY() - from.getYDiff(to) * offset;
+    }
+    _contacts.push_back(contact);
+
+    SimEnt* participants[] = { &fst, &snd };
+    for (int i = 0; i < 2; i++)
+    {
+        if (participants[i]->getShapeID() != SimEnt::KHEPERA_ROBOT)
+            continue;
+        KheperaRobot* robot = dynamic_cast<KheperaRobot*>(participants[i]);
+        robot->registerContact();
+        if (_accumulatorsConfig.enabled & ACC_COLLISIONS)
+            robot->getAccumulators().collisions++;
+    }
+}
+
+int Simulation::countCollisions(SimEnt& entity)
+{
+    _neighbours.clear();
+    _grid.query(entity.getBoundingBox(), _neighbours);
+
+    int num_colls = 0;
+    for (std::vector<SimEnt*>::const_iterator it = _neighbours.begin(); it != _neighbours.end(); it++)
+    {
+        Point proj;
+        if (*it != &entity && entity.collisionLength(**it, proj) > EPS)
+            num_colls++;
+    }
+    return num_colls;
+}
+
+void Simulation::resetAccumulators()
+{
+    for (SimEntMap::const_iterator it = _entities.begin(); it != _entities.end(); it++)
+        if (it->second->getShapeID() == SimEnt::KHEPERA_ROBOT)
+            dynamic_cast<KheperaRobot*>(it->second)->getAccumulators().reset();
+}
+
+SimEnt* Simulation::getEntity(uint32_t id)
 {
 	SimEntMap::iterator it = _entities.find(id);
 
@@ -382,9 +804,47 @@ SimEnt* Simulation::getEntity(uint16_t id)
 		return NULL;
 }
 
-std::vector<int> Simulation::getIdsByShape(uint8_t shapeId)
+template <typename T>
+static void hashValue(uint64_t& hash, const T& value)
+{
+    hashBytes(hash, &value, sizeof(value));
+}
+
+uint64_t Simulation::getStateHash() const
 {
-    std::vector<int> ids;
+    // network frame holds positions, headings and sensor states of all entities in order of IDs
+    Buffer frame;
+    serialize(frame);
+    uint64_t hash = FNV_OFFSET_BASIS;
+    hashBytes(hash, frame.getBuffer(), frame.getLength());
+
+    // and the rest, which is not sent to visualisers
+    for (SimEntMap::const_iterator it = _entities.begin(); it != _entities.end(); it++)
+    {
+        hashValue(hash, it->second->getOdometer());
+        if (it->second->getShapeID() != SimEnt::KHEPERA_ROBOT)
+            continue;
+
+        KheperaRobot* robot = dynamic_cast<KheperaRobot*>(it->second);
+        const RobotAccumulators& accumulators = robot->getAccumulators();
+        hashValue(hash, robot->getLeftMotorSpeed());
+        hashValue(hash, robot->getRightMotorSpeed());
+        hashValue(hash, robot->getContactCount());
+        hashValue(hash, accumulators.distanceTravelled);
+        hashValue(hash, accumulators.speedSymmetrySum);
+        hashValue(hash, accumulators.maxSensorActivation);
+        hashValue(hash, accumulators.collisions);
+        hashValue(hash, accumulators.timeNearWalls);
+        hashValue(hash, accumulators.steps);
+    }
+    hashValue(hash, _random.getKey());
+    hashValue(hash, _random.getCounter());
+    return hash;
+}
+
+std::vector<uint32_t> Simulation::getIdsByShape(uint8_t shapeId)
+{
+    std::vector<uint32_t> ids;
     for (SimEntMap::const_iterator it = _entities.begin(); it != _entities.end(); it++)
     {
         if (it->second->getShapeID() == shapeId)
@@ -395,6 +855,7 @@ std::vector<int> Simulation::getIdsByShape(uint8_t shapeId)
 
 /*
 		Serialization format (all numbers except for time in network byte order - time is in host-byte order)
+		NUMBER_OF_ENTITIES has 16 bits in protocol version 1, 32 bits since version 2
 	+-------------------+--------------------------------------+-------------------+
 	|                                                                              |
 	|                              WORLD_WIDTH                                     |
@@ -410,32 +871,239 @@ std::vector<int> Simulation::getIdsByShape(uint8_t shapeId)
 	+-------------------+--------------------------------------+-------------------+
 	|                                      |                                       |
 	|          NUMBER_OF_ENTITIES          |              ENTITIES_DATA            |
-	|               16 bits                |              variable length          |
+	|             16 / 32 bits             |              variable length          |
 	+--------------------------------------+---------------------------------------+
 
 */
 
-void Simulation::serialize(Buffer& buffer) const
+void Simulation::serialize(Buffer& buffer, std::vector<uint32_t>* recordOffsets) const
 {
-	buffer.pack(htonl(_worldWidth));
-	buffer.pack(htonl(_worldHeight));
+    // compact positions are relative to the longer side of the world
+    if (buffer.isCompact())
+    {
+        uint32_t longerSide = max(_worldWidth, _worldHeight);
+        buffer.setCompactUnit(longerSide > 0 ? (double) longerSide / COMPACT_STEPS : 1);
+    }
+
+	buffer.packBigEndian(_worldWidth);
+	buffer.packBigEndian(_worldHeight);
 	buffer.pack(_time);
     buffer.pack(_hasBounds);
-	buffer.pack(htons(static_cast<uint16_t>(_entities.size())));
+    if (buffer.getProtocolVersion() < 2)
+	    buffer.packBigEndian(static_cast<uint16_t>(_entities.size()));
+    else
+        buffer.packBigEndian(static_cast<uint32_t>(_entities.size()));
 
     for (SimEntMap::const_iterator it = _entities.begin(); it != _entities.end(); it++)
+    {
+        if (recordOffsets != NULL)
+            recordOffsets->push_back(static_cast<uint32_t>(buffer.getLength()));
         it->second->serialize(buffer);
+    }
 }
 
-void Simulation::serialize(std::ofstream& file) const
+void Simulation::serialize(std::ostream& file) const
 {
+    uint32_t magic = WORLD_FILE_MAGIC;
+    uint16_t formatVersion = WORLD_FORMAT_VERSION;
+    file.write(reinterpret_cast<const char*>(&magic), sizeof(magic));
+    file.write(reinterpret_cast<const char*>(&formatVersion), sizeof(formatVersion));
 	file.write(reinterpret_cast<const char*>(&_worldWidth), sizeof(_worldWidth));
 	file.write(reinterpret_cast<const char*>(&_worldHeight), sizeof(_worldHeight));
 	file.write(reinterpret_cast<const char*>(&_time), sizeof(_time)); // do we have to save time to file?
     file.write(reinterpret_cast<const char*>(&_hasBounds), sizeof(_hasBounds));
-	uint16_t size = (uint16_t) _entities.size();
+	uint32_t size = (uint32_t) _entities.size();
 	file.write(reinterpret_cast<const char*>(&size), sizeof(size));
 
     for (SimEntMap::const_iterator it = _entities.begin(); it != _entities.end(); it++)
         it->second->serialize(file);
 }
+
+/*
+        State format (host byte order), follows binary world file in checkpoints
+        ENTITY_STATE is a file record of visitState fields of entity with ENTITY_ID (and of its sensors, if it is
+        a robot), in order of IDs - its length is given by the entity
+    +--------------------------------------+---------------------------------------+
+    |            RANDOM_KEY                |            RANDOM_COUNTER             |
+    |              64 bits                 |               64 bits                 |
+    +--------------------------------------+---------------------------------------+
+    |            CLONE_COUNT               |   ACCUMULATORS_CONFIG                 |
+    |              64 bits                 |   160 bits (enabled, near wall        |
+    |                                      |   distance, max motor speed)          |
+    +--------------------------------------+-------------------+-------------------+
+    |          NUMBER_OF_ENTITIES          |     ENTITY_ID     |   ENTITY_STATE    |
+    |               32 bits                |      32 bits      |  variable length  |
+    +--------------------------------------+-------------------+-------------------+
+*/
+// state of ENTITY and of its sensors, if it is a robot
+template <typename Visitor>
+static void visitEntityState(SimEnt& entity, Visitor& visitor)
+{
+    switch (entity.getShapeID())
+    {
+        case SimEnt::RECTANGLE:
+            dynamic_cast<RectangularEnt&>(entity).visitState(visitor);
+            break;
+        case SimEnt::KHEPERA_ROBOT:
+        {
+            KheperaRobot& robot = dynamic_cast<KheperaRobot&>(entity);
+            robot.visitState(visitor);
+            for (int i = 0; i < robot.getSensorCount(); i++)
+                robot.getSensor(i)->visitState(visitor);
+            break;
+        }
+        default:
+            entity.visitState(visitor);
+            break;
+    }
+}
+
+// fields of ENTITY without its sensors - shape ID tells its type
+template <typename Visitor>
+static void visitEntityFields(SimEnt& entity, Visitor& visitor)
+{
+    switch (entity.getShapeID())
+    {
+        case SimEnt::RECTANGLE:
+            static_cast<RectangularEnt&>(entity).visitFields(visitor);
+            break;
+        case SimEnt::CIRCLE:
+            static_cast<CircularEnt&>(entity).visitFields(visitor);
+            break;
+        case SimEnt::LINE:
+            static_cast<LinearEnt&>(entity).visitFields(visitor);
+            break;
+        case SimEnt::KHEPERA_ROBOT:
+            static_cast<KheperaRobot&>(entity).visitFields(visitor);
+            break;
+        default:
+            entity.visitFields(visitor);
+            break;
+    }
+}
+
+// free space for one record at END of FIELDS, which only grows
+static uint8_t* getFieldsTail(std::vector<uint8_t>& fields, size_t end)
+{
+    if (fields.size() < end + MAX_RECORD_SIZE)
+        fields.resize(max(2 * fields.size(), end + MAX_RECORD_SIZE));
+    return fields.data() + end;
+}
+
+void Simulation::copyFields(std::vector<uint8_t>& fields) const
+{
+    memcpy(getFieldsTail(fields, 0), &_time, sizeof(_time));
+    size_t end = sizeof(_time);
+    for (SimEntMap::const_iterator it = _entities.begin(); it != _entities.end(); it++)
+    {
+        CopyWriter writer(getFieldsTail(fields, end));
+        visitEntityFields(*it->second, writer);
+        end = writer.getEnd() - fields.data();
+        if (it->second->getShapeID() != SimEnt::KHEPERA_ROBOT)
+            continue;
+
+        KheperaRobot& robot = static_cast<KheperaRobot&>(*it->second);
+        for (int i = 0; i < robot.getSensorCount(); i++)
+        {
+            CopyWriter sensorWriter(getFieldsTail(fields, end));
+            robot.getSensor(i)->visitFields(sensorWriter);
+            end = sensorWriter.getEnd() - fields.data();
+        }
+    }
+}
+
+void Simulation::applyFields(const std::vector<uint8_t>& fields)
+{
+    memcpy(&_time, fields.data(), sizeof(_time));
+    CopyReader reader(fields.data() + sizeof(_time));
+    for (SimEntMap::const_iterator it = _entities.begin(); it != _entities.end(); it++)
+    {
+        visitEntityFields(*it->second, reader);
+        if (it->second->getShapeID() != SimEnt::KHEPERA_ROBOT)
+            continue;
+
+        KheperaRobot& robot = static_cast<KheperaRobot&>(*it->second);
+        for (int i = 0; i < robot.getSensorCount(); i++)
+            robot.getSensor(i)->visitFields(reader);
+    }
+}
+
+void Simulation::serializeState(std::ostream& file) const
+{
+    uint64_t randomKey = _random.getKey();
+    uint64_t randomCounter = _random.getCounter();
+    uint64_t cloneCount = _cloneCount;
+    uint32_t size = (uint32_t) _entities.size();
+    file.write(reinterpret_cast<const char*>(&randomKey), sizeof(randomKey));
+    file.write(reinterpret_cast<const char*>(&randomCounter), sizeof(randomCounter));
+    file.write(reinterpret_cast<const char*>(&cloneCount), sizeof(cloneCount));
+    file.write(reinterpret_cast<const char*>(&_accumulatorsConfig.enabled), sizeof(_accumulatorsConfig.enabled));
+    file.write(reinterpret_cast<const char*>(&_accumulatorsConfig.nearWallDistance),
+        sizeof(_accumulatorsConfig.nearWallDistance));
+    file.write(reinterpret_cast<const char*>(&_accumulatorsConfig.maxMotorSpeed),
+        sizeof(_accumulatorsConfig.maxMotorSpeed));
+    file.write(reinterpret_cast<const char*>(&size), sizeof(size));
+
+    // robot with all its sensors can be longer than MAX_RECORD_SIZE
+    std::vector<uint8_t> data;
+    for (SimEntMap::const_iterator it = _entities.begin(); it != _entities.end(); it++)
+    {
+        FieldSize recordSize(WORLD_FORMAT_VERSION, false);
+        visitEntityState(*it->second, recordSize);
+        data.resize(recordSize.getSize());
+        BinaryWriter writer(data.data(), WORLD_FORMAT_VERSION, false);
+        visitEntityState(*it->second, writer);
+
+        uint32_t id = it->first;
+        file.write(reinterpret_cast<const char*>(&id), sizeof(id));
+        file.write(reinterpret_cast<const char*>(data.data()), data.size());
+    }
+}
+
+void Simulation::readState(std::istream& file)
+{
+    uint64_t randomKey, randomCounter, cloneCount;
+    uint32_t size;
+    file.read(reinterpret_cast<char*>(&randomKey), sizeof(randomKey));
+    file.read(reinterpret_cast<char*>(&randomCounter), sizeof(randomCounter));
+    file.read(reinterpret_cast<char*>(&cloneCount), sizeof(cloneCount));
+    file.read(reinterpret_cast<char*>(&_accumulatorsConfig.enabled), sizeof(_accumulatorsConfig.enabled));
+    file.read(reinterpret_cast<char*>(&_accumulatorsConfig.nearWallDistance),
+        sizeof(_accumulatorsConfig.nearWallDistance));
+    file.read(reinterpret_cast<char*>(&_accumulatorsConfig.maxMotorSpeed), sizeof(_accumulatorsConfig.maxMotorSpeed));
+    file.read(reinterpret_cast<char*>(&size), sizeof(size));
+    if (!file)
+        throw WorldFormatError("state of simulation is truncated");
+    if (size != _entities.size())
+        throw WorldFormatError("state of simulation does not match the world");
+    _random.setKey(randomKey);
+    _random.setCounter(randomCounter);
+    _cloneCount = cloneCount;
+
+    std::vector<uint8_t> data;
+    for (uint32_t i = 0; i < size; i++)
+    {
+        uint32_t id = 0;
+        file.read(reinterpret_cast<char*>(&id), sizeof(id));
+        SimEntMap::iterator entity = _entities.find(id);
+        if (entity == _entities.end())
+            throw WorldFormatError("state of simulation does not match the world");
+
+        FieldSize recordSize(WORLD_FORMAT_VERSION, false);
+        visitEntityState(*entity->second, recordSize);
+        data.resize(recordSize.getSize());
+        if (!file.read(reinterpret_cast<char*>(data.data()), data.size()))
+            throw WorldFormatError("state of simulation is truncated");
+        BinaryReader reader(data.data(), WORLD_FORMAT_VERSION);
+        visitEntityState(*entity->second, reader);
+        _grid.update(entity->second); // precise center of rectangle
+    }
+}
+
+void Simulation::serialize(WorldImageBuilder& image) const
+{
+    image.setWorld(_worldWidth, _worldHeight, _time, _hasBounds);
+    for (SimEntMap::const_iterator it = _entities.begin(); it != _entities.end(); it++)
+        if (it->first < RESERVED_ID_LEVEL)
+            it->second->serialize(image);
+}
@@ -3,60 +3,171 @@
 
 #include <map>
 #include <iostream>
+#include <sstream>
+#include <vector>
+#include <unordered_set>
+#include <cctype>
 
+#include "Parallel/ThreadPool.h" // includes standard headers, so it goes before min and max macros
+#include "Serialization/TextParser.h" // the same
 #include "Entities/SimEnt.h"
 #include "Sensors/Sensor.h"
 #include "Buffer.h"
 #include "Constants.h"
 #include "Math/MathLib.h"
+#include "Metrics/RobotAccumulators.h"
+#include "ContactEvent.h"
+#include "Spatial/SpatialGrid.h"
+#include "Math/RandomStream.h"
+
+class KheperaRobot;
 
 class Simulation
 {
 	public:
         Simulation(unsigned int worldWidth, unsigned int worldHeight, bool addBounds,
                 double simulationStep = DEFAULT_SIMULATION_STEP, int simulationDelay = DEFAULT_SIMULATION_DELAY);
-        Simulation(std::ifstream& file, bool readBinary, double simulationStep = DEFAULT_SIMULATION_STEP,
+        // throws WorldFormatError, if file is malformed; binary file can also be a checkpoint
+        Simulation(std::istream& file, bool readBinary, double simulationStep = DEFAULT_SIMULATION_STEP,
 			int simulationDelay = DEFAULT_SIMULATION_DELAY);
+        // IMAGE has to be open, it is not used after simulation is created
+        Simulation(const WorldImage& image, double simulationStep = DEFAULT_SIMULATION_STEP,
+            int simulationDelay = DEFAULT_SIMULATION_DELAY);
         Simulation(const Simulation& simulation);
         ~Simulation();
 
+        // every entity and sensor passed to simulation has to be created in its arena, with create method
+        template <typename T, typename... Args>
+        T* create(Args&&... args) { return _arena.create<T>(std::forward<Args>(args)...); }
+        Arena& getArena() { return _arena; }
+
 		void addEntity(SimEnt* newEntity);
-        bool addSensor(Sensor* sensor, uint16_t id);
+        // add or remove entity while simulation is running - only cached distances to its neighbours are updated
+        // removed entity is destroyed, its memory (and memory of its sensors) is reused by next spawned entities
+        // both fail if ID is reserved, spawn also if it is already taken
+        bool spawnEntity(SimEnt* newEntity);
+        bool despawnEntity(uint32_t id);
+        bool addSensor(Sensor* sensor, uint32_t id);
 		void start();
         void update(unsigned int steps = 1);
-        void fillDistanceMap();
-		SimEnt* getEntity(uint16_t id);
-        std::vector<int> getIdsByShape(uint8_t shapeId);
+        void fillDistanceMap(); // exact distances between all neighbouring entities
+		SimEnt* getEntity(uint32_t id);
+        std::vector<uint32_t> getIdsByShape(uint8_t shapeId);
+        int getEntityCount() const { return (int) _entities.size(); }
+        const SimEntMap& getEntities() const { return _entities; } // in order of IDs
+        double getTime() const { return _time; }
+        void setTime(double time) { _time = time; } // for replays
         int getWorldWidth() { return _worldWidth; }
         int getWorldHeight() { return _worldHeight; }
-        int getNumCollisions() { return checkCollisions(true); }
+        // contacts resolved during last step - counting them does not need another pass over all pairs
+        int getNumCollisions() const { return (int) _contacts.size(); }
+        const ContactList& getContacts() const { return _contacts; }
+        // exact number of entities currently overlapping with ENTITY, only its neighbours from grid are checked
+        int countCollisions(SimEnt& entity);
+
+        // has to be called after entity was moved by DISTANCE (or less) outside of update (e.g. teleported)
+        void entityMoved(SimEnt& entity, double distance);
+        const SpatialGrid& getGrid() const { return _grid; }
+
+        // every simulation has its own random stream, clones get streams split from the one of original
+        void setSeed(uint64_t seed) { _random = RandomStream(seed); }
+        RandomStream& getRandom() { return _random; }
 
-		void serialize(Buffer& buffer) const;
-		void serialize(std::ofstream& file) const;
+        // motion, sensors and accumulators phases are run by THREAD_COUNT threads, collisions are always resolved
+        // by single thread in order of IDs - the state after every step does not depend on the number of threads
+        void setThreadCount(int threadCount);
+        int getThreadCount() const { return _threadCount; }
+        // FNV-1a hash of everything, that affects next steps - equal hashes mean identical runs
+        uint64_t getStateHash() const;
+
+        // accumulators of all robots are updated after every step, according to given configuration
+        void setAccumulatorsConfig(const AccumulatorsConfig& config) { _accumulatorsConfig = config; }
+        const AccumulatorsConfig& getAccumulatorsConfig() const { return _accumulatorsConfig; }
+        void resetAccumulators();
+
+		// in protocol version of the buffer; offsets of entity records in it are appended to RECORD_OFFSETS, if given
+		void serialize(Buffer& buffer, std::vector<uint32_t>* recordOffsets = NULL) const;
+		void serialize(std::ostream& file) const; // always in WORLD_FORMAT_VERSION
+        void serialize(WorldImageBuilder& image) const; // world bounds are not stored
+        // what world file does not keep (or keeps as real32) - world file followed by it restores everything,
+        // that affects next steps, only distance cache is rebuilt
+        void serializeState(std::ostream& file) const;
+        // applies state to entities read from world file, throws WorldFormatError, if it does not match them
+        void readState(std::istream& file);
+        // copy with the same random stream (copy constructor splits a new one), for checkpoints
+        Simulation* createSnapshot() const;
+        // identifies the set of entities - it changes, whenever entities are added or removed, and it is unique
+        // among all simulations
+        uint64_t getEntitiesVersion() const { return _entitiesVersion; }
+        // time and fields of all entities and sensors in order of IDs (FIELDS only grows) - cheaper than a new
+        // snapshot, when entities version is the same as it was, when the snapshot was created; snapshot with
+        // applied fields serializes the same as this simulation (its grid is not updated, it cannot be stepped)
+        void copyFields(std::vector<uint8_t>& fields) const;
+        void applyFields(const std::vector<uint8_t>& fields);
 
 	protected:
         void update(double deltaTime); // deltaTime in [ s ]
-        int checkCollisions(bool dryRun=false);
-        void removeCollision(SimEnt& fst, SimEnt& snd, double collisionLen, Point& proj);
+        int checkCollisions();
+        void removeCollision(SimEnt& fst, SimEnt& snd, Scalar collisionLen, Point& proj);
         void updateSensorsState();
+        void updateAccumulators(double deltaTime);
+        void recordContact(SimEnt& fst, SimEnt& snd, Scalar collisionLen, Point& proj);
+        void refreshOrder();
+        void runParallel(int count, const ThreadPool::Task& task);
 
+        // all objects owned by simulation live here, so destroying simulation is releasing a few blocks
+        Arena                         _arena;
         DistanceMap                   _distances;
 		SimEntMap                     _entities;
+        ContactList                   _contacts; // cleared at the beginning of every step
+        std::unordered_set<uint64_t>  _contactPairs; // IDs of pairs in _contacts, to report every pair once
+        uint32_t                      _lastSerial;
+        uint64_t                      _entitiesVersion;
+        std::vector<SimEnt*>          _slots; // NULL for free slot
+        std::vector<uint32_t>         _freeSlots;
 		uint32_t                      _worldWidth;
 		uint32_t                      _worldHeight;
 		double                        _time;
 		double                        _simulationStep; // in [ s ]
 		uint16_t                      _simulationDelay; // in [ ms ]
         bool                          _hasBounds;
+        AccumulatorsConfig            _accumulatorsConfig;
+        SpatialGrid                   _grid;
+        std::vector<SimEnt*>          _neighbours; // result of last grid query, reused to avoid allocations
+
+        // entities and robots in order of IDs, rebuilt only after entities were added or removed
+        std::vector<SimEnt*>          _ordered;
+        std::vector<KheperaRobot*>    _robots;
+        bool                          _orderChanged;
+        std::vector<Scalar>           _moveDistances; // of entities from _ordered, during last step
+        int                           _threadCount;
+        ThreadPool*                   _threadPool; // created with the first parallel phase
+        std::vector<std::vector<SimEnt*> >  _workerNeighbours; // _neighbours of every thread
+        RandomStream                  _random;
+        mutable uint64_t              _cloneCount; // identifies random streams of clones
 
 		bool                          _isRunning;
 
     private:
-        void updateDistanceMap(SimEnt* movingEntity, double distance);
+        static uint64_t getDistanceKey(uint32_t slot1, uint32_t slot2)
+        {
+            return ((uint64_t) min(slot1, slot2) << 32) | max(slot1, slot2);
+        }
+        // lower bound of the gap between entities, 0 if it is unknown
+        double getCachedDistance(SimEnt& fst, SimEnt& snd) const;
+        void setCachedDistance(SimEnt& fst, SimEnt& snd, double distance);
         void addBounds();
-        void addEntityInternal(SimEnt* newEntity, int idLimit = MAX_ID_LEVEL);
-        SimEnt* readEntity(std::ifstream& file, bool readBinary);
-        Sensor* readSensor(std::ifstream& file, bool readBinary);
+        void addEntityInternal(SimEnt* newEntity);
+        Simulation(const Simulation& other, bool exact); // EXACT copy keeps random stream of OTHER
+        void removeEntityInternal(SimEntMap::iterator entity);
+        void destroyEntity(SimEnt* entity); // gives memory of ENTITY created in arena back to it
+        void readText(TextParser& parser);
+        void readBinaryWorld(std::istream& file);
+        uint16_t readHeader(std::istream& file);
+        SimEnt* readEntity(std::istream& file, uint16_t formatVersion);
+        Sensor* readSensor(std::istream& file);
+        SimEnt* createEntity(uint8_t shapeID, FieldSource& source);
+        Sensor* createSensor(uint8_t type, FieldSource& source);
 };
 
 
@@ -0,0 +1,57 @@
+#include "PlacementService.h"
+
+PlacementService::PlacementService(Simulation& simulation, RandomStream& generator, int maxAttempts)
+    : _simulation(simulation), _generator(generator), _maxAttempts(maxAttempts)
+{
+}
+
+bool PlacementService::isFree(SimEnt& entity)
+{
+    _neighbours.clear();
+    _simulation.getGrid().query(entity.getBoundingBox(), _neighbours);
+    for (std::vector<SimEnt*>::const_iterator it = _neighbours.begin(); it != _neighbours.end(); it++)
+    {
+        Point proj;
+        if (*it != &entity && entity.collisionLength(**it, proj) > EPS)
+            return false;
+    }
+    return true;
+}
+
+bool PlacementService::placeRobot(KheperaRobot& robot)
+{
+    double radius = robot.getRadius();
+    double width = _simulation.getWorldWidth();
+    double height = _simulation.getWorldHeight();
+    if (2 * radius > width || 2 * radius > height)
+        return false;
+
+    Point start(robot.getCenter());
+    for (int i = 0; i < _maxAttempts; i++)
+    {
+        // whole robot has to be inside the world
+        double x = _generator.uniform(radius, width - radius);
+        double y = _generator.uniform(radius, height - radius);
+        robot.getCenter().setCoords(x, y);
+        if (isFree(robot))
+        {
+            robot.setDirectionAngle(_generator.uniform(0, 2 * M_PI));
+            robot.setLeftMotorSpeed(0);
+            robot.setRightMotorSpeed(0);
+            _simulation.entityMoved(robot, robot.getCenter().getDistance(start));
+            return true;
+        }
+    }
+
+    robot.getCenter().setCoords(start);
+    return false;
+}
+
+int PlacementService::placeRobots(KheperaRobot** robots, int count)
+{
+    int placed = 0;
+    for (int i = 0; i < count; i++)
+        if (placeRobot(*robots[i]))
+            placed++;
+    return placed;
+}
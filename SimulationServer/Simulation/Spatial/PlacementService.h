@@ -0,0 +1,33 @@
+#ifndef PLACEMENT_SERVICE_H
+#define PLACEMENT_SERVICE_H
+
+#include <vector>
+
+#include "../Simulation.h"
+#include "../Entities/KheperaRobot.h"
+
+// finds random collision free poses for robots - candidate pose is checked only against entities from
+// the same cells of simulation grid, so single attempt does not depend on the number of entities
+class PlacementService
+{
+    public:
+        PlacementService(Simulation& simulation, RandomStream& generator,
+            int maxAttempts = DEFAULT_PLACEMENT_ATTEMPTS);
+
+        // moves ROBOT to random free pose inside the world and stops it
+        // if no pose was found in maxAttempts, robot stays where it was and false is returned
+        bool placeRobot(KheperaRobot& robot);
+        // places ROBOTS one after another, so that they avoid also each other; returns number of placed robots
+        int placeRobots(KheperaRobot** robots, int count);
+
+        // checks current pose of ENTITY against its neighbours
+        bool isFree(SimEnt& entity);
+
+    private:
+        Simulation&             _simulation;
+        RandomStream&           _generator;
+        int                     _maxAttempts;
+        std::vector<SimEnt*>    _neighbours; // reused between queries
+};
+
+#endif
@@ -0,0 +1,126 @@
+#include "SpatialGrid.h"
+
+#include <algorithm>
+#include <cmath>
+
+void SpatialGrid::reset(double width, double height, double cellSize)
+{
+    _cellSize = cellSize;
+    _columns = (int) ceil(width / cellSize);
+    _rows = (int) ceil(height / cellSize);
+    if (_columns < 1)
+        _columns = 1;
+    if (_rows < 1)
+        _rows = 1;
+
+    _cells.clear();
+    _cells.resize(_columns * _rows);
+    _ranges.clear();
+}
+
+int SpatialGrid::clampColumn(double x) const
+{
+    int column = (int) floor(x / _cellSize);
+    return column < 0 ? 0 : (column >= _columns ? _columns - 1 : column);
+}
+
+int SpatialGrid::clampRow(double y) const
+{
+    int row = (int) floor(y / _cellSize);
+    return row < 0 ? 0 : (row >= _rows ? _rows - 1 : row);
+}
+
+SpatialGrid::CellRange SpatialGrid::getRange(const BoundingBox& box) const
+{
+    CellRange range;
+    range.used = true;
+    range.minColumn = clampColumn(box.minX);
+    range.minRow = clampRow(box.minY);
+    range.maxColumn = clampColumn(box.maxX);
+    range.maxRow = clampRow(box.maxY);
+    return range;
+}
+
+void SpatialGrid::addToCells(SimEnt* entity, const CellRange& range)
+{
+    for (int row = range.minRow; row <= range.maxRow; row++)
+        for (int column = range.minColumn; column <= range.maxColumn; column++)
+            _cells[row * _columns + column].push_back(entity);
+}
+
+void SpatialGrid::removeFromCells(SimEnt* entity, const CellRange& range)
+{
+    for (int row = range.minRow; row <= range.maxRow; row++)
+    {
+        for (int column = range.minColumn; column <= range.maxColumn; column++)
+        {
+            std::vector<SimEnt*>& cell = _cells[row * _columns + column];
+            std::vector<SimEnt*>::iterator it = std::find(cell.begin(), cell.end(), entity);
+            if (it != cell.end())
+            {
+                // order of entities in cell does not matter
+                *it = cell.back();
+                cell.pop_back();
+            }
+        }
+    }
+}
+
+void SpatialGrid::insert(SimEnt* entity)
+{
+    if (entity->getSlot() >= _ranges.size())
+    {
+        CellRange unused = CellRange();
+        _ranges.resize(entity->getSlot() + 1, unused);
+    }
+
+    CellRange range = getRange(entity->getBoundingBox());
+    _ranges[entity->getSlot()] = range;
+    addToCells(entity, range);
+}
+
+void SpatialGrid::remove(SimEnt* entity)
+{
+    if (entity->getSlot() >= _ranges.size() || !_ranges[entity->getSlot()].used)
+        return;
+    removeFromCells(entity, _ranges[entity->getSlot()]);
+    _ranges[entity->getSlot()].used = false;
+}
+
+void SpatialGrid::update(SimEnt* entity)
+{
+    if (entity->getSlot() >= _ranges.size() || !_ranges[entity->getSlot()].used)
+        return;
+
+    CellRange& current = _ranges[entity->getSlot()];
+    CellRange range = getRange(entity->getBoundingBox());
+    if (range == current)
+        return;
+
+    removeFromCells(entity, current);
+    addToCells(entity, range);
+    current = range;
+}
+
+static bool lowerID(const SimEnt* fst, const SimEnt* snd)
+{
+    return fst->getID() < snd->getID();
+}
+
+void SpatialGrid::query(const BoundingBox& box, std::vector<SimEnt*>& result) const
+{
+    size_t first = result.size();
+    CellRange range = getRange(box);
+    for (int row = range.minRow; row <= range.maxRow; row++)
+    {
+        for (int column = range.minColumn; column <= range.maxColumn; column++)
+        {
+            const std::vector<SimEnt*>& cell = _cells[row * _columns + column];
+            result.insert(result.end(), cell.begin(), cell.end());
+        }
+    }
+
+    // entities spanning several cells were added several times
+    std::sort(result.begin() + first, result.end(), lowerID);
+    result.erase(std::unique(result.begin() + first, result.end()), result.end());
+}
@@ -0,0 +1,62 @@
+#ifndef SPATIAL_GRID_H
+#define SPATIAL_GRID_H
+
+#include <vector>
+
+#include "../Entities/SimEnt.h"
+#include "../Math/BoundingBox.h"
+
+// uniform grid over the world - every entity is stored in all cells touched by its bounding box
+// entities outside of the world are kept in border cells
+// cells change every step, so unlike entities they are kept on the heap, not in the arena of simulation
+class SpatialGrid
+{
+    public:
+        SpatialGrid() : _cellSize(1), _columns(0), _rows(0) {}
+
+        // removes all entities and covers WIDTH x HEIGHT world with square cells
+        void reset(double width, double height, double cellSize);
+
+        void insert(SimEnt* entity);
+        void remove(SimEnt* entity);
+        // has to be called after entity was moved, cheap if it has not left its cells
+        void update(SimEnt* entity);
+
+        // appends (once) every entity, whose cells are touched by BOX - some of them may not intersect it
+        // appended entities are sorted by IDs, so that results do not depend on order of insertion
+        void query(const BoundingBox& box, std::vector<SimEnt*>& result) const;
+
+        double getCellSize() const { return _cellSize; }
+        int getColumns() const { return _columns; }
+        int getRows() const { return _rows; }
+
+    private:
+        struct CellRange
+        {
+            int minColumn;
+            int minRow;
+            int maxColumn;
+            int maxRow;
+            bool used;
+
+            bool operator==(const CellRange& other) const
+            {
+                return minColumn == other.minColumn && minRow == other.minRow &&
+                    maxColumn == other.maxColumn && maxRow == other.maxRow;
+            }
+        };
+
+        CellRange getRange(const BoundingBox& box) const;
+        int clampColumn(double x) const;
+        int clampRow(double y) const;
+        void addToCells(SimEnt* entity, const CellRange& range);
+        void removeFromCells(SimEnt* entity, const CellRange& range);
+
+        double                               _cellSize;
+        int                                  _columns;
+        int                                  _rows;
+        std::vector<std::vector<SimEnt*> >   _cells; // row by row
+        std::vector<CellRange>               _ranges; // cells occupied by every entity, by its slot
+};
+
+#endif
@@ -0,0 +1,53 @@
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include "../Simulation/Simulation.h"
+#include "../Simulation/Serialization/WorldImage.h"
+
+// converts text or binary world file (any version) to world image, which simulations are created from
+// usage: WorldConverter <world file> <image file> [-binary]
+
+int main(int argc, char** argv)
+{
+    if (argc < 3 || (argc > 3 && strcmp(argv[3], "-binary") != 0))
+    {
+        std::cerr << "usage: WorldConverter <world file> <image file> [-binary]" << std::endl;
+        return 1;
+    }
+
+    bool readBinary = argc > 3;
+    std::ifstream file(argv[1], readBinary ? std::ios::in | std::ios::binary : std::ios::in);
+    if (!file)
+    {
+        std::cerr << "cannot open " << argv[1] << std::endl;
+        return 1;
+    }
+    WorldImageBuilder builder;
+    try
+    {
+        Simulation simulation(file, readBinary);
+        simulation.serialize(builder);
+    }
+    catch (const WorldFormatError& error)
+    {
+        std::cerr << argv[1] << ": " << error.what() << std::endl;
+        return 1;
+    }
+    if (!builder.write(argv[2]))
+    {
+        std::cerr << "cannot write " << argv[2] << std::endl;
+        return 1;
+    }
+
+    // image is read back, so that broken one is never left behind silently
+    WorldImage image;
+    if (!image.open(argv[2]) || !image.verifyChecksum())
+    {
+        std::cerr << "written image is not valid" << std::endl;
+        return 1;
+    }
+    std::cout << argv[2] << ": " << image.getEntityCount() << " entities, " << image.getSensorCount()
+        << " sensors" << std::endl;
+    return 0;
+}
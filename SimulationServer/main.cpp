@@ -1,7 +1,9 @@
 #include "CommunicationManager.h"
 #include "DistrSimulation.h"
+#include "ReplaySimulation.h"
 #include <iostream>
 #include <fstream>
+#include <csignal>
 
 char* getCmdOption(char** begin, char** end, const std::string& option)
 {
@@ -16,6 +18,69 @@ bool cmdOptionExists(char** begin, char** end, const std::string& option)
     return std::find(begin, end, option) != end;
 }
 
+static CommunicationManager* runningServer = NULL;
+
+// SIGINT and SIGTERM stop the server loop, so the simulation, checkpointer and recorder are finished regularly
+void stopServer(int)
+{
+    if (runningServer)
+        runningServer->requestStop();
+}
+
+// runs server for SIMULATION until it is stopped, returns exit code of the program
+int serve(DistrSimulation& simulation, int argc, char** argv)
+{
+    CommunicationManager commMan(&simulation);
+    simulation.setCommunicationManager(&commMan);
+    if (char* policy = getCmdOption(argv, argv + argc, "-controllers"))
+        commMan.setControllerSendPolicy(std::string(policy) == "latest" ? SendQueue::LATEST_ONLY : SendQueue::KEEP_ALL);
+
+    if (!initSockets())
+    {
+        std::cout << "Sockets could not be initialized. Error code: " << getSocketError() << std::endl;
+        return 3;
+    }
+    Checkpointer* checkpointer = NULL;
+    TrajectoryRecorder* recorder = NULL;
+    if (commMan.init())
+    {
+        if (char* checkpointFile = getCmdOption(argv, argv + argc, "-checkpoint"))
+        {
+            char* interval = getCmdOption(argv, argv + argc, "-every");
+            checkpointer = new Checkpointer(checkpointFile, interval ? atoi(interval) : DEFAULT_CHECKPOINT_INTERVAL);
+            simulation.setCheckpointer(checkpointer);
+        }
+        if (char* recordFile = getCmdOption(argv, argv + argc, "-record"))
+        {
+            recorder = new TrajectoryRecorder(recordFile);
+            if (!recorder->isOpen())
+                std::cout << "Trajectory file could not be created, nothing will be recorded." << std::endl;
+            simulation.setRecorder(recorder);
+        }
+        simulation.start();
+        runningServer = &commMan;
+        signal(SIGINT, stopServer);
+        signal(SIGTERM, stopServer);
+        commMan.runServerLoop();
+    }
+    else
+    {
+        cleanupSockets();
+        return 4;
+    }
+    simulation.stop(); // it uses communication manager
+    cleanupSockets();
+    delete checkpointer; // writes the last snapshot
+    delete recorder; // writes waiting steps and index
+
+    // repeated signals (e.g. to the whole process group) must not interrupt finishing of files above
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+    runningServer = NULL;
+
+    return 0;
+}
+
 int main(int argc, char** argv)
 {
     char* inputFile = NULL;
@@ -25,43 +90,55 @@ int main(int argc, char** argv)
             << "the project, protocol description and usage can be found at github.com/Ewande/khepera.\n\n";
         std::cout << "Flags to use as command line arguments:\n";
         std::cout << "   -in FILE\tspecifies input world description file\n";
-        std::cout << "   [-bin]\tindicates that input file should be read as a binary file" << std::endl;
+        std::cout << "   [-bin]\tindicates that input file should be read as a binary file (checkpoints are "
+            << "recognized without it)\n";
+        std::cout << "   [-checkpoint FILE]\twrites checkpoint of the world to FILE periodically, it can be passed to -in\n";
+        std::cout << "   [-every STEPS]\tsteps between checkpoints, " << DEFAULT_CHECKPOINT_INTERVAL << " by default\n";
+        std::cout << "   [-record FILE]\twrites trajectory of every step to FILE (keyframe every "
+            << DEFAULT_KEYFRAME_INTERVAL << " steps)\n";
+        std::cout << "   [-controllers all|latest]	controllers, which do not keep up, get every state (and are "
+            << "disconnected, when " << SendQueue::DEFAULT_CAPACITY << " wait) or the latest one only\n";
+        std::cout << "   -replay FILE\tserves trajectory recorded with -record to visualisers instead of -in world\n";
+        std::cout << "   [-speed SPEED]\tmultiplier of recorded time in replay, visualisers can change it and seek"
+            << std::endl;
         return 0;
     }
+    if (char* replayFile = getCmdOption(argv, argv + argc, "-replay"))
+    {
+        TrajectoryReader reader;
+        if (!reader.open(replayFile) || !reader.next())
+        {
+            std::cout << "Trajectory file could not be read." << std::endl;
+            return 2;
+        }
+        ReplaySimulation simulation(reader);
+        if (char* speed = getCmdOption(argv, argv + argc, "-speed"))
+            simulation.setPlaybackSpeed(atof(speed));
+        return serve(simulation, argc, argv);
+    }
     if (!cmdOptionExists(argv, argv + argc, "-in") || !(inputFile = getCmdOption(argv, argv + argc, "-in")))
     {
         std::cout << "World description file not passed. Use '-in' flag to pass input file." << std::endl;
         return 1;
     }
-    std::ifstream file(inputFile);
+    std::ifstream file(inputFile, std::ios::in | std::ios::binary);
     if (!file.is_open())
     {
         std::cout << "World description file could not be found." << std::endl;
         return 2;
     }
-    bool readBinary = cmdOptionExists(argv, argv + argc, "-bin");
-    DistrSimulation simulation(file, readBinary);
-    CommunicationManager commMan(&simulation);
-    simulation.setCommunicationManager(&commMan);
-
-	WSADATA wsaData;
-	int iResult = WSAStartup(MAKEWORD(2, 2), &wsaData);
-	if (iResult != 0)
+    bool readBinary = cmdOptionExists(argv, argv + argc, "-bin") || Checkpointer::isCheckpoint(file);
+    DistrSimulation* simulation = NULL;
+    try
     {
-		std::cout << "WSAStartup failed. Error code: " << iResult << std::endl;
-		return 3;
-	}
-	if (commMan.init())
-	{
-		simulation.start();
-		commMan.runServerLoop();
-	}
-    else
+        simulation = new DistrSimulation(file, readBinary);
+    }
+    catch (const WorldFormatError& error)
     {
-        WSACleanup();
-        return 4;
+        std::cout << inputFile << ": " << error.what() << std::endl;
+        return 2;
     }
-	WSACleanup();
-
-	return 0;
-}
\ No newline at end of file
+    int result = serve(*simulation, argc, argv);
+    delete simulation;
+    return result;
+}